@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+namespace SHG
+{
+	// Counts calls to the global operator new, so benchmarks can report how many allocations a run makes.
+	// Replacing operator new applies to the whole program, but only adds a relaxed atomic increment to each allocation.
+	class AllocationCounter
+	{
+	public:
+		static uint64_t GetAllocationCount();
+	};
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CPU.hpp"
+#include "LockstepBatch.hpp"
+
+namespace SHG
+{
+	// Runs many headless sessions on all cores. Each line of the manifest describes one session:
+	//     <path-to-rom> [frame-count] [instructions-per-second] [seed] [input-recording]
+	// Any value can be '-' to use the default. If an input recording is given, it's replayed, and missing values 
+	// are taken from the recording instead. Empty lines and lines starting with '#' are ignored. The results of all 
+	// sessions are written to a single CSV file, in the same order as the manifest. With lockstep enabled, sessions with 
+	// the same ROM, frame count and instructions per second, and no input recording, are run together in a LockstepBatch.
+	// Sessions that reach an instruction the batch doesn't support are run again on their own.
+	class BatchRunner
+	{
+	public:
+		static const int DEFAULT_FRAME_COUNT = 3600;
+		static const int DEFAULT_INSTRUCTIONS_PER_SECOND = 800;
+		static const uint64_t DEFAULT_SEED = 0;
+
+		// Returns false if the manifest can't be read or the results can't be written
+		static bool Run(std::string manifestPath, std::string outputPath, int threadCount, CPU::DispatchMode dispatchMode, bool isLockstepEnabled);
+
+	private:
+		struct Session
+		{
+			std::string romPath;
+			std::string inputPath;
+			int frameCount;
+			int instructionsPerSecond;
+			uint64_t seed;
+
+			// Values that weren't given in the manifest
+			bool isFrameCountMissing;
+			bool isInstructionsPerSecondMissing;
+			bool isSeedMissing;
+		};
+
+		struct SessionResult
+		{
+			bool isRomLoaded;
+			bool isInputLoaded;
+			uint64_t instructionCount;
+			uint64_t framebufferHash;
+			CPU::RegisterState registers;
+		};
+
+		static bool ReadManifest(std::string manifestPath, std::vector<Session>* sessions);
+		static void RunSession(const Session& session, const std::vector<uint8_t>* rom, InputRecording* input, 
+			CPU::DispatchMode dispatchMode, SessionResult* result);
+		static void RunLockstepSessions(const std::vector<Session>& sessions, const std::vector<int>& sessionIndices, 
+			const std::vector<uint8_t>* rom, CPU::DispatchMode dispatchMode, std::vector<SessionResult>* results);
+		static bool WriteResults(std::string outputPath, const std::vector<Session>& sessions, const std::vector<SessionResult>& results);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CPU.hpp"
+
+namespace SHG
+{
+	// Measures the emulator's throughput by running ROMs headless at unthrottled speed.
+	class Benchmark
+	{
+	public:
+		// Runs all benchmarks. Built-in ROMs are used unless a ROM file is provided.
+		static void Run(std::string romPath);
+
+	private:
+		static void RunDispatchBenchmark(const std::vector<uint8_t>& rom);
+		static void RunSpriteBenchmark();
+		static void RunLockstepBenchmark(const std::vector<uint8_t>& rom);
+		static void RunSaveStateBenchmark(const std::vector<uint8_t>& rom);
+		static void RunRewindBenchmark(std::string name, const std::vector<uint8_t>& rom);
+		static void RunRunAheadBenchmark(const std::vector<uint8_t>& rom);
+		static void RunTraceBenchmark(const std::vector<uint8_t>& rom);
+		static int MeasureInputLatency(int runAheadFrameCount);
+		static double MeasureLockstepSeconds(const std::vector<uint8_t>& rom, bool isAvx2Enabled, int frameCount, uint64_t* instructionCount);
+		static double MeasureSeconds(const std::vector<uint8_t>& rom, CPU::DispatchMode mode, int frameCount, uint64_t* instructionCount, 
+			std::string tracePath = "");
+	};
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CPU.hpp"
+
+namespace SHG
+{
+	// Runs generated ROMs that each stress one hot path (ALU, branches, sprites, memory instructions) in every 
+	// dispatch mode, and times ROM loading. The results are written to a CSV file, one row per benchmark and 
+	// dispatch mode, so the results of two builds can be compared. If a baseline file from an earlier run is 
+	// given, the change of every row is printed as well.
+	class BenchmarkSuite
+	{
+	public:
+		// Returns false if a benchmark can't be run, or the results can't be written
+		static bool Run(std::string outputPath, std::string baselinePath);
+
+	private:
+		struct Result
+		{
+			std::string name;
+			std::string dispatch;
+
+			// Instructions for the ROM benchmarks, and ROM loads for the loading benchmarks
+			uint64_t operationCount;
+			double seconds;
+			uint64_t allocationCount;
+		};
+
+		static std::vector<uint8_t> CreateAluRom();
+		static std::vector<uint8_t> CreateBranchRom();
+		static std::vector<uint8_t> CreateSpriteRom();
+		static std::vector<uint8_t> CreateMemoryRom();
+
+		static Result MeasureRom(std::string name, const std::vector<uint8_t>& rom, CPU::DispatchMode mode);
+		// Returns false if the ROM can't be written to a file or loaded
+		static bool MeasureRomLoading(bool isFromFile, Result* result);
+
+		static void PrintResult(const Result& result, const std::vector<Result>& baseline);
+		static bool WriteResults(std::string outputPath, const std::vector<Result>& results);
+		static bool ReadResults(std::string filePath, std::vector<Result>* results);
+	};
+}
\ No newline at end of file
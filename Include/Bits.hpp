@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace SHG
+{
+	// Returns the number of zero bits above the highest set bit. The value must not be 0.
+	inline int CountLeadingZeros(uint64_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return 63 - (int)index;
+#else
+		return __builtin_clzll(value);
+#endif
+	}
+
+	// Returns the number of zero bits below the lowest set bit. The value must not be 0.
+	inline int CountTrailingZeros(uint64_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return (int)index;
+#else
+		return __builtin_ctzll(value);
+#endif
+	}
+
+	inline int CountSetBits(uint64_t value)
+	{
+#ifdef _MSC_VER
+		return (int)__popcnt64(value);
+#else
+		return __builtin_popcountll(value);
+#endif
+	}
+}
\ No newline at end of file
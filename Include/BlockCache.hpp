@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "CPU.hpp"
+#include "Memory.hpp"
+#include "JitCompiler.hpp"
+
+namespace SHG
+{
+	struct BasicBlock
+	{
+		uint16_t startAddress;
+
+		// Number of bytes of memory the block was decoded from
+		uint16_t size;
+		std::vector<CPU::DecodedInstruction> instructions;
+
+		// How many times the block has been executed, which is used to find blocks worth compiling
+		uint32_t executionCount;
+
+		// Native code for the first nativeInstructionCount instructions, or null if the block hasn't been compiled
+		JitCompiler::NativeBlock nativeCode;
+		int nativeInstructionCount;
+
+		// If the block starts a loop that only polls the delay timer (FX07, 3XKK/4XKK, 1NNN back to the start), 
+		// or a jump to itself, this is the number of instructions in one iteration of the loop. Otherwise it's 0.
+		// Such a loop can't change anything until the delay timer does, which is at the end of the frame.
+		int idleLoopLength;
+	};
+
+	// Caches sequences of decoded instructions (basic blocks) by their start address, so that
+	// code which runs repeatedly doesn't have to be fetched and decoded every time.
+	// Blocks are discarded whenever memory they were decoded from is overwritten.
+	class BlockCache : public CodeWriteListener
+	{
+	public:
+		static const int MAX_BLOCK_LENGTH = 32;
+
+		BlockCache(Memory* memory, const CPU::DecodedInstruction* decodeTable);
+		BlockCache(const BlockCache&) = delete;
+		BlockCache& operator=(const BlockCache&) = delete;
+		~BlockCache();
+
+		BasicBlock* GetBlock(uint16_t address);
+		void Clear();
+		void ClearNativeCode();
+		void OnCodeWrite(int address) override;
+
+	private:
+		Memory* memory;
+		const CPU::DecodedInstruction* decodeTable;
+		std::unique_ptr<BasicBlock> blocks[Memory::TOTAL_MEMORY];
+
+		BasicBlock* BuildBlock(uint16_t address);
+		int GetIdleLoopLength(const BasicBlock* block);
+		void RemoveBlock(int address);
+	};
+}
\ No newline at end of file
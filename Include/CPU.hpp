@@ -2,25 +2,185 @@
 #include <map>
 #include <functional>
 #include <chrono>
+#include <memory>
+#include <atomic>
 #include "Memory.hpp"
 #include "Display.hpp"
 #include "Keypad.hpp"
+#include "Host.hpp"
+#include "TripleBuffer.hpp"
+#include "Random.hpp"
+#include "InputRecording.hpp"
+#include "Tracer.hpp"
+#include "Profiler.hpp"
+#include "Quirks.hpp"
 
 namespace SHG
 {
+	class BlockCache;
+	class JitCompiler;
+	struct BasicBlock;
+
 	class CPU
 	{
 	public:
+		static const int FRAMES_PER_SECOND = 60;
+		static const uint8_t STACK_SIZE = 16;
+		static const uint8_t REGISTER_COUNT = 16;
+
+		// How instructions are decoded before they're executed
+		enum class DispatchMode
+		{
+			// Look up the pre-decoded instruction in the decode table
+			Table,
+
+			// Decode the instruction with a switch every time it's executed
+			Switch,
+
+			// Run cached sequences of pre-decoded instructions without fetching them from memory
+			BlockCache,
+
+			// Compile frequently executed blocks into native code (x86-64 only)
+			Jit
+		};
+
+		struct DecodedInstruction;
+		typedef void (CPU::*InstructionHandler)(const DecodedInstruction& instruction);
+
+		// An instruction with its handler and operands already extracted
+		struct DecodedInstruction
+		{
+			InstructionHandler handler;
+			uint16_t opcode;
+			uint16_t nnn;
+			uint8_t x;
+			uint8_t y;
+			uint8_t kk;
+			uint8_t n;
+
+			// Set for instructions that may change the program counter or write to memory, 
+			// since the instructions that follow them can't be assumed to run next.
+			bool endsBlock;
+
+			// The handler's Profiler::Family. Only set in the decode table.
+			uint8_t profilerFamily;
+		};
+
+		// Copy of the registers
+		struct RegisterState
+		{
+			uint8_t vRegisters[REGISTER_COUNT];
+			uint16_t iRegister;
+			uint16_t programCounter;
+			uint16_t stack[STACK_SIZE];
+			uint8_t stackPointer;
+			uint16_t timerRegisters[2];
+		};
+
+		// Everything the CPU needs to continue from the same point, apart from memory and the screen
+		struct State
+		{
+			RegisterState registers;
+			uint64_t randomState[Random::STATE_SIZE];
+			uint64_t frameCount;
+			uint64_t instructionCount;
+			int32_t frameInstructionRemainder;
+			uint8_t flagRegisters[REGISTER_COUNT];
+			uint8_t audioPattern[Sound::PATTERN_SIZE];
+			uint8_t audioPitch;
+			uint8_t isWaitingForKey;
+			uint8_t keyWaitRegister;
+		};
+
 		CPU(Memory* memory, Display* display, Keypad* keypad);
-		void StartCycle(int instructionsPerSecond);
-		void Tick();
+		CPU(const CPU&) = delete;
+		CPU& operator=(const CPU&) = delete;
+		~CPU();
+
+		// Runs the CPU at real-time speed on an emulation thread, while the calling thread handles the host's events 
+		// and presents the latest finished frame. Returns once the host is closed.
+		void StartCycle(Host* host, int instructionsPerSecond);
+		void RunFrames(Host* host, int instructionsPerSecond, int frameCount);
+		void RunFrame(int instructionCount);
+
+		// How many instructions the next frame should execute at the speed given to StartCycle or RunFrames
+		int GetFrameInstructionCount();
+
+		uint64_t GetInstructionCount();
+		uint64_t GetFrameCount();
+
+		// Sets the seed of the generator used by CXKK. The same seed always gives the same numbers.
+		void SetRandomSeed(uint64_t seed);
+
+		// Adds every change of the keypad that the CPU sees to the recording, at the frame and instruction where it was seen
+		void SetInputRecording(InputRecording* recording);
+
+		// Sets the keypad from the recording's events whenever the CPU reads it, instead of leaving it to the host
+		void SetInputReplay(InputRecording* replay);
+		void SaveRegisters(RegisterState* state);
+
+		// Must not be called while StartCycle is running
+		void SaveState(State* state);
+		void LoadState(const State& state);
+
+		// The sound of the last frame that was run: the sound timer, and XO-CHIP's audio pattern and pitch
+		void GetSound(Sound* sound);
+
+		// True while FX0A is waiting for a key. No instructions are executed in the meantime, but the timers keep running.
+		bool IsWaitingForKey();
+
+		void SetDispatchMode(DispatchMode mode);
+
+		// Picks the handlers for the instructions that differ between platforms. Cached and compiled code is discarded, 
+		// so this is meant to be called once, before the CPU starts running.
+		void SetQuirkProfile(QuirkProfile profile);
+		QuirkProfile GetQuirkProfile();
+
+		// Writes a record of every executed instruction to the tracer, or stops tracing if it's null. The check is made 
+		// once per frame, so tracing costs nothing per instruction while it's off. While it's on, instructions are 
+		// stepped one at a time, without the block cache or the JIT.
+		void SetTracer(Tracer* tracer);
+		Tracer* GetTracer();
+
+		// Adds every executed instruction to the profile, or stops profiling if it's null. 
+		// Like tracing, this is checked once per frame, and instructions are stepped one at a time while it's on.
+		void SetProfiler(Profiler* profiler);
+		Profiler* GetProfiler();
+
+		// Called on the emulating thread before every frame. If it returns false, the frame isn't executed 
+		// (e.g. because the hook has replaced the machine's state with an earlier one), but it is still presented.
+		void SetFrameHook(std::function<bool()> hook);
+
+		// Frames that were finished by the CPU but replaced by a newer frame before they could be presented
+		uint64_t GetDroppedFrameCount();
+
+		// Times the host presented the same frame again because the CPU hadn't finished a new one
+		uint64_t GetDuplicatedFrameCount();
+
+		// The average number of frames the host presented between a key event and the next change on screen, 
+		// measured during StartCycle. This is the input latency the player sees, as long as the ROM responds to the key.
+		double GetAverageInputLatency();
+		uint64_t GetInputLatencySampleCount();
+
+		// When enabled, every compiled block is also executed with ExecuteInstruction, and the results are compared
+		void SetJitCheckEnabled(bool isEnabled);
+		uint64_t GetJitCheckedBlockCount();
+		uint64_t GetJitMismatchCount();
 
 	private:
-		static const uint8_t STACK_SIZE = 16;
-		static const uint8_t REGISTER_COUNT = 16;
 		static const uint8_t DELAY_TIMER_INDEX = 0;
 		static const uint8_t SOUND_TIMER_INDEX = 1;
 		static const uint8_t VF_REG_INDEX = 15;
+		static const int DECODE_TABLE_SIZE = 0x10000;
+
+		// How many times a block is interpreted before it's compiled
+		static const uint32_t JIT_COMPILE_THRESHOLD = 16;
+
+		// A finished frame, passed from the emulation thread to the render thread
+		struct Frame
+		{
+			Display::Screen screen;
+		};
 
 		Memory* memory;
 		Display* display;
@@ -32,130 +192,266 @@ namespace SHG
 		uint16_t iRegister{};
 		uint16_t timerRegisters[2]{};
 
-		std::chrono::system_clock::time_point previousTimerUpdateTime;
+		uint64_t instructionCount{};
+		uint64_t frameCount{};
+		Random random;
 
-		bool isRunning = false;
-		int instructionsPerSecond = 800;
-		double targetFetchDeltaTime;
-		std::chrono::system_clock::time_point previousInstructionFetchTime;
+		InputRecording* inputRecording{};
+		InputRecording* inputReplay{};
+		size_t inputReplayPosition{};
+
+		// The keypad as it is in the recording so far, including the CPU's own changes to the released keys. 
+		// A reading that differs from it is added to the recording.
+		uint16_t recordedKeyStates{};
+		uint16_t recordedReleasedKeyStates{};
 
-		uint8_t GetX(uint16_t instruction);
-		uint8_t GetY(uint16_t instruction);
+		bool isWaitingForKey = false;
+		uint8_t keyWaitRegister{};
 
-		void PrintInstructionExecution(std::string instruction);
-		void PrintStackPointerValue();
-		void PrintStackValues();
-		void PrintProgramCounterValue();
-		void PrintRegisterValues();
-		void PrintDelayTimerValue();
-		void PrintSoundTimerValue();
+		// SUPER-CHIP's RPL user flags, which FX75 and FX85 save registers to and load them from
+		uint8_t flagRegisters[REGISTER_COUNT]{};
 
+		// XO-CHIP's audio pattern and pitch. Until a program loads its own pattern, it's the beeper's square wave.
+		uint8_t audioPattern[Sound::PATTERN_SIZE];
+		uint8_t audioPitch = SoundGenerator::DEFAULT_PITCH;
+
+		// Set if the sound timer was running during the last frame, before it was decremented
+		bool isSoundPlaying = false;
+
+		std::atomic<bool> isRunning{ false };
+		int instructionsPerSecond = 800;
+		int frameInstructionRemainder{};
+
+		TripleBuffer<Frame> frameBuffer;
+		uint64_t droppedFrameCount{};
+		uint64_t duplicatedFrameCount{};
+		uint64_t inputLatencyFrameTotal{};
+		uint64_t inputLatencySampleCount{};
+
+		std::function<bool()> frameHook;
+
+		DispatchMode dispatchMode = DispatchMode::BlockCache;
+		QuirkProfile quirkProfile = QuirkProfile::Default;
+		QuirkSettings quirks = QuirkSettings::Create<DefaultQuirks>();
+		DecodedInstruction (*decodeInstruction)(uint16_t instruction);
+		const DecodedInstruction* decodeTable;
+		std::unique_ptr<BlockCache> blockCache;
+		std::unique_ptr<JitCompiler> jitCompiler;
+
+		Tracer* tracer{};
+		Profiler* profiler{};
+
+		bool isJitCheckEnabled = false;
+		uint64_t jitCheckedBlockCount{};
+		uint64_t jitMismatchCount{};
+
+		static uint8_t GetX(uint16_t instruction);
+		static uint8_t GetY(uint16_t instruction);
+		// The handlers depend on the quirk profile, so there's a decoder and a decode table for each profile
+		template<typename Quirks>
+		static DecodedInstruction DecodeInstruction(uint16_t instruction);
+		template<typename Quirks>
+		static const DecodedInstruction* GetDecodeTable();
+		template<typename Quirks>
+		static Profiler::Family GetProfilerFamily(InstructionHandler handler);
+		static void ExecuteFallbackInstruction(CPU* cpu, const DecodedInstruction* instruction);
+
+		void RunEmulationThread(Host* host);
+		void UpdateKeyWait();
+
+		// Keys can change on the host's thread at any time, so everything that depends on the keypad 
+		// works from a single reading, which is also the reading that gets recorded or replayed
+		void ReadKeypad(uint16_t* keyStates, uint16_t* releasedKeyStates);
+		void ReplayInput();
+		bool IsInputEventDue(const InputRecording::Event& event);
+		void RecordInput(uint16_t keyStates, uint16_t releasedKeyStates);
+		bool IsKeyPressed(uint8_t key);
+		void SetInstructionsPerSecond(int instructionsPerSecond);
+		void Step();
+		uint16_t FetchInstruction();
+		void ExecuteInstrumented(int instructionCount);
+		void TraceInstruction(uint16_t address, uint16_t opcode, const uint8_t* previousRegisters);
+		void UpdateProfilerCallStack();
+		int CountSpritePixels(const DecodedInstruction& instruction);
+		void ExecuteBlocks(int instructionCount);
+		// Skips as many iterations of an idle loop as fit in the given number of instructions, 
+		// and returns how many instructions were skipped. Returns 0 if the loop would exit.
+		int SkipIdleLoop(BasicBlock* block, int instructionCount);
+		int ExecuteNativeBlock(BasicBlock* block, int maxInstructionCount);
+		void CheckNativeBlock(BasicBlock* block);
+		void LoadRegisters(const RegisterState* state);
+		void UpdateTimers();
 		void MoveToNextInstruction();
+
+		// Skips XO-CHIP's 4-byte F000 NNNN as a whole, and any other instruction as 2 bytes
+		void SkipNextInstruction();
 		void ExecuteInstruction(uint16_t instruction);
 
+		//Unknown instruction, which is ignored
+		void Execute_Unsupported(const DecodedInstruction& instruction);
+
 		//SYS addr
-		void Execute_0NNN(uint16_t instruction);
+		void Execute_0NNN(const DecodedInstruction& instruction);
 
 		//CLS
-		void Execute_00E0(uint16_t instruction);
+		void Execute_00E0(const DecodedInstruction& instruction);
 
 		//RET
-		void Execute_00EE(uint16_t instruction);
+		void Execute_00EE(const DecodedInstruction& instruction);
+
+		//SCD nibble
+		void Execute_00CN(const DecodedInstruction& instruction);
+
+		//SCU nibble (XO-CHIP)
+		void Execute_00DN(const DecodedInstruction& instruction);
+
+		//SCR
+		void Execute_00FB(const DecodedInstruction& instruction);
+
+		//SCL
+		void Execute_00FC(const DecodedInstruction& instruction);
+
+		//EXIT
+		void Execute_00FD(const DecodedInstruction& instruction);
+
+		//LOW
+		void Execute_00FE(const DecodedInstruction& instruction);
+
+		//HIGH
+		void Execute_00FF(const DecodedInstruction& instruction);
 
 		//JP addr
-		void Execute_1NNN(uint16_t instruction);
+		void Execute_1NNN(const DecodedInstruction& instruction);
 
 		//CALL addr
-		void Execute_2NNN(uint16_t instruction);
+		void Execute_2NNN(const DecodedInstruction& instruction);
 
 		//SE Vx, byte
-		void Execute_3XKK(uint16_t instruction);
+		void Execute_3XKK(const DecodedInstruction& instruction);
 
 		//SNE Vx, byte
-		void Execute_4XKK(uint16_t instruction);
+		void Execute_4XKK(const DecodedInstruction& instruction);
 
 		//SE Vx, Vy
-		void Execute_5XY0(uint16_t instruction);
+		void Execute_5XY0(const DecodedInstruction& instruction);
+
+		//SAVE Vx - Vy (XO-CHIP)
+		void Execute_5XY2(const DecodedInstruction& instruction);
+
+		//LOAD Vx - Vy (XO-CHIP)
+		void Execute_5XY3(const DecodedInstruction& instruction);
 
 		//LD Vx, byte
-		void Execute_6XKK(uint16_t instruction);
+		void Execute_6XKK(const DecodedInstruction& instruction);
 
 		//ADD vx, byte
-		void Execute_7XKK(uint16_t instruction);
+		void Execute_7XKK(const DecodedInstruction& instruction);
 
 		//LD Vx, Vy
-		void Execute_8XY0(uint16_t instruction);
+		void Execute_8XY0(const DecodedInstruction& instruction);
 
 		//OR VX, Vy
-		void Execute_8XY1(uint16_t instruction);
+		template<typename Quirks>
+		void Execute_8XY1(const DecodedInstruction& instruction);
 
 		//AND Vx, Vy
-		void Execute_8XY2(uint16_t instruction);
+		template<typename Quirks>
+		void Execute_8XY2(const DecodedInstruction& instruction);
 
 		//XOR Vx, Vy
-		void Execute_8XY3(uint16_t instruction);
+		template<typename Quirks>
+		void Execute_8XY3(const DecodedInstruction& instruction);
 
 		//ADD Vx, Vy
-		void Execute_8XY4(uint16_t instruction);
+		void Execute_8XY4(const DecodedInstruction& instruction);
 
 		//SUB Vx, Vy
-		void Execute_8XY5(uint16_t instruction);
+		template<typename Quirks>
+		void Execute_8XY5(const DecodedInstruction& instruction);
 
 		//SHR Vx {, Vy}
-		void Execute_8XY6(uint16_t instruction);
+		template<typename Quirks>
+		void Execute_8XY6(const DecodedInstruction& instruction);
 
 		//SUBN V, Vy
-		void Execute_8XY7(uint16_t instruction);
+		template<typename Quirks>
+		void Execute_8XY7(const DecodedInstruction& instruction);
 
 		//SHL vx {, Vy}
-		void Execute_8XYE(uint16_t instruction);
+		template<typename Quirks>
+		void Execute_8XYE(const DecodedInstruction& instruction);
 
 		//SNE Vx, Vy
-		void Execute_9XY0(uint16_t instruction);
+		void Execute_9XY0(const DecodedInstruction& instruction);
 
 		//LD I, addr
-		void Execute_ANNN(uint16_t instruction);
+		void Execute_ANNN(const DecodedInstruction& instruction);
 
 		//JP V0, addr
-		void Execute_BNNN(uint16_t instruction);
+		template<typename Quirks>
+		void Execute_BNNN(const DecodedInstruction& instruction);
 
 		//RND Vx, byte
-		void Execute_CXKK(uint16_t instruction);
+		void Execute_CXKK(const DecodedInstruction& instruction);
 
 		//DRW Vx, Vy, nibble
-		void Execute_DXYN(uint16_t instruction);
+		template<typename Quirks>
+		void Execute_DXYN(const DecodedInstruction& instruction);
 
 		//SKP Vx
-		void Execute_EX9E(uint16_t instruction);
+		void Execute_EX9E(const DecodedInstruction& instruction);
 
 		//SKNP Vx
-		void Execute_EXA1(uint16_t instruction);
+		void Execute_EXA1(const DecodedInstruction& instruction);
 
 		//SKNP Vx
-		void Execute_FX07(uint16_t instruction);
+		void Execute_FX07(const DecodedInstruction& instruction);
+
+		//LD I, long (XO-CHIP)
+		void Execute_F000(const DecodedInstruction& instruction);
+
+		//PLANE n (XO-CHIP)
+		void Execute_FN01(const DecodedInstruction& instruction);
+
+		//AUDIO (XO-CHIP)
+		void Execute_F002(const DecodedInstruction& instruction);
 
 		//LD Vx, K
-		void Execute_FX0A(uint16_t instruction);
+		void Execute_FX0A(const DecodedInstruction& instruction);
 
 		//LD DT, Vx
-		void Execute_FX15(uint16_t instruction);
+		void Execute_FX15(const DecodedInstruction& instruction);
 
 		//LD ST, Vx
-		void Execute_FX18(uint16_t instruction);
+		void Execute_FX18(const DecodedInstruction& instruction);
 
 		//ADD I, Vx
-		void Execute_FX1E(uint16_t instruction);
+		void Execute_FX1E(const DecodedInstruction& instruction);
 
 		//LD F, Vx
-		void Execute_FX29(uint16_t instruction);
+		void Execute_FX29(const DecodedInstruction& instruction);
+
+		//LD HF, Vx
+		void Execute_FX30(const DecodedInstruction& instruction);
+
+		//PITCH Vx (XO-CHIP)
+		void Execute_FX3A(const DecodedInstruction& instruction);
 
 		//LD B, Vx
-		void Execute_FX33(uint16_t instruction);
+		void Execute_FX33(const DecodedInstruction& instruction);
 
 		//LD [I], Vx
-		void Execute_FX55(uint16_t instruction);
+		template<typename Quirks>
+		void Execute_FX55(const DecodedInstruction& instruction);
 
 		//LD Vx, [I]
-		void Execute_FX65(uint16_t instruction);
+		template<typename Quirks>
+		void Execute_FX65(const DecodedInstruction& instruction);
+
+		//LD R, Vx
+		void Execute_FX75(const DecodedInstruction& instruction);
+
+		//LD Vx, R
+		void Execute_FX85(const DecodedInstruction& instruction);
 	};
 }
\ No newline at end of file
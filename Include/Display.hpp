@@ -1,6 +1,6 @@
 #pragma once
 #include <cstdint>
-#include <SDL.h>
+#include <vector>
 
 namespace SHG
 {
@@ -11,22 +11,107 @@ namespace SHG
 		static const int LOW_RES_SCREEN_HEIGHT = 32;
 		static const int LOW_RES_PIXEL_COUNT = LOW_RES_SCREEN_WIDTH * LOW_RES_SCREEN_HEIGHT;
 
-		Display(int width, int height);
+		// SUPER-CHIP and XO-CHIP can switch to a high resolution mode
+		static const int HIGH_RES_SCREEN_WIDTH = 128;
+		static const int HIGH_RES_SCREEN_HEIGHT = 64;
+
+		// XO-CHIP draws on two bitplanes, which together give each pixel one of four colors
+		static const int PLANE_COUNT = 2;
+
+		// Every row is stored as one 64-bit word per 64 pixels, so a plane holds at most this many words
+		static const int MAX_WORDS_PER_ROW = HIGH_RES_SCREEN_WIDTH / 64;
+		static const int MAX_PLANE_WORD_COUNT = MAX_WORDS_PER_ROW * HIGH_RES_SCREEN_HEIGHT;
+
+		// An area of the screen that has changed since the last time the dirty regions were cleared, 
+		// in pixels of the current resolution
+		struct DirtyRect
+		{
+			int x;
+			int y;
+			int width;
+			int height;
+		};
+
+		// Everything that is shown on the screen, as kept in save states and handed from the emulation thread to the window
+		struct Screen
+		{
+			uint8_t isHighRes;
+			uint8_t planeMask;
+			uint64_t planes[PLANE_COUNT][MAX_PLANE_WORD_COUNT];
+		};
+
+		// Clears the selected planes
 		void Clear();
+
+		// Switches between 64x32 and 128x64 pixels. Every plane is cleared, even if the resolution doesn't change.
+		void SetHighRes(bool isHighRes);
+		bool IsHighRes();
+		int GetWidth();
+		int GetHeight();
+
+		// Selects the planes that are drawn, cleared and scrolled, with the first plane in the lowest bit
+		void SetPlaneMask(uint8_t planeMask);
+		uint8_t GetPlaneMask();
+
+		// The color of a pixel has one bit per plane, with the first plane in the lowest bit
 		void SetPixel(int x, int y, uint8_t color);
 		uint8_t GetPixel(int x, int y);
 
+		// XORs a sprite row of up to 16 pixels onto a plane, starting at (x, y), with the left-most pixel in the highest bit. 
+		// Pixels past the right edge are clipped, or wrapped around to the left edge. Returns true if any pixel was turned off.
+		bool DrawSpriteRow(int plane, int x, int y, uint16_t spriteRow, int spriteWidth, bool isWrapping);
+
+		// XORs an 8-pixel sprite row onto the first plane, starting at (x, y). Pixels past the edges of the screen are clipped.
+		// Returns true if any pixel was turned off.
+		bool DrawSpriteRow(int x, int y, uint8_t spriteRow);
+
+		// Move the selected planes by the given number of pixels (less than 64). Pixels that are moved in are off.
+		void ScrollDown(int pixelCount);
+		void ScrollUp(int pixelCount);
+		void ScrollLeft(int pixelCount);
+		void ScrollRight(int pixelCount);
+
+		void GetScreen(Screen* screen);
+
+		// Replaces the whole screen, marking the rows that differ as dirty
+		void SetScreen(const Screen& screen);
+
+		bool IsScreenEqual(const Display& other);
+
+		// Returns a 64-bit FNV-1a hash of the screen, which can be used to compare the output of two runs
+		uint64_t GetHash();
+
+		// Returns true if any pixel is different from when the dirty regions were last cleared. 
+		// A sprite that is drawn and then erased again within the same frame doesn't count as a change.
+		bool HasChanged();
+
+		// Returns the changed areas of the screen, with adjacent changed rows merged into a single rect
+		const std::vector<DirtyRect>& GetDirtyRects();
+
+		// Marks the current contents of the screen as unchanged. Should be called once a frame has been consumed.
+		void ClearDirtyRegions();
+
 	private:
-		uint8_t lowResScreenPixels[LOW_RES_PIXEL_COUNT]{};
+		// Each plane is a contiguous array of rows, and each row is one word in low resolution and two in high resolution, 
+		// so a sprite row is drawn with a shift and an XOR, vertical scrolling moves whole words, 
+		// and a low resolution plane takes up only 256 bytes.
+		uint64_t planes[PLANE_COUNT][MAX_PLANE_WORD_COUNT]{};
+		bool isHighRes{};
+		int wordsPerRow = 1;
+		uint8_t planeMask = 1;
+
+		// The planes as they were when the dirty regions were last cleared
+		uint64_t cleanPlanes[PLANE_COUNT][MAX_PLANE_WORD_COUNT]{};
+
+		// One bit per row that has been drawn to since the dirty regions were last cleared. 
+		// Only these rows are compared against the clean rows.
+		uint64_t dirtyRowMask{};
 
-		int screenWidth{};
-		int screenHeight{};
+		// Set when the resolution has changed since the dirty regions were last cleared, which changes the whole screen
+		bool isResolutionChanged{};
 
-		int pixelWidth{};
-		int pixelHeight{};
+		std::vector<DirtyRect> dirtyRects;
 
-		SDL_Window* window{};
-		SDL_Surface* surface{};
-		SDL_Renderer* renderer{};
+		uint64_t GetAllRowsMask();
 	};
 }
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+#include "Host.hpp"
+
+namespace SHG
+{
+	// Host without a window or input device. The framebuffer is only kept in memory, 
+	// which allows ROMs to run on machines without a video device.
+	class HeadlessHost : public Host
+	{
+	public:
+		bool ProcessEvents(Keypad* keypad) override;
+		void Present(Display* display) override;
+
+		int GetPresentedFrameCount();
+
+		// Returns how many presented frames were different from the frame before them
+		int GetChangedFrameCount();
+
+	private:
+		int presentedFrameCount{};
+		int changedFrameCount{};
+	};
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+#include "Display.hpp"
+#include "Keypad.hpp"
+#include "SoundGenerator.hpp"
+
+namespace SHG
+{
+	// Connects the emulated machine to the outside world. The CPU only talks to the host 
+	// through this interface, so the core can run with or without a window.
+	class Host
+	{
+	public:
+		virtual ~Host() = default;
+
+		// Handles any pending input/window events and forwards key changes to the keypad.
+		// Returns false once the host has been asked to shut down.
+		virtual bool ProcessEvents(Keypad* keypad) = 0;
+
+		// Shows the current contents of the display's framebuffer. The display's dirty regions describe 
+		// what has changed since the previous call, and are cleared once this returns.
+		virtual void Present(Display* display) = 0;
+
+		// True while the user is asking to go back in time. May be called from the emulation thread.
+		virtual bool IsRewindRequested() { return false; }
+
+		// Plays the sound of one frame. Called on the emulation thread after every frame that's run in real time.
+		virtual void QueueAudio(const Sound& sound) {}
+
+		// True if the emulation should be paced by the host's audio device instead of the system clock, 
+		// so its sound is never cut short or stretched. The emulation thread then calls WaitForAudioClock between frames.
+		virtual bool IsAudioClockEnabled() { return false; }
+
+		// Blocks until the audio device is about to need the sound of the next frame
+		virtual void WaitForAudioClock() {}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Quirks.hpp"
+
+namespace SHG
+{
+	// Every change of the keypad that the CPU saw, together with everything else needed to repeat a run exactly: 
+	// the random seed, the instructions per second, the number of frames and the quirk profile. Replaying it on the same ROM 
+	// gives a bit-exact copy of the original run, on any thread and at any speed.
+	//
+	// Recordings are saved as text, so they can also be written by hand:
+	//     chip8-input 1
+	//     seed <seed>
+	//     instructions-per-second <count>
+	//     frames <count>
+	//     quirks <profile>
+	//     <frame> <instruction> <pressed keys> <released keys>
+	//     ...
+	// An event takes effect the first time the keypad is read in a later frame, or in the same frame once at least 
+	// the given number of instructions have been executed in total. The keys are 16-bit hexadecimal masks, 
+	// with key 0 in the lowest bit.
+	// Released keys are the ones that are waiting to be taken by FX0A.
+	// The quirks line is optional, and recordings without it use the default profile.
+	class InputRecording
+	{
+	public:
+		static const int FORMAT_VERSION = 1;
+
+		struct Event
+		{
+			uint64_t frame;
+			uint64_t instruction;
+			uint16_t keyStates;
+			uint16_t releasedKeyStates;
+		};
+
+		void Clear();
+		void AddEvent(const Event& event);
+		const std::vector<Event>& GetEvents();
+
+		uint64_t GetSeed();
+		void SetSeed(uint64_t seed);
+		int GetInstructionsPerSecond();
+		void SetInstructionsPerSecond(int instructionsPerSecond);
+		int GetFrameCount();
+		void SetFrameCount(int frameCount);
+		QuirkProfile GetQuirkProfile();
+		void SetQuirkProfile(QuirkProfile quirkProfile);
+
+		bool SaveToFile(std::string filePath);
+		bool LoadFromFile(std::string filePath);
+
+	private:
+		std::vector<Event> events;
+		uint64_t seed{};
+		int instructionsPerSecond{};
+		int frameCount{};
+		QuirkProfile quirkProfile = QuirkProfile::Default;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "CPU.hpp"
+
+namespace SHG
+{
+	// Pointers to the machine state that compiled code reads and writes. 
+	// The CPU's registers are loaded into host registers when a compiled block starts, and written back when it exits.
+	struct JitContext
+	{
+		CPU* cpu;
+		uint8_t* vRegisters;
+		uint16_t* iRegister;
+		uint16_t* programCounter;
+		uint16_t* timerRegisters;
+		const uint8_t* memory;
+	};
+
+	// Translates basic blocks into native x86-64 code. Instructions that aren't translated 
+	// (e.g. DXYN, FX0A and the key instructions) are executed by calling back into the interpreter.
+	class JitCompiler
+	{
+	public:
+		typedef void (*NativeBlock)(JitContext* context);
+		typedef void (*FallbackFunction)(CPU* cpu, const CPU::DecodedInstruction* instruction);
+
+		static bool IsSupported();
+
+		// Translated instructions follow the given quirks, and the fallback is expected to follow the same ones
+		JitCompiler(JitContext context, FallbackFunction fallback, QuirkSettings quirks);
+		JitCompiler(const JitCompiler&) = delete;
+		JitCompiler& operator=(const JitCompiler&) = delete;
+		~JitCompiler();
+
+		// Compiles as many of the instructions as possible, starting at the given address. 
+		// Returns null if the code buffer is full or nothing could be compiled.
+		NativeBlock Compile(uint16_t startAddress, const CPU::DecodedInstruction* instructions, int count, int* compiledCount);
+
+		// Returns true when there's no room left for another block
+		bool IsFull();
+
+		// Discards all compiled code
+		void Reset();
+
+		void Run(NativeBlock block) { block(&context); }
+
+	private:
+		JitContext context;
+		FallbackFunction fallback;
+		QuirkSettings quirks;
+
+		uint8_t* codeBuffer{};
+		size_t codeBufferSize{};
+		size_t codeBufferUsed{};
+	};
+}
\ No newline at end of file
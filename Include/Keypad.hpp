@@ -1,19 +1,48 @@
 #pragma once
 #include <cstdint>
-#include <map>
-#include <SDL.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
 
 namespace SHG
 {
 	class Keypad
 	{
 	public:
-		Keypad();
+		static const int KEY_COUNT = 16;
+
 		bool IsKeyPressed(uint8_t key);
-		void Update(SDL_Event e);
-		bool GetKeyPressedThisFrame(uint8_t* key);
+		void SetKeyState(uint8_t key, bool isPressed);
+
+		// Bit masks of the pressed keys and of the keys that are waiting to be taken by GetReleasedKey, with key 0 in the lowest bit
+		uint16_t GetKeyStates();
+		uint16_t GetReleasedKeyStates();
+		void SetKeyStates(uint16_t keyStates, uint16_t releasedKeyStates);
+
+		// Takes the lowest key that has been released since the released keys were last cleared.
+		// Returns false if no key has been released.
+		bool GetReleasedKey(uint8_t* key);
+		void ClearReleasedKeys();
+		void ClearReleasedKey(uint8_t key);
+
+		// Blocks the calling thread until a key is pressed or released, or until the deadline has passed
+		void WaitForKeyEvent(std::chrono::steady_clock::time_point deadline);
+
+		// Changes every time a key is pressed or released
+		uint32_t GetKeyEventCount();
 
 	private:
-		std::map<uint8_t, bool> keyStates;
+		// One bit per key, with key 0 in the lowest bit. 
+		// Keys are set by the host's event thread while the CPU reads them on the emulation thread.
+		std::atomic<uint16_t> keyStates{ 0 };
+
+		// One bit per key that went from pressed to released
+		std::atomic<uint16_t> releasedKeyStates{ 0 };
+
+		// Used to wake up threads waiting for a key event. The counter changes with every event.
+		std::mutex keyEventMutex;
+		std::condition_variable keyEventCondition;
+		uint32_t keyEventCount{};
 	};
 }
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Memory.hpp"
+#include "Display.hpp"
+#include "Keypad.hpp"
+#include "CPU.hpp"
+
+namespace SHG
+{
+	// Runs LANE_COUNT machines with the same ROM in lockstep. The registers of all machines are stored
+	// as structure-of-arrays (e.g. V3 of every lane is one contiguous array), so when the lanes are at the
+	// same address, the instruction is executed for all of them at once with AVX2. Lanes that are at
+	// different addresses, and instructions that touch memory, the screen or the keypad, run one lane at a time.
+	// Every lane gives exactly the same results as a separate CPU running the same ROM with the same input.
+	// Only CHIP-8 instructions are supported, so SUPER-CHIP and XO-CHIP ROMs have to run on a CPU. A lane that 
+	// reaches any other instruction fails, and stops without executing it.
+	class LockstepBatch
+	{
+	public:
+		// One lane per byte of a 256-bit register
+		static const int LANE_COUNT = 32;
+
+		LockstepBatch();
+		LockstepBatch(const LockstepBatch&) = delete;
+		LockstepBatch& operator=(const LockstepBatch&) = delete;
+
+		static bool IsAvx2Supported();
+
+		// Loads the same ROM into every lane
+		bool LoadRom(const uint8_t* rom, int size);
+
+		void RunFrames(int instructionsPerSecond, int frameCount);
+		void RunFrame(int instructionCount);
+
+		Display& GetDisplay(int lane);
+		Keypad& GetKeypad(int lane);
+		void SaveRegisters(int lane, CPU::RegisterState* state);
+		uint64_t GetInstructionCount(int lane);
+
+		// Returns true if the lane stopped at an instruction that isn't supported, in which case its results aren't valid
+		bool HasLaneFailed(int lane);
+
+		// Each lane has its own generator for CXKK, which gives the same numbers as a CPU with the same seed
+		void SetRandomSeed(int lane, uint64_t seed);
+
+		// Allows the AVX2 path to be turned off, e.g. to compare it with the scalar path. It's enabled by default if it's supported.
+		void SetAvx2Enabled(bool isEnabled);
+
+		// How many times an instruction was executed for several lanes at once, and for a single lane
+		uint64_t GetVectorInstructionCount();
+		uint64_t GetScalarInstructionCount();
+
+	private:
+		static const uint8_t DELAY_TIMER_INDEX = 0;
+		static const uint8_t SOUND_TIMER_INDEX = 1;
+		static const uint8_t VF_REG_INDEX = 15;
+
+		// Registers, with one array of lanes per register
+		alignas(32) uint8_t vRegisters[CPU::REGISTER_COUNT][LANE_COUNT]{};
+		alignas(32) uint16_t programCounters[LANE_COUNT]{};
+		uint16_t iRegisters[LANE_COUNT]{};
+		uint16_t timerRegisters[2][LANE_COUNT]{};
+		uint16_t stacks[CPU::STACK_SIZE][LANE_COUNT]{};
+		uint8_t stackPointers[LANE_COUNT]{};
+
+		// One full copy of memory per lane
+		std::vector<uint8_t> memories;
+
+		// Set for every address that any lane has written to. Lanes can only be assumed to fetch
+		// the same instruction from the same address if neither of its bytes has been written to.
+		bool isAddressWritten[Memory::TOTAL_MEMORY]{};
+
+		Display displays[LANE_COUNT];
+		Keypad keypads[LANE_COUNT];
+		Random randoms[LANE_COUNT];
+
+		// Lanes waiting for a key in FX0A, and the register that receives the key
+		uint32_t waitingLanes{};
+		uint8_t keyWaitRegisters[LANE_COUNT]{};
+
+		// Lanes that reached an instruction that isn't supported
+		uint32_t failedLanes{};
+
+		uint64_t instructionCounts[LANE_COUNT]{};
+		uint64_t vectorInstructionCount{};
+		uint64_t scalarInstructionCount{};
+
+		int instructionsPerSecond = 800;
+		int frameInstructionRemainder{};
+		bool isAvx2Enabled = false;
+
+		int GetFrameInstructionCount();
+		void UpdateTimers();
+		void Step(uint32_t activeLanes);
+		uint16_t FetchInstruction(int lane, uint16_t address);
+		uint32_t GetLanesAtAddress(uint16_t address, uint32_t lanes);
+
+		// Executes an instruction for every lane in the mask at once. Returns false if the instruction
+		// can't be vectorised, in which case nothing has been changed.
+		bool ExecuteVector(uint16_t instruction, uint32_t lanes);
+		bool ExecuteVectorAvx2(uint16_t instruction, uint32_t lanes);
+
+		// Executes an instruction for a single lane, in the same way as the CPU's handlers, or fails the lane if it isn't supported
+		void ExecuteLane(int lane, uint16_t instruction);
+	};
+}
\ No newline at end of file
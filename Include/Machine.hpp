@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <memory>
+#include "Memory.hpp"
+#include "Display.hpp"
+#include "Keypad.hpp"
+#include "CPU.hpp"
+#include "HeadlessHost.hpp"
+
+namespace SHG
+{
+	class RewindBuffer;
+
+	// One complete emulated machine. Each machine owns all of its state, 
+	// so any number of machines can run at the same time on different threads.
+	class Machine
+	{
+	public:
+		// Written at the start of every save state, followed by the version of its layout. 
+		// The version must be increased whenever State changes.
+		static const uint32_t STATE_MAGIC = 0x53533843; // "C8SS"
+		static const uint32_t STATE_VERSION = 4;
+
+		// A snapshot of the whole machine. It doesn't contain any pointers, so it's saved and restored with a few copies, 
+		// and save state files are simply this struct as it is laid out in memory (in the host's byte order).
+		struct State
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t size;
+			uint8_t memory[Memory::TOTAL_MEMORY];
+			Display::Screen screen;
+			CPU::State cpu;
+			uint16_t keyStates;
+			uint16_t releasedKeyStates;
+		};
+
+		Machine();
+		Machine(const Machine&) = delete;
+		Machine& operator=(const Machine&) = delete;
+		~Machine();
+
+		bool LoadRom(std::string filePath);
+		bool LoadRom(const uint8_t* rom, int size);
+
+		// Runs the machine at real-time speed in the host's window, until the host is closed
+		void StartCycle(Host* host, int instructionsPerSecond);
+
+		// Runs the given number of frames headless, as fast as possible
+		void RunFrames(int instructionsPerSecond, int frameCount);
+
+		// Returns a hash of the screen, which can be used to compare the output of two runs
+		uint64_t GetFramebufferHash();
+
+		// Cheap enough to be called every frame. Must not be called while the CPU is running on another thread.
+		void SaveState(State* state);
+
+		// Returns false, without changing anything, if the state was saved by a different version of the emulator
+		bool LoadState(const State& state);
+
+		bool SaveStateToFile(std::string filePath);
+		bool LoadStateFromFile(std::string filePath);
+
+		// Records a state every frame, using at most the given number of bytes. While the host requests a rewind, 
+		// the machine steps back one recorded frame per frame instead of running.
+		void EnableRewind(Host* host, size_t capacity);
+
+		// After every frame, saves the state, runs the given number of frames further with the keys that are held now, 
+		// and presents the last of them. The saved state is restored before the next frame, so the ROM's own 
+		// input lag (e.g. reading keys one frame and drawing the next) is hidden from the player.
+		void EnableRunAhead(int frameCount);
+
+		Memory& GetMemory();
+		Display& GetDisplay();
+		Keypad& GetKeypad();
+		CPU& GetCPU();
+		HeadlessHost& GetHeadlessHost();
+
+	private:
+		Memory memory;
+		Display display;
+		Keypad keypad;
+		CPU cpu;
+		HeadlessHost headlessHost;
+
+		std::unique_ptr<RewindBuffer> rewindBuffer;
+		std::unique_ptr<State> rewindState;
+		Host* rewindHost{};
+
+		// Set while the machine's state is the newest frame in the rewind buffer, so it doesn't have to be recorded again
+		bool isRewound = false;
+
+		int runAheadFrameCount{};
+		std::unique_ptr<State> runAheadState;
+
+		// Set while the machine is ahead of its real state, which is stored in runAheadState
+		bool isRunningAhead = false;
+
+		void SetFrameHook();
+		bool UpdateFrame();
+		bool UpdateRewind();
+		void RunAhead();
+		void RestoreRunAheadState();
+	};
+}
\ No newline at end of file
@@ -1,23 +1,59 @@
 #pragma once
+#include <cstdint>
 #include <string>
 
 namespace SHG
 {
+	// Notified when a byte that belongs to cached code is overwritten
+	class CodeWriteListener
+	{
+	public:
+		virtual ~CodeWriteListener() = default;
+		virtual void OnCodeWrite(int address) = 0;
+	};
+
+	class Profiler;
+
 	class Memory
 	{
 	public:
-		static const int TOTAL_MEMORY = 4096;
+		// XO-CHIP programs can address 64 KB. CHIP-8 and SUPER-CHIP programs only use the first 4 KB of it.
+		static const int TOTAL_MEMORY = 0x10000;
 		static const int RESERVED_MEMORY_SIZE = 512;
 		static const int MAX_ROM_SIZE = TOTAL_MEMORY - RESERVED_MEMORY_SIZE;
+		static const int CHIP8_MEMORY = 0x1000;
+		static const int MAX_CHIP8_ROM_SIZE = CHIP8_MEMORY - RESERVED_MEMORY_SIZE;
 		static const int FONT_SPRITE_SIZE = 5;
 		static const int NUMBER_OF_FONT_SPRITES = 16;
 
+		// SUPER-CHIP's 8x10 font sprites (FX30) are stored right after the small ones
+		static const int BIG_FONT_ADDRESS = FONT_SPRITE_SIZE * NUMBER_OF_FONT_SPRITES;
+		static const int BIG_FONT_SPRITE_SIZE = 10;
+
 		Memory();
 		bool LoadRom(std::string filePath);
+		bool LoadRom(const uint8_t* rom, int size);
 		const uint8_t* GetData();
+		void SetData(const uint8_t* source);
+
+		// Replaces all of memory, like SetData, but cached code is notified about every byte of it that changes
+		void RestoreData(const uint8_t* source);
 		void SetByte(int address, uint8_t byte);
 		uint8_t GetByte(int address);
+
+		void SetCodeWriteListener(CodeWriteListener* listener);
+		void AddCodeReference(int address, int size);
+		void RemoveCodeReference(int address, int size);
+
+		// Counts every byte written with SetByte in the profile, or stops counting if it's null
+		void SetProfiler(Profiler* profiler);
+
 	private:
-		uint8_t data[4096]{};
+		uint8_t data[TOTAL_MEMORY]{};
+
+		// How many cached code blocks contain each byte
+		uint8_t codeReferenceCounts[TOTAL_MEMORY]{};
+		CodeWriteListener* codeWriteListener{};
+		Profiler* profiler{};
 	};
 }
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "Memory.hpp"
+
+namespace SHG
+{
+	// Counts where a ROM spends its time: how often each kind of instruction and each address is executed, 
+	// how long the host takes for each kind of instruction, how many sprite pixels are drawn and how many bytes 
+	// are written to memory. Call stacks are also counted, for flame graphs.
+	//
+	// The CPU fills in the profile while one is set, see CPU::SetProfiler.
+	class Profiler
+	{
+	public:
+		// One family per instruction handler, plus one for unknown instructions. 
+		// The CPU assigns them to its handlers, see CPU::GetProfilerFamily.
+		enum Family
+		{
+			FAMILY_UNKNOWN, FAMILY_0NNN, FAMILY_00E0, FAMILY_00EE, FAMILY_1NNN, FAMILY_2NNN, FAMILY_3XKK, FAMILY_4XKK,
+			FAMILY_5XY0, FAMILY_6XKK, FAMILY_7XKK, FAMILY_8XY0, FAMILY_8XY1, FAMILY_8XY2, FAMILY_8XY3, FAMILY_8XY4,
+			FAMILY_8XY5, FAMILY_8XY6, FAMILY_8XY7, FAMILY_8XYE, FAMILY_9XY0, FAMILY_ANNN, FAMILY_BNNN, FAMILY_CXKK,
+			FAMILY_DXYN, FAMILY_EX9E, FAMILY_EXA1, FAMILY_FX07, FAMILY_FX0A, FAMILY_FX15, FAMILY_FX18, FAMILY_FX1E,
+			FAMILY_FX29, FAMILY_FX33, FAMILY_FX55, FAMILY_FX65, FAMILY_00CN, FAMILY_00DN, FAMILY_00FB, FAMILY_00FC,
+			FAMILY_00FD, FAMILY_00FE, FAMILY_00FF, FAMILY_5XY2, FAMILY_5XY3, FAMILY_F000, FAMILY_FN01, FAMILY_FX30,
+			FAMILY_FX75, FAMILY_FX85, FAMILY_F002, FAMILY_FX3A,
+			FAMILY_COUNT
+		};
+
+		Profiler();
+
+		static const char* GetFamilyName(int family);
+
+		void AddInstruction(uint16_t address, int family, uint64_t nanoseconds);
+		void AddPixels(uint64_t count);
+		void AddMemoryWrites(uint64_t count);
+
+		// Sets the call stack that the following instructions are counted for. 
+		// Functions are given by their start address, starting with the outermost call.
+		void SetCallStack(const uint16_t* functions, int depth);
+
+		uint64_t GetInstructionCount();
+		uint64_t GetFamilyCount(int family);
+		uint64_t GetFamilyNanoseconds(int family);
+		uint64_t GetAddressCount(uint16_t address);
+		uint64_t GetPixelCount();
+		uint64_t GetMemoryWriteCount();
+
+		// Writes the totals, every instruction family that was executed, and every address that was executed
+		bool SaveJson(std::string filePath);
+
+		// Writes one line per call stack, e.g. "main;sub_2A4;sub_310 1200", with the number of instructions 
+		// executed in it. This is the folded format used by flamegraph.pl, speedscope and others.
+		bool SaveFoldedStacks(std::string filePath);
+
+	private:
+		uint64_t instructionCount{};
+		uint64_t familyCounts[FAMILY_COUNT]{};
+		uint64_t familyNanoseconds[FAMILY_COUNT]{};
+		// One count per address of the 64 KB memory, which is too large to keep inside the profiler itself
+		std::vector<uint64_t> addressCounts;
+		uint64_t pixelCount{};
+		uint64_t memoryWriteCount{};
+
+		// The time it takes to read the clock, which is taken off every measurement
+		uint64_t clockOverhead{};
+
+		// Folded call stacks, and the number of instructions executed in each of them
+		std::unordered_map<std::string, size_t> stackIndices;
+		std::vector<std::string> stacks;
+		std::vector<uint64_t> stackCounts;
+		size_t currentStack{};
+	};
+}
\ No newline at end of file
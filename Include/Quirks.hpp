@@ -0,0 +1,126 @@
+#pragma once
+#include <string>
+
+namespace SHG
+{
+	// Instructions that behave differently on different CHIP-8 platforms. Each profile is a set of compile-time 
+	// constants, and the CPU's handlers for these instructions are instantiated once per profile, so choosing 
+	// a profile picks a set of handlers instead of adding checks to them.
+
+	// The behavior this emulator has always had, which most modern CHIP-8 ROMs expect
+	struct DefaultQuirks
+	{
+		// 8XY1, 8XY2 and 8XY3 set VF to 0
+		static const bool IS_FLAG_RESET = false;
+
+		// 8XY5, 8XY6, 8XY7 and 8XYE write VF after the result instead of before it, which matters when X is F
+		static const bool IS_FLAG_WRITTEN_LAST = false;
+
+		// 8XY6 and 8XYE shift VY into VX, instead of shifting VX in place
+		static const bool IS_SHIFTING_VY = false;
+
+		// FX55 and FX65 leave I pointing after the last register
+		static const bool IS_INCREMENTING_I = false;
+
+		// BNNN is BXNN, which jumps to XNN + VX instead of NNN + V0
+		static const bool IS_JUMPING_WITH_VX = false;
+
+		// Sprites are cut off at the edges of the screen instead of wrapping around
+		static const bool IS_CLIPPING = true;
+	};
+
+	// The original COSMAC VIP interpreter
+	struct VipQuirks
+	{
+		static const bool IS_FLAG_RESET = true;
+		static const bool IS_FLAG_WRITTEN_LAST = true;
+		static const bool IS_SHIFTING_VY = true;
+		static const bool IS_INCREMENTING_I = true;
+		static const bool IS_JUMPING_WITH_VX = false;
+		static const bool IS_CLIPPING = true;
+	};
+
+	// SUPER-CHIP 1.1 on the HP 48
+	struct SchipQuirks
+	{
+		static const bool IS_FLAG_RESET = false;
+		static const bool IS_FLAG_WRITTEN_LAST = true;
+		static const bool IS_SHIFTING_VY = false;
+		static const bool IS_INCREMENTING_I = false;
+		static const bool IS_JUMPING_WITH_VX = true;
+		static const bool IS_CLIPPING = true;
+	};
+
+	// XO-CHIP, as implemented by Octo
+	struct XoChipQuirks
+	{
+		static const bool IS_FLAG_RESET = false;
+		static const bool IS_FLAG_WRITTEN_LAST = true;
+		static const bool IS_SHIFTING_VY = true;
+		static const bool IS_INCREMENTING_I = true;
+		static const bool IS_JUMPING_WITH_VX = false;
+		static const bool IS_CLIPPING = false;
+	};
+
+	enum class QuirkProfile
+	{
+		Default,
+		Vip,
+		Schip,
+		XoChip
+	};
+
+	// The constants of a profile as values, for code that is generated at runtime (the JIT), 
+	// and for code that isn't worth instantiating per profile
+	struct QuirkSettings
+	{
+		bool isFlagReset;
+		bool isFlagWrittenLast;
+		bool isShiftingVy;
+		bool isIncrementingI;
+		bool isJumpingWithVx;
+		bool isClipping;
+
+		template<typename Quirks>
+		static QuirkSettings Create()
+		{
+			return { Quirks::IS_FLAG_RESET, Quirks::IS_FLAG_WRITTEN_LAST, Quirks::IS_SHIFTING_VY, 
+				Quirks::IS_INCREMENTING_I, Quirks::IS_JUMPING_WITH_VX, Quirks::IS_CLIPPING };
+		}
+
+		static QuirkSettings Create(QuirkProfile profile)
+		{
+			switch (profile)
+			{
+			case QuirkProfile::Vip: return Create<VipQuirks>();
+			case QuirkProfile::Schip: return Create<SchipQuirks>();
+			case QuirkProfile::XoChip: return Create<XoChipQuirks>();
+			default: return Create<DefaultQuirks>();
+			}
+		}
+	};
+
+	// Names as used on the command line and in input recordings: "default", "vip", "schip" and "xo-chip". 
+	// Returns false if the name isn't known.
+	inline bool ParseQuirkProfile(std::string name, QuirkProfile* profile)
+	{
+		if (name == "default") *profile = QuirkProfile::Default;
+		else if (name == "vip") *profile = QuirkProfile::Vip;
+		else if (name == "schip") *profile = QuirkProfile::Schip;
+		else if (name == "xo-chip") *profile = QuirkProfile::XoChip;
+		else return false;
+
+		return true;
+	}
+
+	inline std::string GetQuirkProfileName(QuirkProfile profile)
+	{
+		switch (profile)
+		{
+		case QuirkProfile::Vip: return "vip";
+		case QuirkProfile::Schip: return "schip";
+		case QuirkProfile::XoChip: return "xo-chip";
+		default: return "default";
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+
+namespace SHG
+{
+	// xoshiro256** random number generator. Every machine has its own, so the numbers it produces 
+	// don't depend on any other machine or thread, and the same seed always gives the same sequence.
+	class Random
+	{
+	public:
+		static const int STATE_SIZE = 4;
+
+		explicit Random(uint64_t seed = 0)
+		{
+			Seed(seed);
+		}
+
+		void Seed(uint64_t seed)
+		{
+			// The state is filled with SplitMix64, so similar seeds still give unrelated sequences, and the state is never all zeros
+			for (uint64_t& word : state)
+			{
+				seed += 0x9E3779B97F4A7C15;
+
+				uint64_t z = seed;
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+				word = z ^ (z >> 31);
+			}
+		}
+
+		uint64_t Next()
+		{
+			uint64_t result = RotateLeft(state[1] * 5, 7) * 9;
+			uint64_t t = state[1] << 17;
+
+			state[2] ^= state[0];
+			state[3] ^= state[1];
+			state[1] ^= state[2];
+			state[0] ^= state[3];
+			state[2] ^= t;
+			state[3] = RotateLeft(state[3], 45);
+
+			return result;
+		}
+
+		// Returns a random byte, with every value from 0 to 255 equally likely
+		uint8_t NextByte()
+		{
+			// The upper bits are the most random ones
+			return (uint8_t)(Next() >> 56);
+		}
+
+		void GetState(uint64_t* destination)
+		{
+			for (int i = 0; i < STATE_SIZE; i++) destination[i] = state[i];
+		}
+
+		void SetState(const uint64_t* source)
+		{
+			for (int i = 0; i < STATE_SIZE; i++) state[i] = source[i];
+		}
+
+	private:
+		uint64_t state[STATE_SIZE];
+
+		static uint64_t RotateLeft(uint64_t value, int shift)
+		{
+			return (value << shift) | (value >> (64 - shift));
+		}
+	};
+}
\ No newline at end of file
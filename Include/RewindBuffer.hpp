@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "Machine.hpp"
+
+namespace SHG
+{
+	// Keeps the recent history of a machine in a fixed amount of memory. Only the newest state is stored in full. 
+	// Every older frame is stored as the XOR of itself and the frame after it, with runs of zeros removed, 
+	// so stepping back one frame only decodes a few bytes. Every keyframeInterval frames, a full (run-length encoded) 
+	// copy of the frame is stored as well, so jumping back a long way doesn't have to go through every frame in between.
+	// Once the memory is used up, the oldest frames are dropped.
+	class RewindBuffer
+	{
+	public:
+		RewindBuffer(size_t capacity, int keyframeInterval);
+		RewindBuffer(const RewindBuffer&) = delete;
+		RewindBuffer& operator=(const RewindBuffer&) = delete;
+
+		// Adds a state as the newest frame
+		void Push(const Machine::State& state);
+
+		// Removes the newest frame, and copies the frame before it into the given state. 
+		// Returns false if there are no older frames.
+		bool StepBack(Machine::State* state);
+
+		// Removes the given number of newest frames, or as many as there are, and copies the frame that is newest after that 
+		// into the given state. Returns false if there are no older frames.
+		bool Rewind(int frameCount, Machine::State* state);
+
+		void Clear();
+
+		// How many frames the buffer can step back
+		int GetFrameCount();
+
+		// How many bytes are used by the frames that are currently stored, not counting the newest state
+		size_t GetUsedBytes();
+
+	private:
+		// Runs of fewer zero bytes than this are kept in a literal run, since starting a new run would take more space
+		static const int MIN_ZERO_RUN_LENGTH = 3;
+
+		// The encoded form of one frame in the storage ring: the delta from the frame after it, 
+		// followed by the keyframe if it has one
+		struct Entry
+		{
+			size_t offset;
+			uint32_t deltaSize;
+			uint32_t keyframeSize;
+		};
+
+		std::vector<uint8_t> storage;
+		std::deque<Entry> entries;
+		std::vector<uint8_t> encodeBuffer;
+		Machine::State newestState{};
+		Machine::State zeroState{};
+		bool hasNewestState = false;
+		int keyframeInterval;
+		int framesSinceKeyframe{};
+		size_t usedBytes{};
+
+		// Appends runs of [zero byte count][literal byte count][literal bytes] that describe the XOR of the two states
+		static void EncodeDelta(const uint8_t* first, const uint8_t* second, std::vector<uint8_t>* output);
+
+		// XORs an encoded delta onto the given state
+		static void ApplyDelta(const uint8_t* delta, size_t deltaSize, uint8_t* state);
+
+		// Finds room for the given number of bytes in the storage ring, dropping the oldest frames as needed
+		size_t Allocate(size_t size);
+		void RemoveOldestEntry();
+		void RemoveNewestEntry();
+	};
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace SHG
+{
+	// Lock-free queue for passing values from one producer thread to one consumer thread, in order.
+	// The capacity is rounded up to a power of two, so positions can be wrapped with a mask. Each side only 
+	// writes its own position, and reads the other side's position to see how much space or data there is.
+	template<typename T>
+	class RingBuffer
+	{
+	public:
+		explicit RingBuffer(size_t capacity)
+		{
+			size_t size = 1;
+			while (size < capacity) size *= 2;
+
+			values.resize(size);
+			mask = size - 1;
+		}
+
+		RingBuffer(const RingBuffer&) = delete;
+		RingBuffer& operator=(const RingBuffer&) = delete;
+
+		// Adds a value at the end. Returns false if the buffer is full, in which case nothing is added.
+		bool Push(const T& value)
+		{
+			uint64_t position = writePosition.load(std::memory_order_relaxed);
+
+			// The consumer's position is only reloaded when the buffer looks full, so it isn't read for every value
+			if (position - cachedReadPosition > mask)
+			{
+				cachedReadPosition = readPosition.load(std::memory_order_acquire);
+				if (position - cachedReadPosition > mask) return false;
+			}
+
+			values[position & mask] = value;
+			writePosition.store(position + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		// Copies up to maxCount values from the front into the output, and removes them. Returns how many were copied.
+		size_t Pop(T* output, size_t maxCount)
+		{
+			uint64_t position = readPosition.load(std::memory_order_relaxed);
+			uint64_t available = writePosition.load(std::memory_order_acquire) - position;
+			size_t count = (size_t)std::min<uint64_t>(available, maxCount);
+
+			for (size_t i = 0; i < count; i++) output[i] = values[(position + i) & mask];
+			readPosition.store(position + count, std::memory_order_release);
+
+			return count;
+		}
+
+		size_t GetCapacity()
+		{
+			return values.size();
+		}
+
+		// How many values are waiting to be popped. The other thread may change it right after it's read.
+		size_t GetCount()
+		{
+			return (size_t)(writePosition.load(std::memory_order_acquire) - readPosition.load(std::memory_order_acquire));
+		}
+
+	private:
+		std::vector<T> values;
+		uint64_t mask;
+
+		// Each position is on its own cache line, so the two threads don't keep taking the line from each other
+		alignas(64) std::atomic<uint64_t> writePosition{ 0 };
+		uint64_t cachedReadPosition = 0;
+		alignas(64) std::atomic<uint64_t> readPosition{ 0 };
+	};
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace SHG
+{
+	// An index of every ROM in a directory and its subdirectories, with the size, SHA-1 hash and platform of each.
+	// The index is cached in the directory, and later scans only read the files that were added or changed since.
+	//
+	// The cache is a text file:
+	//     chip8-library 1
+	//     <sha1> <size> <modification-time> <platform> <path>
+	//     ...
+	// Paths are relative to the directory, and use '/' as the separator.
+	class RomLibrary
+	{
+	public:
+		static const int FORMAT_VERSION = 1;
+
+		// The most that any CHIP-8 platform can address. Larger files can't be ROMs.
+		static const int MAX_FILE_SIZE = 0x10000;
+
+		struct Entry
+		{
+			std::string path;
+			uint64_t size;
+			int64_t modificationTime;
+			std::string sha1;
+			std::string platform;
+		};
+
+		// Reads a whole file with a single read. Returns false if it can't be read or is larger than MAX_FILE_SIZE.
+		static bool ReadRom(std::string filePath, std::vector<uint8_t>* rom);
+
+		// Guesses the platform a ROM was written for ("chip-8", "schip" or "xo-chip") from its extension, its size, 
+		// and the instructions that only exist on later platforms
+		static std::string DetectPlatform(const uint8_t* rom, size_t size, std::string filePath);
+
+		// Indexes the directory and writes the cache. Returns false if the directory can't be read.
+		bool Scan(std::string directory);
+		const std::vector<Entry>& GetEntries();
+
+		// How many ROMs the last scan read and hashed, and how many it took from the cache
+		int GetHashedCount();
+		int GetCachedCount();
+
+		bool SaveToFile(std::string filePath);
+		bool LoadFromFile(std::string filePath);
+
+	private:
+		std::vector<Entry> entries;
+		int hashedCount{};
+		int cachedCount{};
+
+		static bool IsRomFile(std::string fileName);
+		static bool ListFiles(std::string directory, std::string relativePath, std::vector<Entry>* files);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+#include <string>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <SDL.h>
+#include "Host.hpp"
+#include "RingBuffer.hpp"
+
+namespace SHG
+{
+	// Host that renders the framebuffer into an SDL window, reads input from the SDL event queue, 
+	// and plays the sound through the default SDL audio device.
+	class SDLHost : public Host
+	{
+	public:
+		static const std::string DEFAULT_KEY_LAYOUT;
+
+		// If vsync is enabled, presenting a frame waits for the display's next refresh.
+		SDLHost(int width, int height, bool isVsyncEnabled);
+		SDLHost(const SDLHost&) = delete;
+		SDLHost& operator=(const SDLHost&) = delete;
+		~SDLHost();
+
+		bool ProcessEvents(Keypad* keypad) override;
+		void Present(Display* display) override;
+
+		// True while the rewind key (Backspace) is held
+		bool IsRewindRequested() override;
+
+		// Binds the keyboard keys named in the layout to CHIP-8 keys 0 to F, in that order. 
+		// Keys are matched by their physical position, so the layout works on any keyboard language. 
+		// Returns false, and keeps the current bindings, if any key name is invalid.
+		bool SetKeyLayout(const std::string& layout);
+
+		// Opens the audio device with a buffer of the given number of samples. Smaller buffers lower the latency, 
+		// but the emulation thread has to queue each frame's sound sooner. If the audio clock is enabled, 
+		// the emulation is paced by the device instead of the system clock. Returns false if there's no audio device.
+		bool OpenAudio(int bufferSize, bool isAudioClockEnabled);
+
+		void QueueAudio(const Sound& sound) override;
+		bool IsAudioClockEnabled() override;
+		void WaitForAudioClock() override;
+
+		// Times the audio device needed samples that the emulation thread hadn't queued yet
+		uint64_t GetAudioUnderrunCount();
+
+		// Frames of sound that were dropped because the emulation was too far ahead of the audio device
+		uint64_t GetDroppedAudioFrameCount();
+
+	private:
+		// The color of each combination of the two planes: off, first plane, second plane and both
+		static constexpr uint32_t PIXEL_COLORS[] = { 0xFF000000, 0xFFFFFFFF, 0xFFAAAAAA, 0xFF555555 };
+		static constexpr uint8_t UNBOUND_KEY = 0xFF;
+		static const SDL_Scancode REWIND_SCANCODE = SDL_SCANCODE_BACKSPACE;
+		static const int AUDIO_SAMPLE_RATE = 48000;
+
+		int screenWidth{};
+		int screenHeight{};
+
+		SDL_Window* window{};
+		SDL_Renderer* renderer{};
+
+		// Holds the framebuffer at the high resolution. The renderer scales it up to the size of the window.
+		SDL_Texture* screenTexture{};
+
+		// The CHIP-8 key for every scancode, so a key event is mapped with a single array lookup
+		uint8_t keyBindings[SDL_NUM_SCANCODES];
+
+		// Set on the event thread and read on the emulation thread
+		std::atomic<bool> isRewindKeyHeld{ false };
+
+		// Set when the whole texture has to be uploaded again, e.g. before the first frame
+		bool isFullUploadNeeded{ true };
+
+		// Set when the window has to be redrawn even if the screen hasn't changed
+		bool isRedrawNeeded{ true };
+
+		SDL_AudioDeviceID audioDevice{};
+		int audioBufferSize{};
+		int audioSampleRate{};
+		bool isAudioClockEnabled = false;
+
+		// The device stays paused until the first frame of sound has been queued
+		bool isAudioPaused = true;
+
+		// Filled by the emulation thread and drained by the audio callback
+		std::unique_ptr<RingBuffer<int16_t>> audioSamples;
+		std::unique_ptr<SoundGenerator> soundGenerator;
+
+		// Used only on the emulation thread
+		std::vector<int16_t> frameSamples;
+		int audioSampleRemainder{};
+		size_t maxQueuedSampleCount{};
+		uint64_t droppedAudioFrameCount{};
+
+		std::atomic<uint64_t> audioUnderrunCount{ 0 };
+
+		static void SDLCALL FillAudioBuffer(void* userData, Uint8* stream, int length);
+		void UpdateScreenTexture(Display* display, const SDL_Rect& rect);
+	};
+}
\ No newline at end of file
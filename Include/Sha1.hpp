@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace SHG
+{
+	// SHA-1 hash, used to identify ROMs by their contents. It isn't used for anything security-related.
+	class Sha1
+	{
+	public:
+		static const int DIGEST_SIZE = 20;
+
+		Sha1();
+
+		void Update(const uint8_t* data, size_t size);
+
+		// Finishes the hash and returns it as 40 lowercase hexadecimal digits. Update can't be called afterwards.
+		std::string Finish();
+
+		static std::string Hash(const uint8_t* data, size_t size);
+
+	private:
+		static const int BLOCK_SIZE = 64;
+
+		uint32_t state[5];
+		uint8_t block[BLOCK_SIZE]{};
+		size_t blockSize{};
+		uint64_t totalSize{};
+
+		void ProcessBlock(const uint8_t* data);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+
+namespace SHG
+{
+	// What the machine plays during one frame
+	struct Sound
+	{
+		static const int PATTERN_SIZE = 16;
+
+		// True while the sound timer is running
+		bool isPlaying;
+
+		// XO-CHIP's 1-bit sample pattern (F002), played from the highest bit of the first byte, and its pitch (FX3A)
+		uint8_t pattern[PATTERN_SIZE];
+		uint8_t pitch;
+	};
+
+	// Turns the sound of each frame into 16-bit mono samples. The position in the pattern carries over 
+	// from one frame to the next, so a tone that lasts several frames has no seams.
+	class SoundGenerator
+	{
+	public:
+		// At this pitch, the pattern is played at 4000 bits per second. Every 48 steps double or halve the rate.
+		static const uint8_t DEFAULT_PITCH = 64;
+
+		// The pattern of CHIP-8's beeper, used until a program loads its own: a 500 Hz square wave at the default pitch
+		static constexpr uint8_t BEEPER_PATTERN_BYTE = 0xF0;
+
+		explicit SoundGenerator(int sampleRate);
+
+		void Generate(const Sound& sound, int16_t* samples, int count);
+
+	private:
+		static const int16_t AMPLITUDE = 6000;
+
+		int sampleRate;
+
+		// The current bit of the pattern, including the fraction of it that has already been played
+		double position{};
+	};
+}
\ No newline at end of file
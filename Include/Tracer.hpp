@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <ostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include "RingBuffer.hpp"
+
+// Building with SHG_TRACE_ENABLED set to 0 leaves tracing out of the CPU completely
+#ifndef SHG_TRACE_ENABLED
+#define SHG_TRACE_ENABLED 1
+#endif
+
+namespace SHG
+{
+	// Writes a fixed-size binary record of every executed instruction to a file. The CPU adds records to a
+	// lock-free ring buffer, and a writer thread moves them to the file, so tracing doesn't wait for the disk. 
+	// Traces are turned into text afterwards with Decode.
+	//
+	// A trace file starts with a FileHeader, followed by the records in the order they were executed.
+	class Tracer
+	{
+	public:
+		static const uint32_t FILE_MAGIC = 0x52544338; // "8CTR"
+		static const uint32_t FORMAT_VERSION = 1;
+		static const int REGISTER_COUNT = 16;
+		static const size_t DEFAULT_CAPACITY = 1 << 16;
+
+		struct FileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t recordSize;
+			uint32_t reserved;
+		};
+
+		// The state after an instruction was executed
+		struct Record
+		{
+			// Includes the instruction itself, so the first instruction is 1
+			uint64_t instructionCount;
+			uint16_t address;
+			uint16_t opcode;
+			uint16_t iRegister;
+
+			// One bit per V register that the instruction changed, with V0 in the lowest bit
+			uint16_t changedRegisters;
+			uint8_t vRegisters[REGISTER_COUNT];
+		};
+
+		explicit Tracer(size_t capacity = DEFAULT_CAPACITY);
+		Tracer(const Tracer&) = delete;
+		Tracer& operator=(const Tracer&) = delete;
+		~Tracer();
+
+		bool Open(std::string filePath);
+
+		// Writes the remaining records and closes the file
+		void Close();
+
+		// Called by the CPU for every instruction. If the buffer is full, this waits for the writer thread, 
+		// so records are never lost.
+		void Write(const Record& record);
+
+		uint64_t GetRecordCount();
+
+		// Times Write had to wait because the writer thread had fallen behind
+		uint64_t GetStallCount();
+
+		// Writes one line of text per record
+		static bool Decode(std::string filePath, std::ostream& output);
+		static std::string Disassemble(uint16_t opcode);
+
+	private:
+		// How many records the writer thread moves to the file at once
+		static const size_t WRITE_CHUNK_SIZE = 4096;
+
+		RingBuffer<Record> buffer;
+		std::ofstream file;
+		std::thread writerThread;
+		std::atomic<bool> isOpen{ false };
+		uint64_t recordCount{};
+		uint64_t stallCount{};
+
+		void RunWriterThread();
+		size_t WriteChunk(Record* chunk);
+	};
+
+	static_assert(sizeof(Tracer::Record) == 32, "Trace records are read back with the same layout");
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace SHG
+{
+	// Lock-free buffer for passing the latest value from one producer thread to one consumer thread.
+	// The producer and consumer each own one of the three buffers, and the third one is swapped between them, 
+	// so neither side ever waits for the other. If the producer publishes faster than the consumer reads, 
+	// older values are overwritten, and if the consumer reads faster, it keeps the last value.
+	template<typename T>
+	class TripleBuffer
+	{
+	public:
+		// Returns the buffer that the producer should fill before calling Publish
+		T& GetWriteBuffer()
+		{
+			return buffers[writeIndex];
+		}
+
+		// Makes the write buffer available to the consumer. 
+		// Returns true if the previously published value was never consumed, and has now been dropped.
+		bool Publish()
+		{
+			uint8_t previousState = sharedState.exchange((uint8_t)(writeIndex | NEW_VALUE_FLAG), std::memory_order_acq_rel);
+			writeIndex = previousState & INDEX_MASK;
+
+			return (previousState & NEW_VALUE_FLAG) != 0;
+		}
+
+		// Takes the most recently published value, if there's one that hasn't been consumed yet. 
+		// Returns false if there's nothing new, in which case the read buffer still holds the previous value.
+		bool Consume()
+		{
+			if ((sharedState.load(std::memory_order_relaxed) & NEW_VALUE_FLAG) == 0) return false;
+
+			uint8_t previousState = sharedState.exchange(readIndex, std::memory_order_acq_rel);
+			readIndex = previousState & INDEX_MASK;
+
+			return true;
+		}
+
+		// Returns the buffer that holds the last consumed value
+		const T& GetReadBuffer()
+		{
+			return buffers[readIndex];
+		}
+
+	private:
+		static const uint8_t INDEX_MASK = 0x3;
+		static const uint8_t NEW_VALUE_FLAG = 0x4;
+
+		T buffers[3]{};
+
+		// Only used by the producer
+		uint8_t writeIndex = 0;
+
+		// Only used by the consumer
+		uint8_t readIndex = 1;
+
+		// The index of the buffer that is shared between both sides, and whether it holds a value that hasn't been consumed
+		std::atomic<uint8_t> sharedState{ 2 };
+	};
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace SHG
+{
+	// Runs a fixed set of tasks on several threads. The tasks are split into one contiguous shard per thread, 
+	// and a thread that runs out of work steals tasks from the end of another thread's shard, 
+	// so uneven task lengths don't leave threads idle.
+	class WorkStealingPool
+	{
+	public:
+		explicit WorkStealingPool(int threadCount);
+		WorkStealingPool(const WorkStealingPool&) = delete;
+		WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+		// Calls task(index) once for every index from 0 to taskCount - 1, and returns once all of them have finished
+		void Run(int taskCount, const std::function<void(int)>& task);
+
+		int GetThreadCount();
+
+		// How many tasks were run by a thread other than the one they were assigned to during the last Run
+		uint64_t GetStolenTaskCount();
+
+	private:
+		struct WorkQueue
+		{
+			std::mutex mutex;
+			std::deque<int> taskIndices;
+		};
+
+		int threadCount;
+		std::vector<std::unique_ptr<WorkQueue>> queues;
+		std::atomic<uint64_t> stolenTaskCount{ 0 };
+
+		void RunWorker(int workerIndex, const std::function<void(int)>& task);
+		bool PopTask(int workerIndex, int* taskIndex);
+		bool StealTask(int workerIndex, int* taskIndex);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "AllocationCounter.hpp"
+
+namespace SHG
+{
+	static std::atomic<uint64_t> allocationCount{ 0 };
+
+	uint64_t AllocationCounter::GetAllocationCount()
+	{
+		return allocationCount.load(std::memory_order_relaxed);
+	}
+}
+
+// The array forms of operator new and delete call these by default, but the aligned forms don't. 
+// The nothrow and sized forms are replaced as well, since tools such as AddressSanitizer provide their own versions of them.
+void* operator new(std::size_t size)
+{
+	SHG::allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	void* pointer = std::malloc(size == 0 ? 1 : size);
+	if (pointer == nullptr) throw std::bad_alloc();
+
+	return pointer;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	SHG::allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t size) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+	std::free(pointer);
+}
\ No newline at end of file
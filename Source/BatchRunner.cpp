@@ -0,0 +1,307 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <map>
+#include <memory>
+#include "BatchRunner.hpp"
+#include "Machine.hpp"
+#include "WorkStealingPool.hpp"
+#include "RomLibrary.hpp"
+
+using namespace std::chrono;
+
+namespace SHG
+{
+	bool BatchRunner::Run(std::string manifestPath, std::string outputPath, int threadCount, CPU::DispatchMode dispatchMode, bool isLockstepEnabled)
+	{
+		std::vector<Session> sessions;
+		if (!ReadManifest(manifestPath, &sessions)) return false;
+
+		// Every ROM is only read from disk once, no matter how many sessions use it. 
+		// ROMs that can't be read are left empty, and their sessions are reported as failed.
+		std::map<std::string, std::vector<uint8_t>> roms;
+		std::map<std::string, bool> isRomReadable;
+
+		for (const Session& session : sessions)
+		{
+			if (isRomReadable.count(session.romPath) != 0) continue;
+
+			isRomReadable[session.romPath] = RomLibrary::ReadRom(session.romPath, &roms[session.romPath]);
+			if (!isRomReadable[session.romPath]) std::cout << "Couldn't read ROM: " << session.romPath << std::endl;
+		}
+
+		// Lockstep batches only run CHIP-8 instructions, so other ROMs run separately
+		std::map<std::string, bool> isLockstepSupported;
+
+		for (const auto& rom : roms)
+		{
+			isLockstepSupported[rom.first] = RomLibrary::DetectPlatform(rom.second.data(), rom.second.size(), rom.first) == "chip-8";
+		}
+
+		// Input recordings are shared in the same way. Replaying only reads them, so they can be used by several threads at once.
+		std::map<std::string, std::unique_ptr<InputRecording>> inputs;
+
+		for (Session& session : sessions)
+		{
+			if (session.inputPath.empty()) continue;
+
+			if (inputs.count(session.inputPath) == 0)
+			{
+				std::unique_ptr<InputRecording> input = std::make_unique<InputRecording>();
+				if (!input->LoadFromFile(session.inputPath)) input = nullptr;
+
+				inputs[session.inputPath] = std::move(input);
+			}
+
+			InputRecording* input = inputs.at(session.inputPath).get();
+			if (input == nullptr) continue;
+
+			if (session.isFrameCountMissing) session.frameCount = input->GetFrameCount();
+			if (session.isInstructionsPerSecondMissing) session.instructionsPerSecond = input->GetInstructionsPerSecond();
+			if (session.isSeedMissing) session.seed = input->GetSeed();
+		}
+
+		// Each task runs either a single session, or a group of up to LANE_COUNT identical sessions in lockstep
+		std::vector<std::vector<int>> tasks;
+
+		if (isLockstepEnabled)
+		{
+			std::map<std::string, std::vector<int>> identicalSessions;
+
+			for (int index = 0; index < (int)sessions.size(); index++)
+			{
+				const Session& session = sessions[index];
+
+				// The lanes of a lockstep batch can't replay input
+				if (!session.inputPath.empty() || !isLockstepSupported.at(session.romPath))
+				{
+					tasks.push_back({ index });
+					continue;
+				}
+
+				std::string key = session.romPath + "|" + std::to_string(session.frameCount) + "|" + std::to_string(session.instructionsPerSecond);
+
+				std::vector<int>& group = identicalSessions[key];
+				group.push_back(index);
+
+				if ((int)group.size() < LockstepBatch::LANE_COUNT) continue;
+
+				tasks.push_back(group);
+				group.clear();
+			}
+
+			for (auto& group : identicalSessions)
+			{
+				if (!group.second.empty()) tasks.push_back(group.second);
+			}
+		}
+		else
+		{
+			for (int index = 0; index < (int)sessions.size(); index++) tasks.push_back({ index });
+		}
+
+		std::vector<SessionResult> results(sessions.size());
+		WorkStealingPool pool(threadCount);
+
+		auto startTime = steady_clock::now();
+
+		pool.Run((int)tasks.size(), [&](int taskIndex)
+		{
+			const std::vector<int>& sessionIndices = tasks[taskIndex];
+			const Session& session = sessions[sessionIndices[0]];
+			const std::vector<uint8_t>* rom = isRomReadable.at(session.romPath) ? &roms.at(session.romPath) : nullptr;
+			InputRecording* input = session.inputPath.empty() ? nullptr : inputs.at(session.inputPath).get();
+
+			// Sessions in a group share the ROM, so the first one decides how the group runs
+			if (isLockstepEnabled && session.inputPath.empty() && isLockstepSupported.at(session.romPath)) RunLockstepSessions(sessions, sessionIndices, rom, dispatchMode, &results);
+			else RunSession(session, rom, input, dispatchMode, &results[sessionIndices[0]]);
+		});
+
+		double elapsedSeconds = duration_cast<duration<double>>(steady_clock::now() - startTime).count();
+
+		uint64_t totalInstructionCount = 0;
+		for (const SessionResult& result : results) totalInstructionCount += result.instructionCount;
+
+		std::cout << "Sessions: " << sessions.size() << std::endl;
+		std::cout << "Threads: " << pool.GetThreadCount() << " (" << pool.GetStolenTaskCount() << " sessions stolen)" << std::endl;
+		std::cout << "Instructions: " << totalInstructionCount << std::endl;
+		std::cout << "Elapsed time: " << elapsedSeconds * 1000.0 << " ms" << std::endl;
+		if (elapsedSeconds > 0) std::cout << "Instructions per second (aggregate): " << (uint64_t)(totalInstructionCount / elapsedSeconds) << std::endl;
+
+		return WriteResults(outputPath, sessions, results);
+	}
+
+	bool BatchRunner::ReadManifest(std::string manifestPath, std::vector<Session>* sessions)
+	{
+		std::ifstream file(manifestPath);
+
+		if (!file.is_open())
+		{
+			std::cout << "Invalid manifest file provided." << std::endl;
+			return false;
+		}
+
+		std::string line;
+		int lineNumber = 0;
+
+		while (std::getline(file, line))
+		{
+			lineNumber++;
+
+			std::istringstream fields(line);
+			Session session{ "", "", DEFAULT_FRAME_COUNT, DEFAULT_INSTRUCTIONS_PER_SECOND, DEFAULT_SEED, true, true, true };
+
+			if (!(fields >> session.romPath) || session.romPath[0] == '#') continue;
+
+			// Every other value is optional, but numbers have to be valid if they're given
+			std::string value;
+
+			try
+			{
+				if (fields >> value && value != "-")
+				{
+					session.frameCount = std::stoi(value);
+					session.isFrameCountMissing = false;
+				}
+
+				if (fields >> value && value != "-")
+				{
+					session.instructionsPerSecond = std::stoi(value);
+					session.isInstructionsPerSecondMissing = false;
+				}
+
+				if (fields >> value && value != "-")
+				{
+					session.seed = std::stoull(value);
+					session.isSeedMissing = false;
+				}
+
+				if (fields >> value && value != "-") session.inputPath = value;
+			}
+			catch (std::exception const&)
+			{
+				std::cout << "Invalid value '" << value << "' on line " << lineNumber << " of the manifest." << std::endl;
+				return false;
+			}
+
+			sessions->push_back(session);
+		}
+
+		return true;
+	}
+
+	void BatchRunner::RunSession(const Session& session, const std::vector<uint8_t>* rom, InputRecording* input, 
+		CPU::DispatchMode dispatchMode, SessionResult* result)
+	{
+		*result = SessionResult{};
+
+		Machine machine;
+
+		if (rom == nullptr || !machine.LoadRom(rom->data(), (int)rom->size())) return;
+
+		result->isRomLoaded = true;
+		if (!session.inputPath.empty() && input == nullptr) return;
+
+		result->isInputLoaded = true;
+
+		CPU& cpu = machine.GetCPU();
+		cpu.SetDispatchMode(dispatchMode);
+		cpu.SetRandomSeed(session.seed);
+
+		if (input != nullptr)
+		{
+			cpu.SetQuirkProfile(input->GetQuirkProfile());
+			cpu.SetInputReplay(input);
+		}
+
+		machine.RunFrames(session.instructionsPerSecond, session.frameCount);
+
+		result->instructionCount = cpu.GetInstructionCount();
+		result->framebufferHash = machine.GetFramebufferHash();
+		cpu.SaveRegisters(&result->registers);
+	}
+
+	void BatchRunner::RunLockstepSessions(const std::vector<Session>& sessions, const std::vector<int>& sessionIndices, 
+		const std::vector<uint8_t>* rom, CPU::DispatchMode dispatchMode, std::vector<SessionResult>* results)
+	{
+		for (int index : sessionIndices) (*results)[index] = SessionResult{};
+
+		// All sessions in the group are identical, so any of them describes the whole batch. 
+		// Lanes without a session still run, but their results are ignored.
+		const Session& session = sessions[sessionIndices[0]];
+		std::unique_ptr<LockstepBatch> batch = std::make_unique<LockstepBatch>();
+
+		if (rom == nullptr || !batch->LoadRom(rom->data(), (int)rom->size())) return;
+
+		for (int lane = 0; lane < (int)sessionIndices.size(); lane++) batch->SetRandomSeed(lane, sessions[sessionIndices[lane]].seed);
+
+		batch->RunFrames(session.instructionsPerSecond, session.frameCount);
+
+		for (int lane = 0; lane < (int)sessionIndices.size(); lane++)
+		{
+			SessionResult& result = (*results)[sessionIndices[lane]];
+
+			// The ROM is only checked for other instructions before it runs, so it can still reach them 
+			// (e.g. through BNNN or code it wrote). Those sessions run again on a CPU.
+			if (batch->HasLaneFailed(lane))
+			{
+				RunSession(sessions[sessionIndices[lane]], rom, nullptr, dispatchMode, &result);
+				continue;
+			}
+
+			result.isRomLoaded = true;
+			result.isInputLoaded = true;
+			result.instructionCount = batch->GetInstructionCount(lane);
+			result.framebufferHash = batch->GetDisplay(lane).GetHash();
+			batch->SaveRegisters(lane, &result.registers);
+		}
+	}
+
+	bool BatchRunner::WriteResults(std::string outputPath, const std::vector<Session>& sessions, const std::vector<SessionResult>& results)
+	{
+		std::ofstream file(outputPath);
+
+		if (!file.is_open())
+		{
+			std::cout << "Couldn't open the output file: " << outputPath << std::endl;
+			return false;
+		}
+
+		file << "rom,frames,instructions_per_second,seed,input,status,instructions,framebuffer_hash,pc,i";
+		for (int i = 0; i < CPU::REGISTER_COUNT; i++) file << ",v" << std::hex << std::uppercase << i << std::dec;
+		file << "\n";
+
+		for (size_t index = 0; index < sessions.size(); index++)
+		{
+			const Session& session = sessions[index];
+			const SessionResult& result = results[index];
+
+			file << session.romPath << "," << session.frameCount << "," << session.instructionsPerSecond 
+				<< "," << session.seed << "," << session.inputPath;
+
+			if (!result.isRomLoaded)
+			{
+				file << ",rom_error\n";
+				continue;
+			}
+
+			if (!result.isInputLoaded)
+			{
+				file << ",input_error\n";
+				continue;
+			}
+
+			file << ",ok," << result.instructionCount << "," 
+				<< std::hex << std::setw(16) << std::setfill('0') << result.framebufferHash << std::dec 
+				<< "," << result.registers.programCounter << "," << result.registers.iRegister;
+
+			for (int i = 0; i < CPU::REGISTER_COUNT; i++) file << "," << (int)result.registers.vRegisters[i];
+			file << "\n";
+		}
+
+		std::cout << "Results written to: " << outputPath << std::endl;
+		return true;
+	}
+}
\ No newline at end of file
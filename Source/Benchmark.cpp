@@ -0,0 +1,503 @@
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <cstring>
+#include <cstdio>
+#include "Benchmark.hpp"
+#include "HeadlessHost.hpp"
+#include "JitCompiler.hpp"
+#include "LockstepBatch.hpp"
+#include "Machine.hpp"
+#include "RewindBuffer.hpp"
+#include "RomLibrary.hpp"
+
+using namespace std::chrono;
+
+namespace SHG
+{
+	// How many instructions are executed in each benchmark frame
+	static const int BENCHMARK_INSTRUCTIONS_PER_FRAME = 10000;
+
+	static const int BENCHMARK_FRAME_COUNT = 2000;
+
+	// Each measurement is repeated, and the fastest run is reported in order to reduce noise
+	static const int BENCHMARK_REPETITIONS = 3;
+
+	// A fixed loop of ALU, branch, call and memory-addressing instructions. 
+	// It doesn't draw or wait for input, so almost all of the time is spent on fetching, decoding and executing.
+	static const uint8_t DISPATCH_ROM[] =
+	{
+		0x60, 0x00,	// 200: LD V0, 0
+		0x61, 0x01,	// 202: LD V1, 1
+		0x80, 0x14,	// 204: ADD V0, V1
+		0x81, 0x02,	// 206: AND V1, V0
+		0x80, 0x13,	// 208: XOR V0, V1
+		0x72, 0x03,	// 20A: ADD V2, 3
+		0x82, 0x05,	// 20C: SUB V2, V0
+		0x82, 0x06,	// 20E: SHR V2
+		0x82, 0x0E,	// 210: SHL V2
+		0xA3, 0x00,	// 212: LD I, 300
+		0xF2, 0x1E,	// 214: ADD I, V2
+		0x22, 0x20,	// 216: CALL 220
+		0x30, 0x00,	// 218: SE V0, 0
+		0x12, 0x04,	// 21A: JP 204
+		0x12, 0x00,	// 21C: JP 200
+		0x00, 0x00,	// 21E: (unused)
+		0x43, 0x01,	// 220: SNE V3, 1
+		0x63, 0x00,	// 222: LD V3, 0
+		0x73, 0x01,	// 224: ADD V3, 1
+		0x90, 0x10,	// 226: SNE V0, V1
+		0x80, 0x10,	// 228: LD V0, V1
+		0x00, 0xEE	// 22A: RET
+	};
+
+	// Draws a 15-row sprite twice per loop at positions that keep moving, so most draws are clipped at the edges or collide
+	static const uint8_t SPRITE_ROM[] =
+	{
+		0xA2, 0x12,	// 200: LD I, 212
+		0x60, 0x00,	// 202: LD V0, 0
+		0x61, 0x00,	// 204: LD V1, 0
+		0xD0, 0x1F,	// 206: DRW V0, V1, 15
+		0x70, 0x07,	// 208: ADD V0, 7
+		0x71, 0x03,	// 20A: ADD V1, 3
+		0xD0, 0x1F,	// 20C: DRW V0, V1, 15
+		0x70, 0x05,	// 20E: ADD V0, 5
+		0x12, 0x06,	// 210: JP 206
+		0xF0, 0x90, 0x90, 0x90, 0xF0,	// 212: Sprite data
+		0x3C, 0x42, 0x81, 0x81, 0x42,
+		0x3C, 0xFF, 0x18, 0x18, 0xFF
+	};
+
+	// Number of DRW instructions in each loop of SPRITE_ROM, and the number of instructions in that loop
+	static const int SPRITE_ROM_DRAWS_PER_LOOP = 2;
+	static const int SPRITE_ROM_INSTRUCTIONS_PER_LOOP = 6;
+
+	static const int SPRITE_DRAW_COUNT = 2000000;
+
+	static const int SAVE_STATE_COUNT = 100000;
+
+	// Waits for the next frame with the delay timer, and checks whether key 5 was held during the previous frame, 
+	// like a typical game loop. Once it was, a sprite is drawn and the ROM stops.
+	static const uint8_t INPUT_ROM[] =
+	{
+		0xA2, 0x22,	// 200: LD I, 222
+		0x62, 0x05,	// 202: LD V2, 5
+		0x63, 0x01,	// 204: LD V3, 1
+		0x66, 0x00,	// 206: LD V6, 0
+		0xF3, 0x15,	// 208: LD DT, V3
+		0xF4, 0x07,	// 20A: LD V4, DT
+		0x34, 0x00,	// 20C: SE V4, 0
+		0x12, 0x0A,	// 20E: JP 20A
+		0x36, 0x01,	// 210: SE V6, 1
+		0x12, 0x16,	// 212: JP 216
+		0x12, 0x1E,	// 214: JP 21E
+		0x66, 0x00,	// 216: LD V6, 0
+		0xE2, 0xA1,	// 218: SKNP V2
+		0x66, 0x01,	// 21A: LD V6, 1
+		0x12, 0x08,	// 21C: JP 208
+		0xD0, 0x15,	// 21E: DRW V0, V1, 5
+		0x12, 0x20,	// 220: JP 220
+		0xF0, 0x90, 0x90, 0x90, 0xF0	// 222: Sprite data
+	};
+
+	// Key 5 is pressed before this frame of INPUT_ROM
+	static const int INPUT_PRESS_FRAME = 10;
+	static const int INPUT_FRAME_COUNT = 30;
+
+	static const int MAX_RUN_AHEAD_FRAME_COUNT = 3;
+	static const int RUN_AHEAD_BENCHMARK_FRAME_COUNT = 3600;
+
+	// The rewind benchmark runs at a typical game speed, since the size of a frame's delta depends on how much it executes
+	static const int REWIND_INSTRUCTIONS_PER_SECOND = 1000;
+	static const int REWIND_FRAME_COUNT = 3600;
+	static const int REWIND_KEYFRAME_INTERVAL = 60;
+
+	// Every traced instruction adds a record to the file, so fewer frames are traced than in the other benchmarks
+	static const int TRACE_FRAME_COUNT = 200;
+	static const char* TRACE_PATH = "benchmark-trace.bin";
+
+	// The per-pixel sprite drawing that DXYN used before the framebuffer was bit-packed. Only used as a baseline.
+	static bool DrawSpriteRowPerPixel(Display& display, int x, int y, uint8_t spriteRow)
+	{
+		bool isCollision = false;
+
+		for (int bitIndex = 0; bitIndex < 8; bitIndex++)
+		{
+			uint8_t spritePixel = (spriteRow >> (7 - bitIndex)) & 1;
+			uint8_t displayPixel = display.GetPixel(x + bitIndex, y);
+
+			display.SetPixel(x + bitIndex, y, spritePixel ^ displayPixel);
+
+			if (spritePixel && displayPixel) isCollision = true;
+		}
+
+		return isCollision;
+	}
+
+	void Benchmark::Run(std::string romPath)
+	{
+		std::vector<uint8_t> dispatchRom(DISPATCH_ROM, DISPATCH_ROM + sizeof(DISPATCH_ROM));
+
+		if (!romPath.empty())
+		{
+			if (!RomLibrary::ReadRom(romPath, &dispatchRom))
+			{
+				std::cout << "Invalid ROM file provided." << std::endl;
+				return;
+			}
+
+			std::cout << "Benchmark ROM: " << romPath << std::endl;
+		}
+
+		RunDispatchBenchmark(dispatchRom);
+		RunSpriteBenchmark();
+		RunLockstepBenchmark(dispatchRom);
+		RunSaveStateBenchmark(dispatchRom);
+		RunRewindBenchmark(romPath.empty() ? "Dispatch ROM" : romPath, dispatchRom);
+		RunRewindBenchmark("Sprite ROM", std::vector<uint8_t>(SPRITE_ROM, SPRITE_ROM + sizeof(SPRITE_ROM)));
+		RunRunAheadBenchmark(dispatchRom);
+		RunTraceBenchmark(dispatchRom);
+	}
+
+	void Benchmark::RunDispatchBenchmark(const std::vector<uint8_t>& rom)
+	{
+		uint64_t instructionCount = 0;
+
+		double switchSeconds = MeasureSeconds(rom, CPU::DispatchMode::Switch, BENCHMARK_FRAME_COUNT, &instructionCount);
+		double tableSeconds = MeasureSeconds(rom, CPU::DispatchMode::Table, BENCHMARK_FRAME_COUNT, &instructionCount);
+		double blockSeconds = MeasureSeconds(rom, CPU::DispatchMode::BlockCache, BENCHMARK_FRAME_COUNT, &instructionCount);
+		double jitSeconds = JitCompiler::IsSupported() ? MeasureSeconds(rom, CPU::DispatchMode::Jit, BENCHMARK_FRAME_COUNT, &instructionCount) : 0;
+
+		std::cout << "Dispatch benchmark (" << instructionCount << " instructions)" << std::endl;
+		std::cout << "  Switch: " << (uint64_t)(instructionCount / switchSeconds) << " instructions/sec, " 
+			<< (switchSeconds * 1e9) / instructionCount << " ns/instruction" << std::endl;
+		std::cout << "  Table: " << (uint64_t)(instructionCount / tableSeconds) << " instructions/sec, " 
+			<< (tableSeconds * 1e9) / instructionCount << " ns/instruction" << std::endl;
+		std::cout << "  Block cache: " << (uint64_t)(instructionCount / blockSeconds) << " instructions/sec, " 
+			<< (blockSeconds * 1e9) / instructionCount << " ns/instruction" << std::endl;
+		std::cout << "  Speedup (table vs. switch): " << switchSeconds / tableSeconds << "x" << std::endl;
+		std::cout << "  Speedup (block cache vs. switch): " << switchSeconds / blockSeconds << "x" << std::endl;
+
+		if (jitSeconds > 0)
+		{
+			std::cout << "  JIT: " << (uint64_t)(instructionCount / jitSeconds) << " instructions/sec, " 
+				<< (jitSeconds * 1e9) / instructionCount << " ns/instruction" << std::endl;
+			std::cout << "  Speedup (JIT vs. switch): " << switchSeconds / jitSeconds << "x" << std::endl;
+		}
+	}
+
+	void Benchmark::RunSpriteBenchmark()
+	{
+		std::vector<uint8_t> rom(SPRITE_ROM, SPRITE_ROM + sizeof(SPRITE_ROM));
+		uint64_t instructionCount = 0;
+
+		double romSeconds = MeasureSeconds(rom, CPU::DispatchMode::BlockCache, BENCHMARK_FRAME_COUNT, &instructionCount);
+		uint64_t drawCount = instructionCount * SPRITE_ROM_DRAWS_PER_LOOP / SPRITE_ROM_INSTRUCTIONS_PER_LOOP;
+
+		// Draw the same sprites at the same positions with both routines, so only the drawing itself is compared
+		const uint8_t* sprite = SPRITE_ROM + 0x12;
+		const int spriteHeight = 15;
+		int collisionCount = 0;
+		double perPixelSeconds = 0;
+		double rowSeconds = 0;
+
+		for (int i = 0; i < BENCHMARK_REPETITIONS; i++)
+		{
+			Display perPixelDisplay;
+			Display rowDisplay;
+
+			auto startTime = steady_clock::now();
+
+			for (int draw = 0; draw < SPRITE_DRAW_COUNT; draw++)
+			{
+				int x = (draw * 7) % Display::LOW_RES_SCREEN_WIDTH;
+				int y = (draw * 3) % Display::LOW_RES_SCREEN_HEIGHT;
+
+				for (int row = 0; row < spriteHeight && y + row < Display::LOW_RES_SCREEN_HEIGHT; row++)
+				{
+					if (DrawSpriteRowPerPixel(perPixelDisplay, x, y + row, sprite[row])) collisionCount++;
+				}
+			}
+
+			auto midTime = steady_clock::now();
+
+			for (int draw = 0; draw < SPRITE_DRAW_COUNT; draw++)
+			{
+				int x = (draw * 7) % Display::LOW_RES_SCREEN_WIDTH;
+				int y = (draw * 3) % Display::LOW_RES_SCREEN_HEIGHT;
+
+				for (int row = 0; row < spriteHeight && y + row < Display::LOW_RES_SCREEN_HEIGHT; row++)
+				{
+					if (rowDisplay.DrawSpriteRow(x, y + row, sprite[row])) collisionCount--;
+				}
+			}
+
+			auto endTime = steady_clock::now();
+
+			double perPixel = duration_cast<duration<double>>(midTime - startTime).count();
+			double rowXor = duration_cast<duration<double>>(endTime - midTime).count();
+
+			if (i == 0 || perPixel < perPixelSeconds) perPixelSeconds = perPixel;
+			if (i == 0 || rowXor < rowSeconds) rowSeconds = rowXor;
+
+			if (!perPixelDisplay.IsScreenEqual(rowDisplay)) 
+			{
+				std::cout << "Sprite benchmark: the two drawing routines produced different screens." << std::endl;
+				return;
+			}
+		}
+
+		// Both routines should report exactly the same collisions
+		if (collisionCount != 0) std::cout << "Sprite benchmark: the two drawing routines reported different collisions." << std::endl;
+
+		std::cout << "Sprite benchmark (" << drawCount << " sprites drawn by DRW)" << std::endl;
+		std::cout << "  Sprite ROM: " << (uint64_t)(drawCount / romSeconds) << " sprites/sec, " 
+			<< (uint64_t)(instructionCount / romSeconds) << " instructions/sec" << std::endl;
+		std::cout << "  Per-pixel drawing: " << (perPixelSeconds * 1e9) / SPRITE_DRAW_COUNT << " ns/sprite" << std::endl;
+		std::cout << "  Row XOR drawing: " << (rowSeconds * 1e9) / SPRITE_DRAW_COUNT << " ns/sprite" << std::endl;
+		std::cout << "  Speedup (row XOR vs. per-pixel): " << perPixelSeconds / rowSeconds << "x" << std::endl;
+	}
+
+	void Benchmark::RunLockstepBenchmark(const std::vector<uint8_t>& rom)
+	{
+		// The separate machines are measured one at a time and multiplied, since running them one after another takes just as long
+		int frameCount = BENCHMARK_FRAME_COUNT / LockstepBatch::LANE_COUNT;
+		uint64_t separateInstructionCount = 0;
+		double separateSeconds = MeasureSeconds(rom, CPU::DispatchMode::BlockCache, frameCount, &separateInstructionCount) * LockstepBatch::LANE_COUNT;
+		separateInstructionCount *= LockstepBatch::LANE_COUNT;
+
+		uint64_t scalarInstructionCount = 0;
+		double scalarSeconds = MeasureLockstepSeconds(rom, false, frameCount, &scalarInstructionCount);
+
+		std::cout << "Lockstep benchmark (" << LockstepBatch::LANE_COUNT << " machines, " << separateInstructionCount << " instructions)" << std::endl;
+		std::cout << "  Separate CPUs (block cache): " << (uint64_t)(separateInstructionCount / separateSeconds) << " instructions/sec" << std::endl;
+		std::cout << "  Lockstep (scalar): " << (uint64_t)(scalarInstructionCount / scalarSeconds) << " instructions/sec" << std::endl;
+
+		if (LockstepBatch::IsAvx2Supported())
+		{
+			uint64_t vectorInstructionCount = 0;
+			double vectorSeconds = MeasureLockstepSeconds(rom, true, frameCount, &vectorInstructionCount);
+
+			std::cout << "  Lockstep (AVX2): " << (uint64_t)(vectorInstructionCount / vectorSeconds) << " instructions/sec" << std::endl;
+			std::cout << "  Speedup (AVX2 lockstep vs. separate CPUs): " << separateSeconds / vectorSeconds << "x" << std::endl;
+		}
+	}
+
+	void Benchmark::RunSaveStateBenchmark(const std::vector<uint8_t>& rom)
+	{
+		const int instructionsPerSecond = BENCHMARK_INSTRUCTIONS_PER_FRAME * CPU::FRAMES_PER_SECOND;
+		const int frameCount = 100;
+
+		Machine machine;
+		if (!machine.LoadRom(rom.data(), (int)rom.size())) return;
+
+		std::unique_ptr<Machine::State> state = std::make_unique<Machine::State>();
+		std::unique_ptr<Machine::State> laterState = std::make_unique<Machine::State>();
+
+		// Running on from a restored state must give exactly the same result as running on without it
+		machine.RunFrames(instructionsPerSecond, frameCount);
+		machine.SaveState(state.get());
+		machine.RunFrames(instructionsPerSecond, frameCount);
+		machine.SaveState(laterState.get());
+
+		if (!machine.LoadState(*state)) return;
+		machine.RunFrames(instructionsPerSecond, frameCount);
+		machine.SaveState(state.get());
+
+		if (memcmp(state.get(), laterState.get(), sizeof(Machine::State)) != 0)
+		{
+			std::cout << "Save state benchmark: running from a restored state gave a different result." << std::endl;
+			return;
+		}
+
+		double saveSeconds = 0;
+		double loadSeconds = 0;
+
+		for (int i = 0; i < BENCHMARK_REPETITIONS; i++)
+		{
+			auto startTime = steady_clock::now();
+			for (int j = 0; j < SAVE_STATE_COUNT; j++) machine.SaveState(state.get());
+			auto midTime = steady_clock::now();
+			for (int j = 0; j < SAVE_STATE_COUNT; j++) machine.LoadState(*state);
+			auto endTime = steady_clock::now();
+
+			double save = duration_cast<duration<double>>(midTime - startTime).count();
+			double load = duration_cast<duration<double>>(endTime - midTime).count();
+
+			if (i == 0 || save < saveSeconds) saveSeconds = save;
+			if (i == 0 || load < loadSeconds) loadSeconds = load;
+		}
+
+		std::cout << "Save state benchmark (" << sizeof(Machine::State) << " bytes per state)" << std::endl;
+		std::cout << "  Save: " << (saveSeconds * 1e9) / SAVE_STATE_COUNT << " ns/state" << std::endl;
+		std::cout << "  Load: " << (loadSeconds * 1e9) / SAVE_STATE_COUNT << " ns/state" << std::endl;
+	}
+
+	void Benchmark::RunRewindBenchmark(std::string name, const std::vector<uint8_t>& rom)
+	{
+		Machine machine;
+		if (!machine.LoadRom(rom.data(), (int)rom.size())) return;
+
+		// Large enough to hold every frame, so the whole run can be stepped back through and checked
+		RewindBuffer rewindBuffer(REWIND_FRAME_COUNT * sizeof(Machine::State), REWIND_KEYFRAME_INTERVAL);
+		std::vector<Machine::State> states(REWIND_FRAME_COUNT);
+		std::unique_ptr<Machine::State> state = std::make_unique<Machine::State>();
+		duration<double> captureTime{};
+		duration<double> stepBackTime{};
+
+		for (int frame = 0; frame < REWIND_FRAME_COUNT; frame++)
+		{
+			auto startTime = steady_clock::now();
+			machine.SaveState(&states[frame]);
+			rewindBuffer.Push(states[frame]);
+			captureTime += steady_clock::now() - startTime;
+
+			machine.RunFrames(REWIND_INSTRUCTIONS_PER_SECOND, 1);
+		}
+
+		int frameCount = rewindBuffer.GetFrameCount();
+		double bytesPerFrame = (double)rewindBuffer.GetUsedBytes() / frameCount;
+
+		for (int frame = REWIND_FRAME_COUNT - 2; frame >= 0; frame--)
+		{
+			auto startTime = steady_clock::now();
+			rewindBuffer.StepBack(state.get());
+			stepBackTime += steady_clock::now() - startTime;
+
+			if (memcmp(state.get(), &states[frame], sizeof(Machine::State)) != 0)
+			{
+				std::cout << "Rewind benchmark: stepping back gave a different state than the one that was recorded." << std::endl;
+				return;
+			}
+		}
+
+		std::cout << "Rewind benchmark: " << name << " (" << frameCount << " frames, keyframe every " << REWIND_KEYFRAME_INTERVAL << " frames)" << std::endl;
+		std::cout << "  Bytes per frame: " << bytesPerFrame << " (full state: " << sizeof(Machine::State) << ")" << std::endl;
+		std::cout << "  Capture: " << (captureTime.count() * 1e9) / REWIND_FRAME_COUNT << " ns/frame" << std::endl;
+		std::cout << "  Step back: " << (stepBackTime.count() * 1e9) / frameCount << " ns/frame" << std::endl;
+	}
+
+	void Benchmark::RunRunAheadBenchmark(const std::vector<uint8_t>& rom)
+	{
+		std::cout << "Run-ahead benchmark (input latency measured on a ROM that draws one frame after reading a key)" << std::endl;
+
+		for (int runAheadFrameCount = 0; runAheadFrameCount <= MAX_RUN_AHEAD_FRAME_COUNT; runAheadFrameCount++)
+		{
+			Machine machine;
+			if (!machine.LoadRom(rom.data(), (int)rom.size())) return;
+
+			if (runAheadFrameCount > 0) machine.EnableRunAhead(runAheadFrameCount);
+
+			auto startTime = steady_clock::now();
+			machine.RunFrames(REWIND_INSTRUCTIONS_PER_SECOND, RUN_AHEAD_BENCHMARK_FRAME_COUNT);
+			double seconds = duration_cast<duration<double>>(steady_clock::now() - startTime).count();
+
+			int latency = MeasureInputLatency(runAheadFrameCount);
+
+			std::cout << "  " << runAheadFrameCount << " frames ahead: ";
+			if (latency < 0) std::cout << "no response to input";
+			else std::cout << latency << " frames of input latency";
+			std::cout << ", " << (seconds * 1e9) / RUN_AHEAD_BENCHMARK_FRAME_COUNT << " ns/frame" << std::endl;
+		}
+	}
+
+	void Benchmark::RunTraceBenchmark(const std::vector<uint8_t>& rom)
+	{
+		uint64_t instructionCount = 0;
+
+		double untracedSeconds = MeasureSeconds(rom, CPU::DispatchMode::Table, TRACE_FRAME_COUNT, &instructionCount);
+		double tracedSeconds = MeasureSeconds(rom, CPU::DispatchMode::Table, TRACE_FRAME_COUNT, &instructionCount, TRACE_PATH);
+		std::remove(TRACE_PATH);
+
+		std::cout << "Trace benchmark (" << instructionCount << " instructions, " 
+			<< instructionCount * sizeof(Tracer::Record) / (1024 * 1024) << " MB of records)" << std::endl;
+		std::cout << "  Off: " << (untracedSeconds * 1e9) / instructionCount << " ns/instruction" << std::endl;
+		std::cout << "  On: " << (tracedSeconds * 1e9) / instructionCount << " ns/instruction" << std::endl;
+	}
+
+	int Benchmark::MeasureInputLatency(int runAheadFrameCount)
+	{
+		// Two machines run the same ROM, but only one of them gets input. The latency is the number of frames 
+		// presented after the key was pressed, before the first frame in which their screens differ.
+		Machine machines[2];
+
+		for (Machine& machine : machines)
+		{
+			if (!machine.LoadRom(INPUT_ROM, sizeof(INPUT_ROM))) return -1;
+			if (runAheadFrameCount > 0) machine.EnableRunAhead(runAheadFrameCount);
+		}
+
+		const int instructionsPerSecond = REWIND_INSTRUCTIONS_PER_SECOND;
+
+		for (int frame = 0; frame < INPUT_FRAME_COUNT; frame++)
+		{
+			if (frame == INPUT_PRESS_FRAME) machines[1].GetKeypad().SetKeyState(5, true);
+
+			// The CPU is used directly, since Machine::RunFrames would go back to the real state after the frame 
+			// instead of leaving the frame that was presented
+			for (Machine& machine : machines) machine.GetCPU().RunFrames(&machine.GetHeadlessHost(), instructionsPerSecond, 1);
+
+			if (machines[0].GetFramebufferHash() != machines[1].GetFramebufferHash()) return frame - INPUT_PRESS_FRAME;
+		}
+
+		return -1;
+	}
+
+	double Benchmark::MeasureLockstepSeconds(const std::vector<uint8_t>& rom, bool isAvx2Enabled, int frameCount, uint64_t* instructionCount)
+	{
+		double bestSeconds = 0;
+
+		for (int i = 0; i < BENCHMARK_REPETITIONS; i++)
+		{
+			std::unique_ptr<LockstepBatch> batch = std::make_unique<LockstepBatch>();
+			if (!batch->LoadRom(rom.data(), (int)rom.size())) return 0;
+
+			batch->SetAvx2Enabled(isAvx2Enabled);
+
+			auto startTime = steady_clock::now();
+			batch->RunFrames(BENCHMARK_INSTRUCTIONS_PER_FRAME * CPU::FRAMES_PER_SECOND, frameCount);
+			double seconds = duration_cast<duration<double>>(steady_clock::now() - startTime).count();
+
+			if (i == 0 || seconds < bestSeconds) bestSeconds = seconds;
+
+			*instructionCount = 0;
+			for (int lane = 0; lane < LockstepBatch::LANE_COUNT; lane++) *instructionCount += batch->GetInstructionCount(lane);
+		}
+
+		return bestSeconds;
+	}
+
+	double Benchmark::MeasureSeconds(const std::vector<uint8_t>& rom, CPU::DispatchMode mode, int frameCount, uint64_t* instructionCount, 
+		std::string tracePath)
+	{
+		double bestSeconds = 0;
+
+		for (int i = 0; i < BENCHMARK_REPETITIONS; i++)
+		{
+			Memory memory;
+			Display display;
+			Keypad keypad;
+			HeadlessHost host;
+
+			if (!memory.LoadRom(rom.data(), (int)rom.size())) return 0;
+
+			CPU cpu(&memory, &display, &keypad);
+			cpu.SetDispatchMode(mode);
+
+			// The time includes writing the last records to the file, since the trace isn't finished until then
+			Tracer tracer;
+			if (!tracePath.empty() && tracer.Open(tracePath)) cpu.SetTracer(&tracer);
+
+			auto startTime = steady_clock::now();
+			cpu.RunFrames(&host, BENCHMARK_INSTRUCTIONS_PER_FRAME * CPU::FRAMES_PER_SECOND, frameCount);
+			tracer.Close();
+			double seconds = duration_cast<duration<double>>(steady_clock::now() - startTime).count();
+
+			if (i == 0 || seconds < bestSeconds) bestSeconds = seconds;
+			*instructionCount = cpu.GetInstructionCount();
+		}
+
+		return bestSeconds;
+	}
+}
\ No newline at end of file
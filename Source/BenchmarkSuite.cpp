@@ -0,0 +1,358 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "BenchmarkSuite.hpp"
+#include "AllocationCounter.hpp"
+#include "HeadlessHost.hpp"
+#include "JitCompiler.hpp"
+#include "RomLibrary.hpp"
+
+using namespace std::chrono;
+
+namespace SHG
+{
+	static const int SUITE_INSTRUCTIONS_PER_FRAME = 10000;
+	static const int SUITE_FRAME_COUNT = 500;
+
+	// Each measurement is repeated, and the fastest run is reported in order to reduce noise
+	static const int SUITE_REPETITIONS = 3;
+
+	// How many instructions the ALU ROM executes between jumps back to the start of its loop
+	static const int ALU_LOOP_LENGTH = 120;
+
+	static const int ROM_LOAD_COUNT = 2000;
+	static const char* ROM_LOAD_FILE_NAME = "chip8-benchmark-rom.ch8";
+
+	static void AddInstruction(std::vector<uint8_t>& rom, uint16_t instruction)
+	{
+		rom.push_back(instruction >> 8);
+		rom.push_back(instruction & 0xFF);
+	}
+
+	static uint16_t GetNextAddress(const std::vector<uint8_t>& rom)
+	{
+		return (uint16_t)(Memory::RESERVED_MEMORY_SIZE + rom.size());
+	}
+
+	// The ROM file is written to the temporary directory, or the current directory if none is set
+	static std::string GetRomLoadPath()
+	{
+		for (const char* variable : { "TMPDIR", "TMP", "TEMP" })
+		{
+			const char* directory = std::getenv(variable);
+			if (directory != nullptr && directory[0] != '\0') return std::string(directory) + "/" + ROM_LOAD_FILE_NAME;
+		}
+
+		return ROM_LOAD_FILE_NAME;
+	}
+
+	static const char* GetDispatchName(CPU::DispatchMode mode)
+	{
+		switch (mode)
+		{
+		case CPU::DispatchMode::Switch: return "switch";
+		case CPU::DispatchMode::Table: return "table";
+		case CPU::DispatchMode::BlockCache: return "block_cache";
+		case CPU::DispatchMode::Jit: return "jit";
+		}
+
+		return "";
+	}
+
+	bool BenchmarkSuite::Run(std::string outputPath, std::string baselinePath)
+	{
+		std::vector<Result> baseline;
+		if (!baselinePath.empty() && !ReadResults(baselinePath, &baseline)) return false;
+
+		struct NamedRom
+		{
+			const char* name;
+			std::vector<uint8_t> rom;
+		};
+
+		std::vector<NamedRom> roms =
+		{
+			{ "alu", CreateAluRom() },
+			{ "branch", CreateBranchRom() },
+			{ "sprite", CreateSpriteRom() },
+			{ "memory", CreateMemoryRom() }
+		};
+
+		std::vector<CPU::DispatchMode> modes = { CPU::DispatchMode::Switch, CPU::DispatchMode::Table, CPU::DispatchMode::BlockCache };
+		if (JitCompiler::IsSupported()) modes.push_back(CPU::DispatchMode::Jit);
+
+		std::vector<Result> results;
+
+		for (const NamedRom& namedRom : roms)
+		{
+			for (CPU::DispatchMode mode : modes)
+			{
+				results.push_back(MeasureRom(namedRom.name, namedRom.rom, mode));
+				PrintResult(results.back(), baseline);
+			}
+		}
+
+		for (bool isFromFile : { false, true })
+		{
+			results.emplace_back();
+			if (!MeasureRomLoading(isFromFile, &results.back())) return false;
+
+			PrintResult(results.back(), baseline);
+		}
+
+		return WriteResults(outputPath, results);
+	}
+
+	std::vector<uint8_t> BenchmarkSuite::CreateAluRom()
+	{
+		// Every 8XYn instruction, on registers that keep changing. VF is only written as a flag.
+		static const uint16_t operations[] = { 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE };
+		std::vector<uint8_t> rom;
+
+		for (int x = 0; x < CPU::REGISTER_COUNT - 1; x++) AddInstruction(rom, 0x6000 | (x << 8) | (x * 17 + 1));
+
+		uint16_t loopAddress = GetNextAddress(rom);
+
+		for (int i = 0; i < ALU_LOOP_LENGTH; i++)
+		{
+			int x = i % (CPU::REGISTER_COUNT - 1);
+			int y = (i * 7 + 3) % (CPU::REGISTER_COUNT - 1);
+			AddInstruction(rom, 0x8000 | (x << 8) | (y << 4) | operations[i % 9]);
+		}
+
+		AddInstruction(rom, 0x1000 | loopAddress);
+		return rom;
+	}
+
+	std::vector<uint8_t> BenchmarkSuite::CreateBranchRom()
+	{
+		// Skips that are taken or not depending on the loop counter, with a call and a return on most iterations
+		std::vector<uint8_t> rom;
+		AddInstruction(rom, 0x6000);									// LD V0, 0
+		AddInstruction(rom, 0x6100);									// LD V1, 0
+
+		uint16_t loopAddress = GetNextAddress(rom);
+		uint16_t subroutineAddress = loopAddress + 16;
+		AddInstruction(rom, 0x7001);									// ADD V0, 1
+		AddInstruction(rom, 0x3080);									// SE V0, 80
+		AddInstruction(rom, 0x2000 | subroutineAddress);				// CALL subroutine
+		AddInstruction(rom, 0x4101);									// SNE V1, 1
+		AddInstruction(rom, 0x6100);									// LD V1, 0
+		AddInstruction(rom, 0x5010);									// SE V0, V1
+		AddInstruction(rom, 0x7101);									// ADD V1, 1
+		AddInstruction(rom, 0x1000 | loopAddress);						// JP loop
+
+		AddInstruction(rom, 0x7101);									// subroutine: ADD V1, 1
+		AddInstruction(rom, 0x00EE);									// RET
+		return rom;
+	}
+
+	std::vector<uint8_t> BenchmarkSuite::CreateSpriteRom()
+	{
+		// Two 15-row sprites per loop at positions that keep moving, so draws wrap, clip at the bottom and collide
+		static const uint8_t sprite[] = { 0xFF, 0x81, 0xBD, 0xA5, 0xA5, 0xBD, 0x81, 0xFF, 0x18, 0x3C, 0x7E, 0xFF, 0x7E, 0x3C, 0x18 };
+		std::vector<uint8_t> rom;
+
+		uint16_t spriteAddress = Memory::RESERVED_MEMORY_SIZE + 16;
+		AddInstruction(rom, 0xA000 | spriteAddress);					// LD I, sprite
+		AddInstruction(rom, 0x6000);									// LD V0, 0
+		AddInstruction(rom, 0x6100);									// LD V1, 0
+
+		uint16_t loopAddress = GetNextAddress(rom);
+		AddInstruction(rom, 0xD01F);									// DRW V0, V1, 15
+		AddInstruction(rom, 0x7005);									// ADD V0, 5
+		AddInstruction(rom, 0x7103);									// ADD V1, 3
+		AddInstruction(rom, 0xD10F);									// DRW V1, V0, 15
+		AddInstruction(rom, 0x1000 | loopAddress);						// JP loop
+
+		rom.resize(spriteAddress - Memory::RESERVED_MEMORY_SIZE);
+		rom.insert(rom.end(), sprite, sprite + sizeof(sprite));
+		return rom;
+	}
+
+	std::vector<uint8_t> BenchmarkSuite::CreateMemoryRom()
+	{
+		// BCD, store and load on a data area after the code, so the writes never invalidate cached code
+		std::vector<uint8_t> rom;
+		AddInstruction(rom, 0xA600);									// LD I, 600
+		AddInstruction(rom, 0x6307);									// LD V3, 7
+
+		uint16_t loopAddress = GetNextAddress(rom);
+		AddInstruction(rom, 0xF333);									// LD B, V3
+		AddInstruction(rom, 0xF755);									// LD [I], V7
+		AddInstruction(rom, 0xFF65);									// LD VF, [I]
+		AddInstruction(rom, 0x7301);									// ADD V3, 1
+		AddInstruction(rom, 0x1000 | loopAddress);						// JP loop
+		return rom;
+	}
+
+	BenchmarkSuite::Result BenchmarkSuite::MeasureRom(std::string name, const std::vector<uint8_t>& rom, CPU::DispatchMode mode)
+	{
+		Result result{ name, GetDispatchName(mode), 0, 0, 0 };
+
+		for (int i = 0; i < SUITE_REPETITIONS; i++)
+		{
+			Memory memory;
+			Display display;
+			Keypad keypad;
+			HeadlessHost host;
+
+			if (!memory.LoadRom(rom.data(), (int)rom.size())) return result;
+
+			CPU cpu(&memory, &display, &keypad);
+			cpu.SetDispatchMode(mode);
+
+			uint64_t startAllocationCount = AllocationCounter::GetAllocationCount();
+			auto startTime = steady_clock::now();
+			cpu.RunFrames(&host, SUITE_INSTRUCTIONS_PER_FRAME * CPU::FRAMES_PER_SECOND, SUITE_FRAME_COUNT);
+			double seconds = duration_cast<duration<double>>(steady_clock::now() - startTime).count();
+
+			if (i == 0 || seconds < result.seconds) result.seconds = seconds;
+			result.operationCount = cpu.GetInstructionCount();
+			result.allocationCount = AllocationCounter::GetAllocationCount() - startAllocationCount;
+		}
+
+		return result;
+	}
+
+	bool BenchmarkSuite::MeasureRomLoading(bool isFromFile, Result* result)
+	{
+		*result = Result{ isFromFile ? "load_rom_file" : "load_rom_memory", "", ROM_LOAD_COUNT, 0, 0 };
+
+		// The largest ROM that fits, with every byte different from its neighbours
+		std::vector<uint8_t> rom(Memory::MAX_ROM_SIZE);
+		for (size_t i = 0; i < rom.size(); i++) rom[i] = (uint8_t)(i * 31 + 7);
+
+		std::string romPath = GetRomLoadPath();
+
+		if (isFromFile)
+		{
+			std::ofstream file(romPath, std::fstream::binary);
+
+			if (!file.write((const char*)rom.data(), rom.size()) || !file.flush())
+			{
+				std::cout << "Couldn't write the ROM for the loading benchmark: " << romPath << std::endl;
+				return false;
+			}
+		}
+
+		// Only the loads are timed. Constructing the memory clears all of it, which would cost more than loading the ROM.
+		Memory memory;
+		std::vector<uint8_t> fileRom;
+		bool isLoaded = true;
+
+		for (int i = 0; i < SUITE_REPETITIONS && isLoaded; i++)
+		{
+			uint64_t startAllocationCount = AllocationCounter::GetAllocationCount();
+			auto startTime = steady_clock::now();
+
+			for (int load = 0; load < ROM_LOAD_COUNT && isLoaded; load++)
+			{
+				if (isFromFile) isLoaded = RomLibrary::ReadRom(romPath, &fileRom) && memory.LoadRom(fileRom.data(), (int)fileRom.size());
+				else isLoaded = memory.LoadRom(rom.data(), (int)rom.size());
+			}
+
+			double seconds = duration_cast<duration<double>>(steady_clock::now() - startTime).count();
+
+			if (i == 0 || seconds < result->seconds) result->seconds = seconds;
+			result->allocationCount = AllocationCounter::GetAllocationCount() - startAllocationCount;
+		}
+
+		if (isFromFile) std::remove(romPath.c_str());
+
+		if (!isLoaded)
+		{
+			std::cout << "Couldn't load the ROM for the loading benchmark." << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	void BenchmarkSuite::PrintResult(const Result& result, const std::vector<Result>& baseline)
+	{
+		double nanosecondsPerOperation = result.seconds * 1e9 / result.operationCount;
+		const char* operationName = result.dispatch.empty() ? "loads" : "instructions";
+
+		std::cout << "  " << result.name;
+		if (!result.dispatch.empty()) std::cout << " (" << result.dispatch << ")";
+		std::cout << ": " << (uint64_t)(result.operationCount / result.seconds) << " " << operationName << "/sec, " 
+			<< nanosecondsPerOperation << " ns/op, " << result.allocationCount << " allocations/run";
+
+		for (const Result& baselineResult : baseline)
+		{
+			if (baselineResult.name != result.name || baselineResult.dispatch != result.dispatch) continue;
+
+			double baselineNanoseconds = baselineResult.seconds * 1e9 / baselineResult.operationCount;
+			double change = (nanosecondsPerOperation - baselineNanoseconds) / baselineNanoseconds * 100.0;
+
+			std::cout << " (" << std::showpos << std::fixed << std::setprecision(1) << change << "% ns/op" 
+				<< std::noshowpos << std::defaultfloat << std::setprecision(6) << ")";
+		}
+
+		std::cout << std::endl;
+	}
+
+	bool BenchmarkSuite::WriteResults(std::string outputPath, const std::vector<Result>& results)
+	{
+		std::ofstream file(outputPath);
+
+		if (!file.is_open())
+		{
+			std::cout << "Couldn't open the output file: " << outputPath << std::endl;
+			return false;
+		}
+
+		file << "benchmark,dispatch,operations,seconds,operations_per_second,ns_per_operation,allocations\n";
+
+		for (const Result& result : results)
+		{
+			file << result.name << "," << result.dispatch << "," << result.operationCount << "," << result.seconds 
+				<< "," << (uint64_t)(result.operationCount / result.seconds) << "," << result.seconds * 1e9 / result.operationCount 
+				<< "," << result.allocationCount << "\n";
+		}
+
+		std::cout << "Results written to: " << outputPath << std::endl;
+		return true;
+	}
+
+	bool BenchmarkSuite::ReadResults(std::string filePath, std::vector<Result>* results)
+	{
+		std::ifstream file(filePath);
+
+		if (!file.is_open())
+		{
+			std::cout << "Couldn't open the baseline file: " << filePath << std::endl;
+			return false;
+		}
+
+		std::string line;
+		std::getline(file, line);
+
+		// Only the columns that are needed for the comparison are read, and rows that can't be read are ignored
+		while (std::getline(file, line))
+		{
+			std::vector<std::string> columns;
+			std::stringstream lineStream(line);
+			std::string column;
+			while (std::getline(lineStream, column, ',')) columns.push_back(column);
+
+			if (columns.size() < 4) continue;
+
+			try
+			{
+				Result result{ columns[0], columns[1], std::stoull(columns[2]), std::stod(columns[3]), 0 };
+				if (result.operationCount != 0 && result.seconds > 0) results->push_back(result);
+			}
+			catch (std::exception const&)
+			{
+			}
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "BlockCache.hpp"
+
+namespace SHG
+{
+	BlockCache::BlockCache(Memory* memory, const CPU::DecodedInstruction* decodeTable)
+	{
+		this->memory = memory;
+		this->decodeTable = decodeTable;
+
+		memory->SetCodeWriteListener(this);
+	}
+
+	BlockCache::~BlockCache()
+	{
+		Clear();
+
+		memory->SetCodeWriteListener(nullptr);
+	}
+
+	BasicBlock* BlockCache::GetBlock(uint16_t address)
+	{
+		address &= Memory::TOTAL_MEMORY - 1;
+
+		BasicBlock* block = blocks[address].get();
+		if (block == nullptr) block = BuildBlock(address);
+
+		return block;
+	}
+
+	void BlockCache::Clear()
+	{
+		for (int address = 0; address < Memory::TOTAL_MEMORY; address++) RemoveBlock(address);
+	}
+
+	void BlockCache::ClearNativeCode()
+	{
+		for (int address = 0; address < Memory::TOTAL_MEMORY; address++)
+		{
+			BasicBlock* block = blocks[address].get();
+			if (block == nullptr) continue;
+
+			block->executionCount = 0;
+			block->nativeCode = nullptr;
+			block->nativeInstructionCount = 0;
+		}
+	}
+
+	void BlockCache::OnCodeWrite(int address)
+	{
+		// Only blocks that start at most one maximum-sized block before the address can contain it
+		for (int offset = 0; offset < MAX_BLOCK_LENGTH * 2; offset++)
+		{
+			int startAddress = (address - offset) & (Memory::TOTAL_MEMORY - 1);
+
+			BasicBlock* block = blocks[startAddress].get();
+			if (block != nullptr && offset < block->size) RemoveBlock(startAddress);
+		}
+	}
+
+	int BlockCache::GetIdleLoopLength(const BasicBlock* block)
+	{
+		const CPU::DecodedInstruction& first = block->instructions[0];
+
+		// JP to the block's own address
+		if ((first.opcode & 0xF000) == 0x1000 && first.nnn == block->startAddress) return 1;
+
+		if (block->instructions.size() != 2) return 0;
+
+		const CPU::DecodedInstruction& second = block->instructions[1];
+		int jumpAddress = block->startAddress + block->size;
+
+		// LD Vx, DT followed by SE/SNE Vx, kk
+		if ((first.opcode & 0xF0FF) != 0xF007) return 0;
+		if ((second.opcode & 0xF000) != 0x3000 && (second.opcode & 0xF000) != 0x4000) return 0;
+		if (second.x != first.x || jumpAddress + 1 >= Memory::TOTAL_MEMORY) return 0;
+
+		// JP back to the start of the block
+		uint16_t jump = (memory->GetByte(jumpAddress) << 8) | memory->GetByte(jumpAddress + 1);
+		if (jump != (0x1000 | block->startAddress)) return 0;
+
+		return 3;
+	}
+
+	BasicBlock* BlockCache::BuildBlock(uint16_t address)
+	{
+		std::unique_ptr<BasicBlock> block(new BasicBlock());
+		block->startAddress = address;
+		block->instructions.reserve(MAX_BLOCK_LENGTH);
+
+		int currentAddress = address;
+
+		while ((int)block->instructions.size() < MAX_BLOCK_LENGTH)
+		{
+			uint16_t instruction = (memory->GetByte(currentAddress) << 8) | memory->GetByte(currentAddress + 1);
+			const CPU::DecodedInstruction& decoded = decodeTable[instruction];
+
+			block->instructions.push_back(decoded);
+			currentAddress += 2;
+
+			// The block also ends at the end of memory, since the program counter wraps around there
+			if (decoded.endsBlock || currentAddress >= Memory::TOTAL_MEMORY) break;
+		}
+
+		block->size = currentAddress - address;
+		block->instructions.shrink_to_fit();
+		block->idleLoopLength = GetIdleLoopLength(block.get());
+
+		// A timer polling loop also depends on the jump after the block, so writing to it has to remove the block
+		if (block->idleLoopLength > (int)block->instructions.size()) block->size += 2;
+
+		memory->AddCodeReference(block->startAddress, block->size);
+
+		blocks[address] = std::move(block);
+		return blocks[address].get();
+	}
+
+	void BlockCache::RemoveBlock(int address)
+	{
+		BasicBlock* block = blocks[address].get();
+		if (block == nullptr) return;
+
+		memory->RemoveCodeReference(block->startAddress, block->size);
+		blocks[address].reset();
+	}
+}
\ No newline at end of file
@@ -2,349 +2,1280 @@
 #include <ios>
 #include <iomanip>
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <cstring>
+#include <thread>
 #include "CPU.hpp"
+#include "BlockCache.hpp"
+#include "JitCompiler.hpp"
+#include "Bits.hpp"
 using namespace std::chrono;
 
 namespace SHG
 {
-	// How many times per second to update timers
-	static const int TIMER_UPDATES_PER_SECOND = 60;
+	// How long each frame lasts. Instructions are executed and timers are updated once per frame.
+	static const steady_clock::duration FRAME_DURATION = duration_cast<steady_clock::duration>(duration<double>(1.0 / CPU::FRAMES_PER_SECOND));
 
-	// How many milliseconds to wait between timer updates
-	static const double TARGET_TIMER_UPDATE_DELTA_TIME = (1.0 / TIMER_UPDATES_PER_SECOND) * 1000.0;
+	// If the emulator falls further behind than this (e.g. the window was being dragged), 
+	// the schedule is reset instead of trying to catch up by running frames back to back.
+	static const steady_clock::duration MAX_FRAME_LAG = FRAME_DURATION * 5;
 
 	CPU::CPU(Memory* memory, Display* display, Keypad* keypad)
 	{
 		this->memory = memory;
 		this->display = display;
 		this->keypad = keypad;
+
+		decodeInstruction = &CPU::DecodeInstruction<DefaultQuirks>;
+		decodeTable = GetDecodeTable<DefaultQuirks>();
+		blockCache = std::make_unique<BlockCache>(memory, decodeTable);
+
+		std::fill(audioPattern, audioPattern + Sound::PATTERN_SIZE, SoundGenerator::BEEPER_PATTERN_BYTE);
 	}
 
-	void CPU::StartCycle(int instructionsPerSecond)
+	CPU::~CPU() = default;
+
+	// Sleeps until the next frame is due, instead of polling the clock. 
+	// If a keypad is given, a key event also ends the wait, so the CPU can react to it straight away.
+	static void WaitForNextFrame(steady_clock::time_point* nextFrameTime, Keypad* keypad = nullptr)
+	{
+		*nextFrameTime += FRAME_DURATION;
+		auto currentTime = steady_clock::now();
+
+		if (currentTime < *nextFrameTime)
+		{
+			if (keypad != nullptr) keypad->WaitForKeyEvent(*nextFrameTime);
+			else std::this_thread::sleep_until(*nextFrameTime);
+		}
+		else if (currentTime - *nextFrameTime > MAX_FRAME_LAG)
+		{
+			*nextFrameTime = currentTime;
+		}
+	}
+
+	void CPU::StartCycle(Host* host, int instructionsPerSecond)
 	{
 		if (isRunning) return;
 
-		this->instructionsPerSecond = instructionsPerSecond;
-		targetFetchDeltaTime = (1.0 / instructionsPerSecond) * 1000.0;
+		SetInstructionsPerSecond(instructionsPerSecond);
 
 		isRunning = true;
+		std::thread emulationThread(&CPU::RunEmulationThread, this, host);
+
+		// The host renders its own copy of the screen, so it never has to wait for the emulation thread
+		Display renderDisplay;
+		auto nextFrameTime = steady_clock::now();
+
+		// Frames presented since the first key event that hasn't caused a change on screen yet, or -1 if there isn't one
+		uint32_t keyEventCount = keypad->GetKeyEventCount();
+		int64_t inputLatencyFrames = -1;
+
 		while (isRunning)
 		{
-			SDL_Event e;
-			while (SDL_PollEvent(&e))
+			if (!host->ProcessEvents(keypad)) break;
+
+			if (keypad->GetKeyEventCount() != keyEventCount && inputLatencyFrames < 0) inputLatencyFrames = 0;
+			keyEventCount = keypad->GetKeyEventCount();
+
+			if (frameBuffer.Consume()) renderDisplay.SetScreen(frameBuffer.GetReadBuffer().screen);
+			else duplicatedFrameCount++;
+
+			if (inputLatencyFrames >= 0 && renderDisplay.HasChanged())
+			{
+				inputLatencyFrameTotal += inputLatencyFrames;
+				inputLatencySampleCount++;
+				inputLatencyFrames = -1;
+			}
+			else if (inputLatencyFrames >= 0)
+			{
+				inputLatencyFrames++;
+			}
+
+			host->Present(&renderDisplay);
+			renderDisplay.ClearDirtyRegions();
+
+			WaitForNextFrame(&nextFrameTime);
+		}
+
+		isRunning = false;
+		emulationThread.join();
+	}
+
+	void CPU::RunEmulationThread(Host* host)
+	{
+		auto nextFrameTime = steady_clock::now();
+		bool isAudioClockEnabled = host->IsAudioClockEnabled();
+		Sound sound;
+
+		while (isRunning)
+		{
+			if (!frameHook || frameHook()) RunFrame(GetFrameInstructionCount());
+
+			display->GetScreen(&frameBuffer.GetWriteBuffer().screen);
+			if (frameBuffer.Publish()) droppedFrameCount++;
+
+			GetSound(&sound);
+			host->QueueAudio(sound);
+
+			// With the audio clock, the thread waits until the device has played most of the queued sound, so the emulation runs at the 
+			// device's rate. Otherwise, while FX0A is waiting, nothing is executed until a key is released, so the thread sleeps on the keypad.
+			if (isAudioClockEnabled) host->WaitForAudioClock();
+			else WaitForNextFrame(&nextFrameTime, isWaitingForKey ? keypad : nullptr);
+		}
+	}
+
+	void CPU::RunFrames(Host* host, int instructionsPerSecond, int frameCount)
+	{
+		if (isRunning) return;
+
+		SetInstructionsPerSecond(instructionsPerSecond);
+
+		// Frames are executed back to back without waiting, so the speed is only limited by the host machine.
+		isRunning = true;
+		for (int frame = 0; frame < frameCount && isRunning; frame++)
+		{
+			if (!host->ProcessEvents(keypad)) break;
+
+			if (!frameHook || frameHook()) RunFrame(GetFrameInstructionCount());
+			host->Present(display);
+			display->ClearDirtyRegions();
+		}
+
+		isRunning = false;
+	}
+
+	void CPU::RunFrame(int instructionCount)
+	{
+		if (isWaitingForKey) UpdateKeyWait();
+
+		// Timers keep running while the CPU is waiting for a key
+		if (!isWaitingForKey)
+		{
+			if ((SHG_TRACE_ENABLED && tracer != nullptr) || profiler != nullptr)
+			{
+				ExecuteInstrumented(instructionCount);
+			}
+			else if (dispatchMode == DispatchMode::BlockCache || dispatchMode == DispatchMode::Jit)
+			{
+				ExecuteBlocks(instructionCount);
+			}
+			else
+			{
+				for (int i = 0; i < instructionCount && !isWaitingForKey; i++) Step();
+			}
+		}
+
+		UpdateTimers();
+		frameCount++;
+	}
+
+	void CPU::GetSound(Sound* sound)
+	{
+		sound->isPlaying = isSoundPlaying;
+		std::copy(audioPattern, audioPattern + Sound::PATTERN_SIZE, sound->pattern);
+		sound->pitch = audioPitch;
+	}
+
+	bool CPU::IsWaitingForKey()
+	{
+		return isWaitingForKey;
+	}
+
+	void CPU::UpdateKeyWait()
+	{
+		uint16_t keyStates = 0;
+		uint16_t releasedKeyStates = 0;
+		ReadKeypad(&keyStates, &releasedKeyStates);
+
+		if (releasedKeyStates == 0) return;
+
+		// The lowest released key is taken, same as checking every key in order
+		uint8_t key = (uint8_t)CountTrailingZeros(releasedKeyStates);
+		keypad->ClearReleasedKey(key);
+		recordedReleasedKeyStates &= ~(1 << key);
+
+		vRegisters[keyWaitRegister] = key;
+		isWaitingForKey = false;
+	}
+
+	void CPU::ReadKeypad(uint16_t* keyStates, uint16_t* releasedKeyStates)
+	{
+		if (inputReplay != nullptr) ReplayInput();
+
+		*keyStates = keypad->GetKeyStates();
+		*releasedKeyStates = keypad->GetReleasedKeyStates();
+
+		if (inputRecording != nullptr) RecordInput(*keyStates, *releasedKeyStates);
+	}
+
+	void CPU::ReplayInput()
+	{
+		const std::vector<InputRecording::Event>& events = inputReplay->GetEvents();
+
+		while (inputReplayPosition < events.size())
+		{
+			const InputRecording::Event& event = events[inputReplayPosition];
+			if (!IsInputEventDue(event)) break;
+
+			keypad->SetKeyStates(event.keyStates, event.releasedKeyStates);
+			inputReplayPosition++;
+		}
+	}
+
+	bool CPU::IsInputEventDue(const InputRecording::Event& event)
+	{
+		return event.frame < frameCount || (event.frame == frameCount && event.instruction <= instructionCount);
+	}
+
+	void CPU::RecordInput(uint16_t keyStates, uint16_t releasedKeyStates)
+	{
+		if (keyStates == recordedKeyStates && releasedKeyStates == recordedReleasedKeyStates) return;
+
+		inputRecording->AddEvent({ frameCount, instructionCount, keyStates, releasedKeyStates });
+		recordedKeyStates = keyStates;
+		recordedReleasedKeyStates = releasedKeyStates;
+	}
+
+	bool CPU::IsKeyPressed(uint8_t key)
+	{
+		uint16_t keyStates = 0;
+		uint16_t releasedKeyStates = 0;
+		ReadKeypad(&keyStates, &releasedKeyStates);
+
+		return key < Keypad::KEY_COUNT && (keyStates & (1 << key)) != 0;
+	}
+
+	void CPU::SetInstructionsPerSecond(int instructionsPerSecond)
+	{
+		this->instructionsPerSecond = std::max(instructionsPerSecond, 1);
+		frameInstructionRemainder = 0;
+	}
+
+	int CPU::GetFrameInstructionCount()
+	{
+		// Instructions that don't divide evenly into frames are carried over to later frames, 
+		// so that e.g. 700 instructions per second doesn't turn into 660.
+		frameInstructionRemainder += instructionsPerSecond;
+
+		int count = frameInstructionRemainder / FRAMES_PER_SECOND;
+		frameInstructionRemainder %= FRAMES_PER_SECOND;
+
+		return count;
+	}
+
+	uint64_t CPU::GetDroppedFrameCount()
+	{
+		return droppedFrameCount;
+	}
+
+	uint64_t CPU::GetDuplicatedFrameCount()
+	{
+		return duplicatedFrameCount;
+	}
+
+	double CPU::GetAverageInputLatency()
+	{
+		return inputLatencySampleCount == 0 ? 0 : (double)inputLatencyFrameTotal / inputLatencySampleCount;
+	}
+
+	uint64_t CPU::GetInputLatencySampleCount()
+	{
+		return inputLatencySampleCount;
+	}
+
+	uint64_t CPU::GetInstructionCount()
+	{
+		return instructionCount;
+	}
+
+	uint64_t CPU::GetFrameCount()
+	{
+		return frameCount;
+	}
+
+	void CPU::SetRandomSeed(uint64_t seed)
+	{
+		random.Seed(seed);
+	}
+
+	void CPU::SetInputRecording(InputRecording* recording)
+	{
+		inputRecording = recording;
+
+		// The recording starts from the keypad as it is now
+		recordedKeyStates = keypad->GetKeyStates();
+		recordedReleasedKeyStates = keypad->GetReleasedKeyStates();
+	}
+
+	void CPU::SetInputReplay(InputRecording* replay)
+	{
+		inputReplay = replay;
+		inputReplayPosition = 0;
+	}
+
+	void CPU::SetTracer(Tracer* tracer)
+	{
+		this->tracer = tracer;
+	}
+
+	Tracer* CPU::GetTracer()
+	{
+		return tracer;
+	}
+
+	void CPU::SetProfiler(Profiler* profiler)
+	{
+		this->profiler = profiler;
+
+		// Memory writes are counted where they happen, so every instruction that writes is included
+		memory->SetProfiler(profiler);
+	}
+
+	Profiler* CPU::GetProfiler()
+	{
+		return profiler;
+	}
+
+	void CPU::SetDispatchMode(DispatchMode mode)
+	{
+		// Fall back to the block cache interpreter on hosts the JIT doesn't support
+		if (mode == DispatchMode::Jit && !JitCompiler::IsSupported()) mode = DispatchMode::BlockCache;
+
+		dispatchMode = mode;
+
+		if (dispatchMode == DispatchMode::Jit && jitCompiler == nullptr)
+		{
+			JitContext context;
+			context.cpu = this;
+			context.vRegisters = vRegisters;
+			context.iRegister = &iRegister;
+			context.programCounter = &programCounter;
+			context.timerRegisters = timerRegisters;
+			context.memory = memory->GetData();
+
+			jitCompiler = std::make_unique<JitCompiler>(context, &CPU::ExecuteFallbackInstruction, quirks);
+		}
+	}
+
+	void CPU::SetQuirkProfile(QuirkProfile profile)
+	{
+		quirkProfile = profile;
+		quirks = QuirkSettings::Create(profile);
+
+		// Every profile has its own instantiation of the handlers that depend on quirks, so nothing is checked per instruction
+		switch (profile)
+		{
+		case QuirkProfile::Vip:
+			decodeInstruction = &CPU::DecodeInstruction<VipQuirks>;
+			decodeTable = GetDecodeTable<VipQuirks>();
+			break;
+		case QuirkProfile::Schip:
+			decodeInstruction = &CPU::DecodeInstruction<SchipQuirks>;
+			decodeTable = GetDecodeTable<SchipQuirks>();
+			break;
+		case QuirkProfile::XoChip:
+			decodeInstruction = &CPU::DecodeInstruction<XoChipQuirks>;
+			decodeTable = GetDecodeTable<XoChipQuirks>();
+			break;
+		default:
+			decodeInstruction = &CPU::DecodeInstruction<DefaultQuirks>;
+			decodeTable = GetDecodeTable<DefaultQuirks>();
+			break;
+		}
+
+		// Cached blocks and compiled code were decoded with the old handlers. 
+		// The old block cache is destroyed first, since it unregisters itself from the memory.
+		blockCache.reset();
+		blockCache = std::make_unique<BlockCache>(memory, decodeTable);
+
+		if (jitCompiler != nullptr)
+		{
+			jitCompiler.reset();
+			SetDispatchMode(dispatchMode);
+		}
+	}
+
+	QuirkProfile CPU::GetQuirkProfile()
+	{
+		return quirkProfile;
+	}
+
+	void CPU::SetFrameHook(std::function<bool()> hook)
+	{
+		frameHook = hook;
+	}
+
+	void CPU::SetJitCheckEnabled(bool isEnabled)
+	{
+		isJitCheckEnabled = isEnabled;
+	}
+
+	uint64_t CPU::GetJitCheckedBlockCount()
+	{
+		return jitCheckedBlockCount;
+	}
+
+	uint64_t CPU::GetJitMismatchCount()
+	{
+		return jitMismatchCount;
+	}
+
+	void CPU::Step()
+	{
+		uint16_t instruction = FetchInstruction();
+
+		MoveToNextInstruction();
+
+		// Counted before it's executed, so that an instruction that reads the keypad sees the same count in every dispatch mode
+		instructionCount++;
+
+		ExecuteInstruction(instruction);
+	}
+
+	uint16_t CPU::FetchInstruction()
+	{
+		// Instructions are 16 bytes each, so the bytes at [programCounter] and 
+		// [programCounter + 1] are combined to retrieve the full instruction.
+		return (memory->GetByte(programCounter) << 8) | (memory->GetByte(programCounter + 1));
+	}
+
+	void CPU::ExecuteInstrumented(int instructionCount)
+	{
+		// Every instruction is stepped, even in idle loops, so traces and profiles are the same in every dispatch mode
+		if (profiler != nullptr) UpdateProfilerCallStack();
+
+		for (int i = 0; i < instructionCount && !isWaitingForKey; i++)
+		{
+			uint16_t address = programCounter;
+			uint16_t opcode = FetchInstruction();
+			const DecodedInstruction& decoded = decodeTable[opcode];
+
+			uint8_t previousRegisters[REGISTER_COUNT];
+			std::copy(vRegisters, vRegisters + REGISTER_COUNT, previousRegisters);
+
+			if (profiler == nullptr)
+			{
+				Step();
+			}
+			else
+			{
+				// Pixels are counted before the sprite is drawn, since drawing sets VF, which may be one of the coordinates
+				if ((opcode & 0xF000) == 0xD000) profiler->AddPixels(CountSpritePixels(decoded));
+
+				auto startTime = steady_clock::now();
+				Step();
+				profiler->AddInstruction(address, decoded.profilerFamily, (uint64_t)duration_cast<nanoseconds>(steady_clock::now() - startTime).count());
+
+				if ((opcode & 0xF000) == 0x2000 || opcode == 0x00EE) UpdateProfilerCallStack();
+			}
+
+			if (SHG_TRACE_ENABLED && tracer != nullptr) TraceInstruction(address, opcode, previousRegisters);
+		}
+	}
+
+	void CPU::TraceInstruction(uint16_t address, uint16_t opcode, const uint8_t* previousRegisters)
+	{
+		Tracer::Record record;
+		record.instructionCount = instructionCount;
+		record.address = address;
+		record.opcode = opcode;
+		record.iRegister = iRegister;
+		record.changedRegisters = 0;
+		std::copy(vRegisters, vRegisters + REGISTER_COUNT, record.vRegisters);
+
+		for (int r = 0; r < REGISTER_COUNT; r++)
+		{
+			if (vRegisters[r] != previousRegisters[r]) record.changedRegisters |= 1 << r;
+		}
+
+		tracer->Write(record);
+	}
+
+	void CPU::UpdateProfilerCallStack()
+	{
+		// The stack holds return addresses, so each function is found from the CALL before its return address
+		uint16_t functions[STACK_SIZE];
+		int depth = std::min((int)stackPointer, STACK_SIZE - 1);
+
+		for (int i = 0; i < depth; i++)
+		{
+			uint16_t callAddress = stack[(i + 1) & (STACK_SIZE - 1)] - 2;
+			uint16_t callInstruction = (memory->GetByte(callAddress) << 8) | memory->GetByte(callAddress + 1);
+
+			functions[i] = (callInstruction & 0xF000) == 0x2000 ? callInstruction & 0x0FFF : callAddress;
+		}
+
+		profiler->SetCallStack(functions, depth);
+	}
+
+	int CPU::CountSpritePixels(const DecodedInstruction& instruction)
+	{
+		// Only pixels that end up on the screen are counted, with the same wrapping and clipping as DXYN
+		int width = display->GetWidth();
+		int height = display->GetHeight();
+		int x = vRegisters[instruction.x] % width;
+		int y = vRegisters[instruction.y] % height;
+		int spriteWidth = instruction.n == 0 ? 16 : 8;
+		int spriteHeight = instruction.n == 0 ? 16 : instruction.n;
+		int visibleWidth = quirks.isClipping ? std::min(spriteWidth, width - x) : spriteWidth;
+		int pixelCount = 0;
+		uint16_t spriteAddress = iRegister;
+
+		for (int plane = 0; plane < Display::PLANE_COUNT; plane++)
+		{
+			if ((display->GetPlaneMask() & (1 << plane)) == 0) continue;
+
+			for (int index = 0; index < spriteHeight && (y + index < height || !quirks.isClipping); index++)
+			{
+				uint16_t spriteRow = memory->GetByte(spriteAddress + index * spriteWidth / 8);
+				if (spriteWidth == 16) spriteRow = (spriteRow << 8) | memory->GetByte(spriteAddress + index * 2 + 1);
+
+				pixelCount += CountSetBits(spriteRow >> (spriteWidth - visibleWidth));
+			}
+
+			spriteAddress += spriteHeight * spriteWidth / 8;
+		}
+
+		return pixelCount;
+	}
+
+	void CPU::ExecuteBlocks(int instructionCount)
+	{
+		int remainingInstructions = instructionCount;
+
+		while (remainingInstructions > 0 && !isWaitingForKey)
+		{
+			BasicBlock* block = blockCache->GetBlock(programCounter);
+
+			if (block->idleLoopLength != 0)
+			{
+				int skippedCount = SkipIdleLoop(block, remainingInstructions);
+
+				if (skippedCount > 0)
+				{
+					this->instructionCount += skippedCount;
+					remainingInstructions -= skippedCount;
+					continue;
+				}
+			}
+
+			if (dispatchMode == DispatchMode::Jit)
 			{
-				if (e.type == SDL_QUIT)
+				int nativeCount = ExecuteNativeBlock(block, remainingInstructions);
+
+				if (nativeCount > 0)
 				{
-					isRunning = false;
-					return;
+					remainingInstructions -= nativeCount;
+					continue;
 				}
+			}
+
+			// The block may be removed from the cache by its own final instruction (e.g. FX55 writing over it), which frees 
+			// its instruction array as well. Handlers must not touch their instruction after writing to memory.
+			const DecodedInstruction* instructions = block->instructions.data();
+			int count = std::min((int)block->instructions.size(), remainingInstructions);
 
-				keypad->Update(e);
+			// Only the last instruction of a block can read the keypad, and the count it sees includes itself, the same as with Step
+			this->instructionCount += count;
+
+			for (int i = 0; i < count; i++)
+			{
+				MoveToNextInstruction();
+				(this->*instructions[i].handler)(instructions[i]);
 			}
 
-			Tick();
+			remainingInstructions -= count;
+		}
+	}
+
+	int CPU::SkipIdleLoop(BasicBlock* block, int instructionCount)
+	{
+		// Only whole iterations are skipped, so any remaining instructions are executed as usual
+		int iterationCount = instructionCount / block->idleLoopLength;
+		if (iterationCount == 0) return 0;
+
+		if (block->idleLoopLength == 3)
+		{
+			const DecodedInstruction& loadInstruction = block->instructions[0];
+			const DecodedInstruction& skipInstruction = block->instructions[1];
+
+			// The delay timer doesn't change until the end of the frame, so if the loop doesn't exit now, 
+			// every iteration until then does exactly the same thing.
+			uint8_t delayTimer = (uint8_t)timerRegisters[DELAY_TIMER_INDEX];
+			bool isSkipIfEqual = (skipInstruction.opcode & 0xF000) == 0x3000;
+			bool isExit = isSkipIfEqual ? delayTimer == skipInstruction.kk : delayTimer != skipInstruction.kk;
+
+			if (isExit) return 0;
+
+			vRegisters[loadInstruction.x] = delayTimer;
 		}
+
+		return iterationCount * block->idleLoopLength;
 	}
 
-	void CPU::Tick()
+	int CPU::ExecuteNativeBlock(BasicBlock* block, int maxInstructionCount)
 	{
-		auto currentTime = system_clock::now();
+		// Blocks are cached by their address within memory, so compiled code, which sets the program counter
+		// to absolute addresses, is only used when the program counter hasn't run past the end of memory.
+		if (programCounter != block->startAddress) return 0;
 
-		// Fetch and execute instructions
-		auto fetchDeltaTime = (duration_cast<duration<double, std::milli>> (currentTime - previousInstructionFetchTime)).count();
-		if (fetchDeltaTime >= targetFetchDeltaTime)
+		if (block->nativeCode == nullptr)
 		{
-			// Instructions are 16 bytes each, so the bytes at [programCounter] and 
-			// [programCounter + 1] are combined to retrieve the full instruction.
-			uint16_t instruction = (memory->GetByte(programCounter) << 8) | (memory->GetByte(programCounter + 1));
+			if (++block->executionCount != JIT_COMPILE_THRESHOLD) return 0;
 
-			/*std::cout << "Instruction read from memory: " << std::hex << std::setfill('0') << std::setw(4) << instruction << std::endl;
-			std::cout << std::resetiosflags(std::ios::hex);*/
+			if (jitCompiler->IsFull())
+			{
+				jitCompiler->Reset();
+				blockCache->ClearNativeCode();
+			}
 
-			MoveToNextInstruction();
+			block->nativeCode = jitCompiler->Compile(block->startAddress, block->instructions.data(), 
+				(int)block->instructions.size(), &block->nativeInstructionCount);
 
-			ExecuteInstruction(instruction);
+			if (block->nativeCode == nullptr) return 0;
+		}
 
-			previousInstructionFetchTime = currentTime;
+		// Compiled code always runs to the end, so it can't be used when fewer instructions are left in the frame
+		int count = block->nativeInstructionCount;
+		if (count > maxInstructionCount) return 0;
+
+		instructionCount += count;
+
+		if (isJitCheckEnabled)
+		{
+			CheckNativeBlock(block);
 		}
+		else
+		{
+			jitCompiler->Run(block->nativeCode);
+		}
+
+		return count;
+	}
+
+	void CPU::CheckNativeBlock(BasicBlock* block)
+	{
+		JitCompiler::NativeBlock nativeCode = block->nativeCode;
+		int count = block->nativeInstructionCount;
+		uint16_t startAddress = block->startAddress;
+
+		// The block may be removed from the cache while it executes, so it isn't used after this point
+		RegisterState initialRegisters;
+		SaveRegisters(&initialRegisters);
+		uint64_t initialRandomState[Random::STATE_SIZE];
+		random.GetState(initialRandomState);
+		std::vector<uint8_t> initialMemory(memory->GetData(), memory->GetData() + Memory::TOTAL_MEMORY);
+		Display initialDisplay = *display;
+
+		jitCompiler->Run(nativeCode);
+
+		RegisterState nativeRegisters;
+		SaveRegisters(&nativeRegisters);
+		std::vector<uint8_t> nativeMemory(memory->GetData(), memory->GetData() + Memory::TOTAL_MEMORY);
+		Display nativeDisplay = *display;
+
+		// Run the same instructions again with the interpreter, starting from the same state
+		LoadRegisters(&initialRegisters);
+		random.SetState(initialRandomState);
+		memory->SetData(initialMemory.data());
+		*display = initialDisplay;
+
+		// Step() counts the instructions itself, but they have already been counted for the compiled code
+		instructionCount -= count;
+		for (int i = 0; i < count; i++) Step();
+
+		RegisterState interpretedRegisters;
+		SaveRegisters(&interpretedRegisters);
+
+		bool isDisplayEqual = display->IsScreenEqual(nativeDisplay);
+
+		jitCheckedBlockCount++;
+
+		if (memcmp(&nativeRegisters, &interpretedRegisters, sizeof(RegisterState)) == 0 && isDisplayEqual
+			&& std::equal(nativeMemory.begin(), nativeMemory.end(), memory->GetData()))
+		{
+			return;
+		}
+
+		jitMismatchCount++;
+
+		std::cout << "JIT mismatch in block at 0x" << std::hex << std::setfill('0') << std::setw(3) << startAddress << std::endl;
+		std::cout << "  Native PC: " << std::setw(3) << nativeRegisters.programCounter 
+			<< ", interpreter PC: " << std::setw(3) << interpretedRegisters.programCounter << std::endl;
+		std::cout << "  Native I: " << std::setw(3) << nativeRegisters.iRegister 
+			<< ", interpreter I: " << std::setw(3) << interpretedRegisters.iRegister << std::endl;
+
+		for (int i = 0; i < REGISTER_COUNT; i++)
+		{
+			if (nativeRegisters.vRegisters[i] == interpretedRegisters.vRegisters[i]) continue;
+
+			std::cout << "  V" << i << ": native " << std::setw(2) << (int)nativeRegisters.vRegisters[i] 
+				<< ", interpreter " << std::setw(2) << (int)interpretedRegisters.vRegisters[i] << std::endl;
+		}
+
+		std::cout << std::resetiosflags(std::ios::hex);
+	}
+
+	void CPU::SaveRegisters(RegisterState* state)
+	{
+		// Zero the padding so that states can be compared with memcmp
+		memset(state, 0, sizeof(RegisterState));
+
+		std::copy(vRegisters, vRegisters + REGISTER_COUNT, state->vRegisters);
+		state->iRegister = iRegister;
+		state->programCounter = programCounter;
+		std::copy(stack, stack + STACK_SIZE, state->stack);
+		state->stackPointer = stackPointer;
+		std::copy(timerRegisters, timerRegisters + 2, state->timerRegisters);
+	}
+
+	void CPU::LoadRegisters(const RegisterState* state)
+	{
+		std::copy(state->vRegisters, state->vRegisters + REGISTER_COUNT, vRegisters);
+		iRegister = state->iRegister;
+		programCounter = state->programCounter;
+		std::copy(state->stack, state->stack + STACK_SIZE, stack);
+		stackPointer = state->stackPointer;
+		std::copy(state->timerRegisters, state->timerRegisters + 2, timerRegisters);
+	}
+
+	void CPU::SaveState(State* state)
+	{
+		memset(state, 0, sizeof(State));
+
+		SaveRegisters(&state->registers);
+		random.GetState(state->randomState);
+		state->frameCount = frameCount;
+		state->instructionCount = instructionCount;
+		state->frameInstructionRemainder = frameInstructionRemainder;
+		state->isWaitingForKey = isWaitingForKey;
+		state->keyWaitRegister = keyWaitRegister;
+		std::copy(flagRegisters, flagRegisters + REGISTER_COUNT, state->flagRegisters);
+		std::copy(audioPattern, audioPattern + Sound::PATTERN_SIZE, state->audioPattern);
+		state->audioPitch = audioPitch;
+	}
 
-		// Update timers
-		auto timerDeltaTime = (duration_cast<duration<double, std::milli>> (currentTime - previousTimerUpdateTime)).count();
-		if (timerDeltaTime >= TARGET_TIMER_UPDATE_DELTA_TIME)
+	void CPU::LoadState(const State& state)
+	{
+		LoadRegisters(&state.registers);
+		random.SetState(state.randomState);
+		frameCount = state.frameCount;
+		instructionCount = state.instructionCount;
+		frameInstructionRemainder = state.frameInstructionRemainder;
+		isWaitingForKey = state.isWaitingForKey != 0;
+		keyWaitRegister = state.keyWaitRegister & (REGISTER_COUNT - 1);
+		std::copy(state.flagRegisters, state.flagRegisters + REGISTER_COUNT, flagRegisters);
+		std::copy(state.audioPattern, state.audioPattern + Sound::PATTERN_SIZE, audioPattern);
+		audioPitch = state.audioPitch;
+		isSoundPlaying = timerRegisters[SOUND_TIMER_INDEX] > 0;
+
+		// Continue the replay from the events that come after the restored point
+		if (inputReplay != nullptr)
 		{
-			// Decrement timers, and prevent them from being less than zero
-			timerRegisters[DELAY_TIMER_INDEX] = std::max(timerRegisters[DELAY_TIMER_INDEX] - 1, 0);
-			timerRegisters[SOUND_TIMER_INDEX] = std::max(timerRegisters[SOUND_TIMER_INDEX] - 1, 0);
+			const std::vector<InputRecording::Event>& events = inputReplay->GetEvents();
+			inputReplayPosition = 0;
 
-			previousTimerUpdateTime = currentTime;
+			while (inputReplayPosition < events.size())
+			{
+				if (!IsInputEventDue(events[inputReplayPosition])) break;
+				inputReplayPosition++;
+			}
 		}
+	}
 
-	/*	PrintStackPointerValue();
-		PrintStackValues();
-		PrintProgramCounterValue();
-		PrintRegisterValues();
-		PrintDelayTimerValue();
-		PrintSoundTimerValue();*/
+	void CPU::ExecuteFallbackInstruction(CPU* cpu, const DecodedInstruction* instruction)
+	{
+		(cpu->*instruction->handler)(*instruction);
+	}
 
+	void CPU::UpdateTimers()
+	{
+		// A sound timer of 1 still plays for the frame in which it runs out
+		isSoundPlaying = timerRegisters[SOUND_TIMER_INDEX] > 0;
+
+		// Decrement timers, and prevent them from being less than zero
+		timerRegisters[DELAY_TIMER_INDEX] = std::max(timerRegisters[DELAY_TIMER_INDEX] - 1, 0);
+		timerRegisters[SOUND_TIMER_INDEX] = std::max(timerRegisters[SOUND_TIMER_INDEX] - 1, 0);
 	}
 
 	void CPU::ExecuteInstruction(uint16_t instruction)
 	{
+		if (dispatchMode == DispatchMode::Switch)
+		{
+			DecodedInstruction decoded = decodeInstruction(instruction);
+			(this->*decoded.handler)(decoded);
+		}
+		else
+		{
+			const DecodedInstruction& decoded = decodeTable[instruction];
+			(this->*decoded.handler)(decoded);
+		}
+	}
+
+	template<typename Quirks>
+	const CPU::DecodedInstruction* CPU::GetDecodeTable()
+	{
+		// Every possible 16-bit instruction is decoded once, the first time a CPU is created.
+		// The table is shared by all CPUs, since it doesn't depend on the state of the machine.
+		static const std::vector<DecodedInstruction> table = []()
+		{
+			std::vector<DecodedInstruction> decodedInstructions(DECODE_TABLE_SIZE);
+
+			for (int i = 0; i < DECODE_TABLE_SIZE; i++)
+			{
+				decodedInstructions[i] = DecodeInstruction<Quirks>(i);
+				decodedInstructions[i].profilerFamily = GetProfilerFamily<Quirks>(decodedInstructions[i].handler);
+			}
+
+			return decodedInstructions;
+		}();
+
+		return table.data();
+	}
+
+	template<typename Quirks>
+	Profiler::Family CPU::GetProfilerFamily(InstructionHandler handler)
+	{
+		// Families follow the handlers the decoder picked, so a profile can't disagree with what was executed. 
+		// A handler that's missing here is counted as unknown.
+		static const std::pair<InstructionHandler, Profiler::Family> FAMILIES[] =
+		{
+			{ &CPU::Execute_0NNN, Profiler::FAMILY_0NNN },
+			{ &CPU::Execute_00E0, Profiler::FAMILY_00E0 },
+			{ &CPU::Execute_00EE, Profiler::FAMILY_00EE },
+			{ &CPU::Execute_1NNN, Profiler::FAMILY_1NNN },
+			{ &CPU::Execute_2NNN, Profiler::FAMILY_2NNN },
+			{ &CPU::Execute_3XKK, Profiler::FAMILY_3XKK },
+			{ &CPU::Execute_4XKK, Profiler::FAMILY_4XKK },
+			{ &CPU::Execute_5XY0, Profiler::FAMILY_5XY0 },
+			{ &CPU::Execute_6XKK, Profiler::FAMILY_6XKK },
+			{ &CPU::Execute_7XKK, Profiler::FAMILY_7XKK },
+			{ &CPU::Execute_8XY0, Profiler::FAMILY_8XY0 },
+			{ &CPU::Execute_8XY1<Quirks>, Profiler::FAMILY_8XY1 },
+			{ &CPU::Execute_8XY2<Quirks>, Profiler::FAMILY_8XY2 },
+			{ &CPU::Execute_8XY3<Quirks>, Profiler::FAMILY_8XY3 },
+			{ &CPU::Execute_8XY4, Profiler::FAMILY_8XY4 },
+			{ &CPU::Execute_8XY5<Quirks>, Profiler::FAMILY_8XY5 },
+			{ &CPU::Execute_8XY6<Quirks>, Profiler::FAMILY_8XY6 },
+			{ &CPU::Execute_8XY7<Quirks>, Profiler::FAMILY_8XY7 },
+			{ &CPU::Execute_8XYE<Quirks>, Profiler::FAMILY_8XYE },
+			{ &CPU::Execute_9XY0, Profiler::FAMILY_9XY0 },
+			{ &CPU::Execute_ANNN, Profiler::FAMILY_ANNN },
+			{ &CPU::Execute_BNNN<Quirks>, Profiler::FAMILY_BNNN },
+			{ &CPU::Execute_CXKK, Profiler::FAMILY_CXKK },
+			{ &CPU::Execute_DXYN<Quirks>, Profiler::FAMILY_DXYN },
+			{ &CPU::Execute_EX9E, Profiler::FAMILY_EX9E },
+			{ &CPU::Execute_EXA1, Profiler::FAMILY_EXA1 },
+			{ &CPU::Execute_FX07, Profiler::FAMILY_FX07 },
+			{ &CPU::Execute_FX0A, Profiler::FAMILY_FX0A },
+			{ &CPU::Execute_FX15, Profiler::FAMILY_FX15 },
+			{ &CPU::Execute_FX18, Profiler::FAMILY_FX18 },
+			{ &CPU::Execute_FX1E, Profiler::FAMILY_FX1E },
+			{ &CPU::Execute_FX29, Profiler::FAMILY_FX29 },
+			{ &CPU::Execute_FX33, Profiler::FAMILY_FX33 },
+			{ &CPU::Execute_FX55<Quirks>, Profiler::FAMILY_FX55 },
+			{ &CPU::Execute_FX65<Quirks>, Profiler::FAMILY_FX65 },
+			{ &CPU::Execute_00CN, Profiler::FAMILY_00CN },
+			{ &CPU::Execute_00DN, Profiler::FAMILY_00DN },
+			{ &CPU::Execute_00FB, Profiler::FAMILY_00FB },
+			{ &CPU::Execute_00FC, Profiler::FAMILY_00FC },
+			{ &CPU::Execute_00FD, Profiler::FAMILY_00FD },
+			{ &CPU::Execute_00FE, Profiler::FAMILY_00FE },
+			{ &CPU::Execute_00FF, Profiler::FAMILY_00FF },
+			{ &CPU::Execute_5XY2, Profiler::FAMILY_5XY2 },
+			{ &CPU::Execute_5XY3, Profiler::FAMILY_5XY3 },
+			{ &CPU::Execute_F000, Profiler::FAMILY_F000 },
+			{ &CPU::Execute_FN01, Profiler::FAMILY_FN01 },
+			{ &CPU::Execute_FX30, Profiler::FAMILY_FX30 },
+			{ &CPU::Execute_FX75, Profiler::FAMILY_FX75 },
+			{ &CPU::Execute_FX85, Profiler::FAMILY_FX85 },
+			{ &CPU::Execute_F002, Profiler::FAMILY_F002 },
+			{ &CPU::Execute_FX3A, Profiler::FAMILY_FX3A },
+		};
+
+		for (const auto& family : FAMILIES)
+		{
+			if (family.first == handler) return family.second;
+		}
+
+		return Profiler::FAMILY_UNKNOWN;
+	}
+
+	template<typename Quirks>
+	CPU::DecodedInstruction CPU::DecodeInstruction(uint16_t instruction)
+	{
+		DecodedInstruction decoded;
+		decoded.handler = &CPU::Execute_Unsupported;
+		decoded.opcode = instruction;
+		decoded.nnn = instruction & 0x0FFF;
+		decoded.x = GetX(instruction);
+		decoded.y = GetY(instruction);
+		decoded.kk = instruction & 0x00FF;
+		decoded.n = instruction & 0x000F;
+		decoded.endsBlock = false;
+		decoded.profilerFamily = Profiler::FAMILY_UNKNOWN;
+
 		switch (instruction & 0xF000) // Ignore last 12 bits
 		{
 		case 0x0000:
 			switch (instruction)
 			{
 			case 0x00E0:
-				Execute_00E0(instruction);
+				decoded.handler = &CPU::Execute_00E0;
 				break;
 			case 0x00EE:
-				Execute_00EE(instruction);
+				decoded.handler = &CPU::Execute_00EE;
+				break;
+			case 0x00FB:
+				decoded.handler = &CPU::Execute_00FB;
+				break;
+			case 0x00FC:
+				decoded.handler = &CPU::Execute_00FC;
+				break;
+			case 0x00FD:
+				decoded.handler = &CPU::Execute_00FD;
+				break;
+			case 0x00FE:
+				decoded.handler = &CPU::Execute_00FE;
+				break;
+			case 0x00FF:
+				decoded.handler = &CPU::Execute_00FF;
 				break;
 			default:
-				Execute_0NNN(instruction);
+				if ((instruction & 0xFFF0) == 0x00C0) decoded.handler = &CPU::Execute_00CN;
+				else if ((instruction & 0xFFF0) == 0x00D0) decoded.handler = &CPU::Execute_00DN;
+				else decoded.handler = &CPU::Execute_0NNN;
 				break;
 			}
 			break;
 		case 0x1000:
-			Execute_1NNN(instruction);
+			decoded.handler = &CPU::Execute_1NNN;
 			break;
 		case 0x2000:
-			Execute_2NNN(instruction);
+			decoded.handler = &CPU::Execute_2NNN;
 			break;
 		case 0x3000:
-			Execute_3XKK(instruction);
+			decoded.handler = &CPU::Execute_3XKK;
 			break;
 		case 0x4000:
-			Execute_4XKK(instruction);
+			decoded.handler = &CPU::Execute_4XKK;
 			break;
 		case 0x5000:
-			Execute_5XY0(instruction);
+			if ((instruction & 0x000F) == 0x2) decoded.handler = &CPU::Execute_5XY2;
+			else if ((instruction & 0x000F) == 0x3) decoded.handler = &CPU::Execute_5XY3;
+			else decoded.handler = &CPU::Execute_5XY0;
 			break;
 		case 0x6000:
-			Execute_6XKK(instruction);
+			decoded.handler = &CPU::Execute_6XKK;
 			break;
 		case 0x7000:
-			Execute_7XKK(instruction);
+			decoded.handler = &CPU::Execute_7XKK;
 			break;
 		case 0x8000:
 			switch (instruction & 0xF00F) // Ignore middle byte
 			{
 			case 0x8000:
-				Execute_8XY0(instruction);
+				decoded.handler = &CPU::Execute_8XY0;
 				break;
 			case 0x8001:
-				Execute_8XY1(instruction);
+				decoded.handler = &CPU::Execute_8XY1<Quirks>;
 				break;
 			case 0x8002:
-				Execute_8XY2(instruction);
+				decoded.handler = &CPU::Execute_8XY2<Quirks>;
 				break;
 			case 0x8003:
-				Execute_8XY3(instruction);
+				decoded.handler = &CPU::Execute_8XY3<Quirks>;
 				break;
 			case 0x8004:
-				Execute_8XY4(instruction);
+				decoded.handler = &CPU::Execute_8XY4;
 				break;
 			case 0x8005:
-				Execute_8XY5(instruction);
+				decoded.handler = &CPU::Execute_8XY5<Quirks>;
 				break;
 			case 0x8006:
-				Execute_8XY6(instruction);
+				decoded.handler = &CPU::Execute_8XY6<Quirks>;
 				break;
 			case 0x8007:
-				Execute_8XY7(instruction);
+				decoded.handler = &CPU::Execute_8XY7<Quirks>;
 				break;
 			case 0x800E:
-				Execute_8XYE(instruction);
+				decoded.handler = &CPU::Execute_8XYE<Quirks>;
 				break;
 			}
 			break;
 		case 0x9000:
-			Execute_9XY0(instruction);
+			decoded.handler = &CPU::Execute_9XY0;
 			break;
 		case 0xA000:
-			Execute_ANNN(instruction);
+			decoded.handler = &CPU::Execute_ANNN;
 			break;
 		case 0xB000:
-			Execute_BNNN(instruction);
+			decoded.handler = &CPU::Execute_BNNN<Quirks>;
 			break;
 		case 0xC000:
-			Execute_CXKK(instruction);
+			decoded.handler = &CPU::Execute_CXKK;
 			break;
 		case 0xD000:
-			Execute_DXYN(instruction);
+			decoded.handler = &CPU::Execute_DXYN<Quirks>;
 			break;
 		case 0xE000:
 			switch (instruction & 0xF0FF) // Ignore second half-byte
 			{
 			case 0xE09E:
-				Execute_EX9E(instruction);
+				decoded.handler = &CPU::Execute_EX9E;
 				break;
 			case 0xE0A1:
-				Execute_EXA1(instruction);
+				decoded.handler = &CPU::Execute_EXA1;
 				break;
 			}
 			break;
 		case 0xF000:
 			switch (instruction & 0xF0FF) // Ignore second half-byte
 			{
+			case 0xF000:
+				if (instruction == 0xF000) decoded.handler = &CPU::Execute_F000;
+				break;
+			case 0xF001:
+				decoded.handler = &CPU::Execute_FN01;
+				break;
+			case 0xF002:
+				if (instruction == 0xF002) decoded.handler = &CPU::Execute_F002;
+				break;
 			case 0xF007:
-				Execute_FX07(instruction);
+				decoded.handler = &CPU::Execute_FX07;
 				break;
 			case 0xF00A:
-				Execute_FX0A(instruction);
+				decoded.handler = &CPU::Execute_FX0A;
 				break;
 			case 0xF015:
-				Execute_FX15(instruction);
+				decoded.handler = &CPU::Execute_FX15;
 				break;
 			case 0xF018:
-				Execute_FX18(instruction);
+				decoded.handler = &CPU::Execute_FX18;
 				break;
 			case 0xF01E:
-				Execute_FX1E(instruction);
+				decoded.handler = &CPU::Execute_FX1E;
 				break;
 			case 0xF029:
-				Execute_FX29(instruction);
+				decoded.handler = &CPU::Execute_FX29;
+				break;
+			case 0xF030:
+				decoded.handler = &CPU::Execute_FX30;
 				break;
 			case 0xF033:
-				Execute_FX33(instruction);
+				decoded.handler = &CPU::Execute_FX33;
+				break;
+			case 0xF03A:
+				decoded.handler = &CPU::Execute_FX3A;
 				break;
 			case 0xF055:
-				Execute_FX55(instruction);
+				decoded.handler = &CPU::Execute_FX55<Quirks>;
 				break;
 			case 0xF065:
-				Execute_FX65(instruction);
+				decoded.handler = &CPU::Execute_FX65<Quirks>;
+				break;
+			case 0xF075:
+				decoded.handler = &CPU::Execute_FX75;
+				break;
+			case 0xF085:
+				decoded.handler = &CPU::Execute_FX85;
 				break;
 			}
 			break;
 		}
+
+		switch (instruction & 0xF000)
+		{
+		case 0x0000:
+			// SYS, RET and EXIT
+			decoded.endsBlock = decoded.handler == &CPU::Execute_0NNN || instruction == 0x00EE || instruction == 0x00FD;
+			break;
+		case 0x1000:
+		case 0x2000:
+		case 0x3000:
+		case 0x4000:
+		case 0x5000:
+		case 0x9000:
+		case 0xB000:
+		case 0xE000:
+			// Jumps, calls and skips
+			decoded.endsBlock = true;
+			break;
+		case 0xF000:
+			// F000 NNNN skips its address, FX0A stops execution until a key is released, and FX33/FX55 may overwrite cached instructions
+			decoded.endsBlock = instruction == 0xF000 || (instruction & 0xF0FF) == 0xF00A || (instruction & 0xF0FF) == 0xF033 || (instruction & 0xF0FF) == 0xF055;
+			break;
+		}
+
+		return decoded;
 	}
 
-	void CPU::Execute_0NNN(uint16_t instruction)
+	void CPU::Execute_Unsupported(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("0NNN");
-
-		programCounter = instruction & 0x0FFF;
+		// Instructions that don't match any known opcode are skipped
 	}
 
-	void CPU::Execute_00E0(uint16_t instruction)
+	void CPU::Execute_0NNN(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("00E0");
+		programCounter = instruction.nnn;
+	}
 
+	void CPU::Execute_00E0(const DecodedInstruction& instruction)
+	{
 		display->Clear();
 	}
 
-	void CPU::Execute_00EE(uint16_t instruction)
+	void CPU::Execute_00EE(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("00EE");
-
-		programCounter = stack[stackPointer];
+		// The stack pointer wraps around instead of reading outside of the stack
+		programCounter = stack[stackPointer & (STACK_SIZE - 1)];
 		stackPointer--;
 	}
 
-	void CPU::Execute_1NNN(uint16_t instruction)
+	void CPU::Execute_00CN(const DecodedInstruction& instruction)
+	{
+		display->ScrollDown(instruction.n);
+	}
+
+	void CPU::Execute_00DN(const DecodedInstruction& instruction)
+	{
+		display->ScrollUp(instruction.n);
+	}
+
+	void CPU::Execute_00FB(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("1NNN");
+		display->ScrollRight(4);
+	}
+
+	void CPU::Execute_00FC(const DecodedInstruction& instruction)
+	{
+		display->ScrollLeft(4);
+	}
 
-		programCounter = instruction & 0x0FFF;
+	void CPU::Execute_00FD(const DecodedInstruction& instruction)
+	{
+		// The program has ended, so it stays on this instruction. Timers and the screen keep going.
+		programCounter -= 2;
 	}
 
-	void CPU::Execute_2NNN(uint16_t instruction)
+	void CPU::Execute_00FE(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("2NNN");
+		display->SetHighRes(false);
+	}
 
+	void CPU::Execute_00FF(const DecodedInstruction& instruction)
+	{
+		display->SetHighRes(true);
+	}
+
+	void CPU::Execute_1NNN(const DecodedInstruction& instruction)
+	{
+		programCounter = instruction.nnn;
+	}
+
+	void CPU::Execute_2NNN(const DecodedInstruction& instruction)
+	{
 		stackPointer++;
 
 		//Place next subroutine on the top of the stack
-		stack[stackPointer] = programCounter;
+		stack[stackPointer & (STACK_SIZE - 1)] = programCounter;
 
-		programCounter = instruction & 0x0FFF;
+		programCounter = instruction.nnn;
 	}
 
-	void CPU::Execute_3XKK(uint16_t instruction)
+	void CPU::Execute_3XKK(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("3XKK");
-
 		// If Vx is equal to kk, then skip the next instruction
-		if (vRegisters[GetX(instruction)] == (instruction & 0x00FF)) MoveToNextInstruction();
+		if (vRegisters[instruction.x] == instruction.kk) SkipNextInstruction();
 	}
 
-	void CPU::Execute_4XKK(uint16_t instruction)
+	void CPU::Execute_4XKK(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("4XKK");
-
 		// If Vx is NOT equal to kk, then skip the next instruction
-		if (vRegisters[GetX(instruction)] != (instruction & 0x00FF)) MoveToNextInstruction();
+		if (vRegisters[instruction.x] != instruction.kk) SkipNextInstruction();
 	}
 
-	void CPU::Execute_5XY0(uint16_t instruction)
+	void CPU::Execute_5XY0(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("5XY0");
-
 		//If Vx is equal to Vy, then skip the next instruction
-		if (vRegisters[GetX(instruction)] == vRegisters[GetY(instruction)]) MoveToNextInstruction();
+		if (vRegisters[instruction.x] == vRegisters[instruction.y]) SkipNextInstruction();
 	}
 
-	void CPU::Execute_6XKK(uint16_t instruction)
+	void CPU::Execute_5XY2(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("6XKK");
+		// The registers from X to Y are stored in that order, even if X is greater than Y. I isn't changed.
+		uint8_t x = instruction.x;
+		int step = instruction.x <= instruction.y ? 1 : -1;
+		int count = std::abs(instruction.y - instruction.x) + 1;
 
-		uint8_t xRegId = GetX(instruction);
-		vRegisters[xRegId] = instruction & 0x00FF;
+		for (int i = 0; i < count; i++) memory->SetByte(iRegister + i, vRegisters[x + i * step]);
 	}
 
-	void CPU::Execute_7XKK(uint16_t instruction)
+	void CPU::Execute_5XY3(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("7XKK");
+		int step = instruction.x <= instruction.y ? 1 : -1;
+		int count = std::abs(instruction.y - instruction.x) + 1;
 
-		uint8_t xRegId = GetX(instruction);
-		vRegisters[xRegId] += instruction & 0x00FF;
+		for (int i = 0; i < count; i++) vRegisters[instruction.x + i * step] = memory->GetByte(iRegister + i);
 	}
 
-	void CPU::Execute_8XY0(uint16_t instruction)
+	void CPU::Execute_6XKK(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("8XY0");
+		uint8_t xRegId = instruction.x;
+		vRegisters[xRegId] = instruction.kk;
+	}
 
-		uint8_t xRegId = GetX(instruction);
-		uint8_t yRegId = GetY(instruction);
-		vRegisters[xRegId] = vRegisters[yRegId];
+	void CPU::Execute_7XKK(const DecodedInstruction& instruction)
+	{
+		uint8_t xRegId = instruction.x;
+		vRegisters[xRegId] += instruction.kk;
 	}
 
-	void CPU::Execute_8XY1(uint16_t instruction)
+	void CPU::Execute_8XY0(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("8XY1");
+		uint8_t xRegId = instruction.x;
+		uint8_t yRegId = instruction.y;
+		vRegisters[xRegId] = vRegisters[yRegId];
+	}
 
-		uint8_t xRegId = GetX(instruction);
-		uint8_t yRegId = GetY(instruction);
+	template<typename Quirks>
+	void CPU::Execute_8XY1(const DecodedInstruction& instruction)
+	{
+		uint8_t xRegId = instruction.x;
+		uint8_t yRegId = instruction.y;
 		vRegisters[xRegId] |= vRegisters[yRegId];
+
+		if (Quirks::IS_FLAG_RESET) vRegisters[VF_REG_INDEX] = 0;
 	}
 
-	void CPU::Execute_8XY2(uint16_t instruction)
+	template<typename Quirks>
+	void CPU::Execute_8XY2(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("8XY2");
-
-		uint8_t xRegId = GetX(instruction);
-		uint8_t yRegId = GetY(instruction);
+		uint8_t xRegId = instruction.x;
+		uint8_t yRegId = instruction.y;
 		vRegisters[xRegId] = vRegisters[xRegId] & vRegisters[yRegId];
+
+		if (Quirks::IS_FLAG_RESET) vRegisters[VF_REG_INDEX] = 0;
 	}
 
-	void CPU::Execute_8XY3(uint16_t instruction)
+	template<typename Quirks>
+	void CPU::Execute_8XY3(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("8XY3");
-
-		uint8_t xRegId = GetX(instruction);
-		uint8_t yRegId = GetY(instruction);
+		uint8_t xRegId = instruction.x;
+		uint8_t yRegId = instruction.y;
 
 		// XOR
 		vRegisters[xRegId] ^= vRegisters[yRegId];
+
+		if (Quirks::IS_FLAG_RESET) vRegisters[VF_REG_INDEX] = 0;
 	}
 
-	void CPU::Execute_8XY4(uint16_t instruction)
+	void CPU::Execute_8XY4(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("8XY4");
-
-		uint8_t xRegId = GetX(instruction);
-		uint8_t yRegId = GetY(instruction);
+		uint8_t xRegId = instruction.x;
+		uint8_t yRegId = instruction.y;
 
 		uint16_t sum = vRegisters[xRegId] + vRegisters[yRegId];
 
@@ -355,243 +1286,238 @@ namespace SHG
 		vRegisters[VF_REG_INDEX] = sum > 0xFF ? 1 : 0;
 	}
 
-	void CPU::Execute_8XY5(uint16_t instruction)
+	template<typename Quirks>
+	void CPU::Execute_8XY5(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("8XY5");
-
-		uint8_t xRegId = GetX(instruction);
-		uint8_t yRegId = GetY(instruction);
+		uint8_t xRegId = instruction.x;
+		uint8_t yRegId = instruction.y;
 
 		// If Vx is greater than Vy, then set VF to 1, otherwise set VF to 0
-		vRegisters[VF_REG_INDEX] = vRegisters[xRegId] > vRegisters[yRegId] ? 1 : 0;
+		uint8_t flag = vRegisters[xRegId] > vRegisters[yRegId] ? 1 : 0;
 
+		if (!Quirks::IS_FLAG_WRITTEN_LAST) vRegisters[VF_REG_INDEX] = flag;
 		vRegisters[xRegId] -= vRegisters[yRegId];
+		if (Quirks::IS_FLAG_WRITTEN_LAST) vRegisters[VF_REG_INDEX] = flag;
 	}
 
-	void CPU::Execute_8XY6(uint16_t instruction)
+	template<typename Quirks>
+	void CPU::Execute_8XY6(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("8XY6");
-
-		uint8_t xRegId = GetX(instruction);
+		uint8_t xRegId = instruction.x;
+		uint8_t sourceRegId = Quirks::IS_SHIFTING_VY ? instruction.y : xRegId;
 
-		// If the least significant bit of vRegisters[x] is 1, then set VF to 1, otherwise set VF to 0
-		vRegisters[VF_REG_INDEX] = (vRegisters[xRegId] & 1) == 1 ? 1 : 0;
+		// If the least significant bit of the source is 1, then set VF to 1, otherwise set VF to 0
+		uint8_t flag = vRegisters[sourceRegId] & 1;
 
-		vRegisters[xRegId] /= 2;
+		if (!Quirks::IS_FLAG_WRITTEN_LAST) vRegisters[VF_REG_INDEX] = flag;
+		vRegisters[xRegId] = vRegisters[sourceRegId] >> 1;
+		if (Quirks::IS_FLAG_WRITTEN_LAST) vRegisters[VF_REG_INDEX] = flag;
 	}
 
-	void CPU::Execute_8XY7(uint16_t instruction)
+	template<typename Quirks>
+	void CPU::Execute_8XY7(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("8XY7");
+		uint8_t xRegId = instruction.x;
+		uint8_t yRegId = instruction.y;
 
-		uint8_t xRegId = GetX(instruction);
-		uint8_t yRegId = GetY(instruction);
+		uint8_t flag = vRegisters[yRegId] > vRegisters[xRegId] ? 1 : 0;
 
-		vRegisters[VF_REG_INDEX] = vRegisters[yRegId] > vRegisters[xRegId] ? 1 : 0;
+		if (!Quirks::IS_FLAG_WRITTEN_LAST) vRegisters[VF_REG_INDEX] = flag;
 		vRegisters[xRegId] = vRegisters[yRegId] - vRegisters[xRegId];
+		if (Quirks::IS_FLAG_WRITTEN_LAST) vRegisters[VF_REG_INDEX] = flag;
 	}
 
-	void CPU::Execute_8XYE(uint16_t instruction)
+	template<typename Quirks>
+	void CPU::Execute_8XYE(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("8XYE");
+		uint8_t xRegId = instruction.x;
+		uint8_t sourceRegId = Quirks::IS_SHIFTING_VY ? instruction.y : xRegId;
 
-		uint8_t xRegId = GetX(instruction);
+		// If the most significant bit of the source is 1, then set VF to 1, otherwise set VF to 0
+		uint8_t flag = vRegisters[sourceRegId] >> 7;
 
-		// If the most significant bit of Vx is 1, then set VF to 1, otherwise set VF to 0
-		// 128 (decimal) = 10000000 (binary)
-		vRegisters[VF_REG_INDEX] = ((vRegisters[xRegId] & 128) >> 7) == 1 ? 1 : 0;
-
-		vRegisters[xRegId] *= 2;
+		if (!Quirks::IS_FLAG_WRITTEN_LAST) vRegisters[VF_REG_INDEX] = flag;
+		vRegisters[xRegId] = vRegisters[sourceRegId] << 1;
+		if (Quirks::IS_FLAG_WRITTEN_LAST) vRegisters[VF_REG_INDEX] = flag;
 	}
 
-	void CPU::Execute_9XY0(uint16_t instruction)
+	void CPU::Execute_9XY0(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("9XY0");
-
-		uint8_t xRegId = GetX(instruction);
-		uint8_t yRegId = GetY(instruction);
+		uint8_t xRegId = instruction.x;
+		uint8_t yRegId = instruction.y;
 
 		// If Vx is NOT equal to Vy, then skip the next instruction
-		if (vRegisters[xRegId] != vRegisters[yRegId]) MoveToNextInstruction();
+		if (vRegisters[xRegId] != vRegisters[yRegId]) SkipNextInstruction();
 	}
 
-	void CPU::Execute_ANNN(uint16_t instruction)
+	void CPU::Execute_ANNN(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("ANNN");
-
-		iRegister = instruction & 0x0FFF;
+		iRegister = instruction.nnn;
 
 		//std::cout << "Register 'I' updated: " << iRegister << std::endl;
 	}
 
-	void CPU::Execute_BNNN(uint16_t instruction)
+	template<typename Quirks>
+	void CPU::Execute_BNNN(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("BNNN");
-
-		programCounter = (instruction & 0x0FFF) + vRegisters[0];
+		programCounter = (instruction.nnn) + vRegisters[Quirks::IS_JUMPING_WITH_VX ? instruction.x : 0];
 	}
 
-	void CPU::Execute_CXKK(uint16_t instruction)
+	void CPU::Execute_CXKK(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("CXKK");
+		uint8_t xRegId = instruction.x;
 
-		uint8_t xRegId = GetX(instruction);
-
-		//TODO: Use a better method of getting random numbers
-		uint8_t randNum = rand() % 255;
-
-		vRegisters[xRegId] = randNum & (instruction & 0x00FF);
+		vRegisters[xRegId] = random.NextByte() & instruction.kk;
 	}
 
-	void CPU::Execute_DXYN(uint16_t instruction)
+	template<typename Quirks>
+	void CPU::Execute_DXYN(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("DXYN");
-
-		vRegisters[VF_REG_INDEX] = 0;
+		uint8_t xRegId = instruction.x;
+		uint8_t yRegId = instruction.y;
+		int width = display->GetWidth();
+		int height = display->GetHeight();
 
-		uint8_t xRegId = GetX(instruction);
-		uint8_t yRegId = GetY(instruction);
-		uint16_t spriteSize = instruction & 0x000F;
-
-		//std::cout << "Drawing sprite with size: 8 x " << spriteSize << std::endl;
-
-		// If vRegisters[xRegId] is outside of the screen coordinates
+		// If vRegisters[xRegId] or vRegisters[yRegId] is outside of the screen coordinates
 		// wrap the sprite so that it appears on the opposite side of the screen.
-		int x = vRegisters[xRegId] % Display::LOW_RES_SCREEN_WIDTH;
+		// The coordinates are read before VF is cleared, since VF may be one of them.
+		int x = vRegisters[xRegId] % width;
+		int y = vRegisters[yRegId] % height;
 
-		for (int index = 0; index < spriteSize; index++)
-		{
-			// If vRegisters[yRegId] is outside of the screen coordinates
-			// wrap the sprite so that it appears on the opposite side of the screen.
-			int pixelY = (vRegisters[yRegId] % Display::LOW_RES_SCREEN_HEIGHT) + index;
+		// DXY0 draws a 16x16 sprite, with two bytes per row
+		int spriteWidth = instruction.n == 0 ? 16 : 8;
+		int spriteHeight = instruction.n == 0 ? 16 : instruction.n;
+		int spriteSize = spriteHeight * spriteWidth / 8;
 
-			//if (pixelY >= Display::LOW_RES_SCREEN_HEIGHT) return;
+		bool isCollision = false;
+		uint16_t spriteAddress = iRegister;
 
-			uint8_t spriteByte = memory->GetByte(iRegister + index);
+		// Each selected plane is drawn with its own sprite, which follows the previous plane's sprite in memory
+		for (int plane = 0; plane < Display::PLANE_COUNT; plane++)
+		{
+			if ((display->GetPlaneMask() & (1 << plane)) == 0) continue;
 
-			for (int i = 0; i < 8; i++)
+			// Each row of the sprite is XORed onto the screen all at once.
+			// Rows that go past the bottom of the screen are clipped, unless the profile wraps them to the top.
+			for (int index = 0; index < spriteHeight; index++)
 			{
-				int pixelX = x + i;
-
-				//if (pixelX >= Display::LOW_RES_SCREEN_WIDTH) return;
-
-				// Note: Bits should be read from left to right since graphics on CHIP-8 are drawn
-				// from top-left to bottom-right. 
-
-				// This operation is done in order to isolate the bit that represents
-				// the current pixel.
-				// 0x80(hexadecimal) = 128(decimal) = 10000000(binary).
-				uint8_t spritePixel = spriteByte & (0x80 >> i);
+				uint16_t spriteRow = memory->GetByte(spriteAddress + index * spriteWidth / 8);
+				if (spriteWidth == 16) spriteRow = (spriteRow << 8) | memory->GetByte(spriteAddress + index * 2 + 1);
 
-				// Shift the isolated bit to the right-most position in the byte, so 
-				// that the byte can be treated as a 0 or 1.
-				spritePixel = spritePixel >> (7 - i);
-
-				uint8_t displayPixel = display->GetPixel(pixelX, pixelY);
-
-				// XOR the sprite's pixels with the existing pixels on the screen
-				uint8_t resultPixel = (spritePixel ^ displayPixel);
-
-				display->SetPixel(pixelX, pixelY, resultPixel);
-
-				// Set VF to 1 if a pixel is erased after the XOR operation, otherwise set VF to 0
-				if ((resultPixel == 0) && (displayPixel == 1)) vRegisters[VF_REG_INDEX] = 1;
+				if (Quirks::IS_CLIPPING)
+				{
+					if (y + index >= height) break;
+					if (display->DrawSpriteRow(plane, x, y + index, spriteRow, spriteWidth, false)) isCollision = true;
+				}
+				else
+				{
+					if (display->DrawSpriteRow(plane, x, (y + index) % height, spriteRow, spriteWidth, true)) isCollision = true;
+				}
 			}
+
+			spriteAddress += spriteSize;
 		}
+
+		// Set VF to 1 if a pixel is erased after the XOR operation, otherwise set VF to 0
+		vRegisters[VF_REG_INDEX] = isCollision ? 1 : 0;
 	}
 
 
-	void CPU::Execute_EX9E(uint16_t instruction)
+	void CPU::Execute_EX9E(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("EX9E");
-
-		uint8_t xRegId = GetX(instruction);
+		uint8_t xRegId = instruction.x;
 
 		// Check if key with value vRegisters[x] is pressed. If it's pressed, then skip next instruction.
-		if (keypad->IsKeyPressed(vRegisters[xRegId])) MoveToNextInstruction();
+		if (IsKeyPressed(vRegisters[xRegId])) SkipNextInstruction();
 	}
 
-	void CPU::Execute_EXA1(uint16_t instruction)
+	void CPU::Execute_EXA1(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("EXA1");
-
-		uint8_t xRegId = GetX(instruction);
+		uint8_t xRegId = instruction.x;
 
 		// Check if key with value vRegisters[x] is pressed. If it's NOT pressed, then skip next instruction.
-		if (!keypad->IsKeyPressed(vRegisters[xRegId])) MoveToNextInstruction();
+		if (!IsKeyPressed(vRegisters[xRegId])) SkipNextInstruction();
 	}
 
-	void CPU::Execute_FX07(uint16_t instruction)
+	void CPU::Execute_FX07(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("FX07");
-
-		uint8_t xRegId = GetX(instruction);
+		uint8_t xRegId = instruction.x;
 
 		vRegisters[xRegId] = timerRegisters[DELAY_TIMER_INDEX];
 	}
 
-	void CPU::Execute_FX0A(uint16_t instruction)
+	void CPU::Execute_F000(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("FX0A");
+		// The 16-bit address follows the instruction
+		iRegister = FetchInstruction();
+		MoveToNextInstruction();
+	}
 
-		uint8_t xRegId = GetX(instruction);
-		uint8_t key = 0;
+	void CPU::Execute_FN01(const DecodedInstruction& instruction)
+	{
+		display->SetPlaneMask(instruction.x);
+	}
 
-		if (keypad->GetKeyPressedThisFrame(&key))
-		{
-			vRegisters[xRegId] = key;
-		}
-		else
-		{
-			// Stay on the current instruction until a key is pressed
-			programCounter -= 2;
-		}
+	void CPU::Execute_F002(const DecodedInstruction& instruction)
+	{
+		for (int i = 0; i < Sound::PATTERN_SIZE; i++) audioPattern[i] = memory->GetByte(iRegister + i);
 	}
 
-	void CPU::Execute_FX15(uint16_t instruction)
+	void CPU::Execute_FX0A(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("FX15");
+		// The CPU stops executing until a key is pressed and released, which is when the original hardware continues. 
+		// Only keys released after this point count.
+		keypad->ClearReleasedKeys();
+		recordedReleasedKeyStates = 0;
+		keyWaitRegister = instruction.x;
+		isWaitingForKey = true;
+	}
 
-		uint8_t xRegId = GetX(instruction);
+	void CPU::Execute_FX15(const DecodedInstruction& instruction)
+	{
+		uint8_t xRegId = instruction.x;
 		timerRegisters[DELAY_TIMER_INDEX] = vRegisters[xRegId];
 
 		//std::cout << "Updated delay timer register: " << timerRegisters[DELAY_TIMER_INDEX] << std::endl;
 	}
 
-	void CPU::Execute_FX18(uint16_t instruction)
+	void CPU::Execute_FX18(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("FX18");
-
-		uint8_t xRegId = GetX(instruction);
+		uint8_t xRegId = instruction.x;
 		timerRegisters[SOUND_TIMER_INDEX] = vRegisters[xRegId];
 
 		//std::cout << "Updated sound timer register: " << timerRegisters[SOUND_TIMER_INDEX] << std::endl;
 	}
 
-	void CPU::Execute_FX1E(uint16_t instruction)
+	void CPU::Execute_FX1E(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("FX1E");
-
-		uint8_t xRegId = GetX(instruction);
+		uint8_t xRegId = instruction.x;
 
 		iRegister += vRegisters[xRegId];
 	}
 
-	void CPU::Execute_FX29(uint16_t instruction)
+	void CPU::Execute_FX29(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("FX29");
-
-		uint8_t xRegId = GetX(instruction);
+		uint8_t xRegId = instruction.x;
 
 		// Set iRegister to the location of the sprite for the digit that vRegisters[X] corresponds to
 		iRegister = vRegisters[xRegId] * Memory::FONT_SPRITE_SIZE;
 	}
 
-	void CPU::Execute_FX33(uint16_t instruction)
+	void CPU::Execute_FX30(const DecodedInstruction& instruction)
+	{
+		// Set iRegister to the location of the big sprite for the digit in the low half-byte of vRegisters[X]
+		iRegister = Memory::BIG_FONT_ADDRESS + (vRegisters[instruction.x] & 0x0F) * Memory::BIG_FONT_SPRITE_SIZE;
+	}
+
+	void CPU::Execute_FX3A(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("FX33");
+		audioPitch = vRegisters[instruction.x];
+	}
 
-		uint8_t xRegId = GetX(instruction);
+	void CPU::Execute_FX33(const DecodedInstruction& instruction)
+	{
+		uint8_t xRegId = instruction.x;
 
 		uint8_t decimalNum = vRegisters[xRegId];
 
@@ -611,80 +1537,45 @@ namespace SHG
 		memory->SetByte(iRegister + 2, onesValue);
 	}
 
-	void CPU::Execute_FX55(uint16_t instruction)
+	template<typename Quirks>
+	void CPU::Execute_FX55(const DecodedInstruction& instruction)
 	{
-		PrintInstructionExecution("FX55");
-
-		uint8_t x = GetX(instruction);
+		uint8_t x = instruction.x;
 
 		for (int i = 0; i <= x; i++) memory->SetByte(iRegister + i, vRegisters[i]);
-	}
-
-	void CPU::Execute_FX65(uint16_t instruction)
-	{
-		PrintInstructionExecution("FX65");
-
-		uint8_t x = GetX(instruction);
 
-		for (int i = 0; i <= x; i++) vRegisters[i] = memory->GetByte(iRegister + i);
+		if (Quirks::IS_INCREMENTING_I) iRegister += x + 1;
 	}
 
-	void CPU::MoveToNextInstruction()
+	template<typename Quirks>
+	void CPU::Execute_FX65(const DecodedInstruction& instruction)
 	{
-		programCounter += 2;
-	}
-
-	void CPU::PrintInstructionExecution(std::string instruction)
-	{
-		//std::cout << "[Executing instruction: " << instruction << "]" << std::endl;
-	}
+		uint8_t x = instruction.x;
 
-	void CPU::PrintStackValues()
-	{
-		std::cout << "Stack: [";
-
-		for (int i = 0; i < 16; i++)
-		{
-			std::cout << (int)stack[i];
-			if (i < 15) std::cout << ", ";
-		}
-
-		std::cout << "]" << std::endl;
-	}
+		for (int i = 0; i <= x; i++) vRegisters[i] = memory->GetByte(iRegister + i);
 
-	void CPU::PrintStackPointerValue()
-	{
-		std::cout << "Stack pointer: " << (int)stackPointer << std::endl;
+		if (Quirks::IS_INCREMENTING_I) iRegister += x + 1;
 	}
 
-	void CPU::PrintProgramCounterValue()
+	void CPU::Execute_FX75(const DecodedInstruction& instruction)
 	{
-		std::cout << "Program counter: " << (int)programCounter << std::endl;
+		std::copy(vRegisters, vRegisters + instruction.x + 1, flagRegisters);
 	}
 
-	void CPU::PrintRegisterValues()
+	void CPU::Execute_FX85(const DecodedInstruction& instruction)
 	{
-		std::cout << "I Register: " << (int)iRegister << std::endl;
-		std::cout << "Sound register: " << (int)timerRegisters[SOUND_TIMER_INDEX] << std::endl;
-		std::cout << "V Registers: [";
-
-		for (int i = 0; i < 16; i++)
-		{
-			std::cout << (int)vRegisters[i];
-			if (i < 15) std::cout << ", ";
-		}
-
-		std::cout << "]" << std::endl;
+		std::copy(flagRegisters, flagRegisters + instruction.x + 1, vRegisters);
 	}
 
-	void CPU::PrintDelayTimerValue()
+	void CPU::MoveToNextInstruction()
 	{
-		std::cout << "Delay register: " << (int)timerRegisters[DELAY_TIMER_INDEX] << std::endl;
+		programCounter += 2;
 	}
 
-	void CPU::PrintSoundTimerValue()
+	void CPU::SkipNextInstruction()
 	{
-		std::cout << "Delay register: " << (int)timerRegisters[SOUND_TIMER_INDEX] << std::endl;
+		if (FetchInstruction() == 0xF000) MoveToNextInstruction();
+		MoveToNextInstruction();
 	}
 
 	uint8_t CPU::GetX(uint16_t instruction)
@@ -1,62 +1,393 @@
-#include <iostream>
+#include <algorithm>
 #include "Display.hpp"
+#include "Bits.hpp"
 
 namespace SHG
 {
-	Display::Display(int width, int height)
+	// Bit of a word that holds the left-most of its 64 pixels
+	static const uint64_t LEFT_MOST_PIXEL = 1ull << 63;
+
+	static const uint64_t FNV_OFFSET_BASIS = 0xCBF29CE484222325;
+	static const uint64_t FNV_PRIME = 0x100000001B3;
+
+	void Display::Clear()
 	{
-		if (SDL_Init(SDL_INIT_VIDEO) < 0)
+		int wordCount = GetHeight() * wordsPerRow;
+
+		for (int plane = 0; plane < PLANE_COUNT; plane++)
 		{
-			std::cout << "SDL failed to initialize! SDL Error: " << SDL_GetError() << std::endl;
-			return;
+			if ((planeMask & (1 << plane)) == 0) continue;
+
+			for (int index = 0; index < wordCount; index++)
+			{
+				if (planes[plane][index] != 0) dirtyRowMask |= 1ull << (index / wordsPerRow);
+			}
+
+			std::fill(planes[plane], planes[plane] + wordCount, 0);
 		}
+	}
 
-		screenWidth = width;
-		screenHeight = height;
+	void Display::SetHighRes(bool isHighRes)
+	{
+		// The layout of the rows changes with the resolution, so the dirty rows can't describe the change
+		if (isHighRes != this->isHighRes) isResolutionChanged = true;
+		else dirtyRowMask |= GetAllRowsMask();
 
-		// Since a screen size significantly larger than CHIP-8's native screen size is used, 
-		// the pixels have to be 'scaled' up in order to be rendered correctly.
-		pixelWidth = screenWidth / LOW_RES_SCREEN_WIDTH;
-		pixelHeight = screenHeight / LOW_RES_SCREEN_HEIGHT;
+		this->isHighRes = isHighRes;
+		wordsPerRow = isHighRes ? MAX_WORDS_PER_ROW : 1;
 
-		window = SDL_CreateWindow("CHIP-8 Emulator", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, screenWidth, screenHeight, SDL_WINDOW_SHOWN);
-		renderer = SDL_CreateRenderer(window, 0, 0);
-		surface = SDL_GetWindowSurface(window);
+		for (int plane = 0; plane < PLANE_COUNT; plane++) std::fill(planes[plane], planes[plane] + MAX_PLANE_WORD_COUNT, 0);
 	}
 
-	void Display::Clear()
+	bool Display::IsHighRes()
 	{
-		std::fill(lowResScreenPixels, lowResScreenPixels + LOW_RES_PIXEL_COUNT, 0);
+		return isHighRes;
+	}
 
-		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-		SDL_RenderClear(renderer);
-		SDL_RenderPresent(renderer);
+	int Display::GetWidth()
+	{
+		return isHighRes ? HIGH_RES_SCREEN_WIDTH : LOW_RES_SCREEN_WIDTH;
 	}
 
-	void Display::SetPixel(int x, int y, uint8_t bit)
+	int Display::GetHeight()
 	{
-		if (x >= LOW_RES_SCREEN_WIDTH || y >= LOW_RES_SCREEN_HEIGHT) return;
+		return isHighRes ? HIGH_RES_SCREEN_HEIGHT : LOW_RES_SCREEN_HEIGHT;
+	}
 
-		lowResScreenPixels[x + (y * LOW_RES_SCREEN_WIDTH)] = bit & 1;
+	void Display::SetPlaneMask(uint8_t planeMask)
+	{
+		this->planeMask = planeMask & ((1 << PLANE_COUNT) - 1);
+	}
 
-		uint8_t color = (bit & 1) * 255;
+	uint8_t Display::GetPlaneMask()
+	{
+		return planeMask;
+	}
+
+	void Display::SetPixel(int x, int y, uint8_t color)
+	{
+		if (x >= GetWidth() || y >= GetHeight()) return;
 
-		SDL_Rect rect;
-		rect.x = x * pixelWidth;
-		rect.y = y * pixelHeight;
-		rect.w = pixelWidth;
-		rect.h = pixelHeight;
+		int index = y * wordsPerRow + x / 64;
+		uint64_t mask = LEFT_MOST_PIXEL >> (x % 64);
 
-		SDL_SetRenderDrawColor(renderer, color, color, color, 255);
-		SDL_RenderFillRect(renderer, &rect);
-		SDL_RenderPresent(renderer);
-		
+		for (int plane = 0; plane < PLANE_COUNT; plane++)
+		{
+			if (color & (1 << plane)) planes[plane][index] |= mask;
+			else planes[plane][index] &= ~mask;
+		}
+
+		dirtyRowMask |= 1ull << y;
 	}
 
 	uint8_t Display::GetPixel(int x, int y)
 	{
-		if (x >= LOW_RES_SCREEN_WIDTH || y >= LOW_RES_SCREEN_HEIGHT) return 0;
+		if (x >= GetWidth() || y >= GetHeight()) return 0;
+
+		int index = y * wordsPerRow + x / 64;
+		int shift = 63 - x % 64;
+		uint8_t color = 0;
+
+		for (int plane = 0; plane < PLANE_COUNT; plane++) color |= ((planes[plane][index] >> shift) & 1) << plane;
+
+		return color;
+	}
+
+	bool Display::DrawSpriteRow(int plane, int x, int y, uint16_t spriteRow, int spriteWidth, bool isWrapping)
+	{
+		if (x >= GetWidth() || y >= GetHeight()) return false;
+
+		// Move the sprite row to the top of a 64-bit value, then shift it into place within its word. 
+		// Pixels that are shifted out go to the next word, or past the right edge.
+		uint64_t spriteBits = (uint64_t)spriteRow << (64 - spriteWidth);
+		int word = x / 64;
+		int shift = x % 64;
+
+		uint64_t rowBits[MAX_WORDS_PER_ROW]{};
+		rowBits[word] = spriteBits >> shift;
+
+		if (shift != 0)
+		{
+			uint64_t spilledBits = spriteBits << (64 - shift);
+
+			if (word + 1 < wordsPerRow) rowBits[word + 1] = spilledBits;
+			else if (isWrapping) rowBits[0] |= spilledBits;
+		}
+
+		uint64_t* row = &planes[plane][y * wordsPerRow];
+		bool isCollision = false;
+
+		for (int index = 0; index < wordsPerRow; index++)
+		{
+			if ((row[index] & rowBits[index]) != 0) isCollision = true;
+			row[index] ^= rowBits[index];
+		}
+
+		if (spriteRow != 0) dirtyRowMask |= 1ull << y;
+
+		return isCollision;
+	}
+
+	bool Display::DrawSpriteRow(int x, int y, uint8_t spriteRow)
+	{
+		return DrawSpriteRow(0, x, y, spriteRow, 8, false);
+	}
+
+	void Display::ScrollDown(int pixelCount)
+	{
+		int height = GetHeight();
+		pixelCount = std::min(pixelCount, height);
+
+		for (int plane = 0; plane < PLANE_COUNT; plane++)
+		{
+			if ((planeMask & (1 << plane)) == 0) continue;
+
+			uint64_t* words = planes[plane];
+			std::copy_backward(words, words + (height - pixelCount) * wordsPerRow, words + height * wordsPerRow);
+			std::fill(words, words + pixelCount * wordsPerRow, 0);
+		}
+
+		dirtyRowMask |= GetAllRowsMask();
+	}
+
+	void Display::ScrollUp(int pixelCount)
+	{
+		int height = GetHeight();
+		pixelCount = std::min(pixelCount, height);
+
+		for (int plane = 0; plane < PLANE_COUNT; plane++)
+		{
+			if ((planeMask & (1 << plane)) == 0) continue;
+
+			uint64_t* words = planes[plane];
+			std::copy(words + pixelCount * wordsPerRow, words + height * wordsPerRow, words);
+			std::fill(words + (height - pixelCount) * wordsPerRow, words + height * wordsPerRow, 0);
+		}
+
+		dirtyRowMask |= GetAllRowsMask();
+	}
+
+	void Display::ScrollLeft(int pixelCount)
+	{
+		if (pixelCount <= 0 || pixelCount >= 64) return;
+
+		int height = GetHeight();
+
+		for (int plane = 0; plane < PLANE_COUNT; plane++)
+		{
+			if ((planeMask & (1 << plane)) == 0) continue;
+
+			for (int y = 0; y < height; y++)
+			{
+				uint64_t* row = &planes[plane][y * wordsPerRow];
+
+				// Pixels that leave a word move into the end of the word before it
+				for (int index = 0; index < wordsPerRow - 1; index++) row[index] = (row[index] << pixelCount) | (row[index + 1] >> (64 - pixelCount));
+				row[wordsPerRow - 1] <<= pixelCount;
+			}
+		}
+
+		dirtyRowMask |= GetAllRowsMask();
+	}
+
+	void Display::ScrollRight(int pixelCount)
+	{
+		if (pixelCount <= 0 || pixelCount >= 64) return;
+
+		int height = GetHeight();
+
+		for (int plane = 0; plane < PLANE_COUNT; plane++)
+		{
+			if ((planeMask & (1 << plane)) == 0) continue;
+
+			for (int y = 0; y < height; y++)
+			{
+				uint64_t* row = &planes[plane][y * wordsPerRow];
+
+				// Pixels that leave a word move into the start of the word after it
+				for (int index = wordsPerRow - 1; index > 0; index--) row[index] = (row[index] >> pixelCount) | (row[index - 1] << (64 - pixelCount));
+				row[0] >>= pixelCount;
+			}
+		}
+
+		dirtyRowMask |= GetAllRowsMask();
+	}
+
+	void Display::GetScreen(Screen* screen)
+	{
+		screen->isHighRes = isHighRes;
+		screen->planeMask = planeMask;
+
+		for (int plane = 0; plane < PLANE_COUNT; plane++) std::copy(planes[plane], planes[plane] + MAX_PLANE_WORD_COUNT, screen->planes[plane]);
+	}
+
+	void Display::SetScreen(const Screen& screen)
+	{
+		if ((screen.isHighRes != 0) != isHighRes)
+		{
+			isHighRes = screen.isHighRes != 0;
+			wordsPerRow = isHighRes ? MAX_WORDS_PER_ROW : 1;
+			isResolutionChanged = true;
+		}
+
+		SetPlaneMask(screen.planeMask);
+
+		for (int plane = 0; plane < PLANE_COUNT; plane++)
+		{
+			for (int index = 0; index < MAX_PLANE_WORD_COUNT; index++)
+			{
+				if (planes[plane][index] == screen.planes[plane][index]) continue;
+
+				planes[plane][index] = screen.planes[plane][index];
+				dirtyRowMask |= 1ull << ((index / wordsPerRow) & 63);
+			}
+		}
+	}
+
+	bool Display::IsScreenEqual(const Display& other)
+	{
+		// Words outside of the current resolution are always 0, so whole planes can be compared
+		if (isHighRes != other.isHighRes || planeMask != other.planeMask) return false;
+
+		for (int plane = 0; plane < PLANE_COUNT; plane++)
+		{
+			if (!std::equal(planes[plane], planes[plane] + MAX_PLANE_WORD_COUNT, other.planes[plane])) return false;
+		}
+
+		return true;
+	}
+
+	uint64_t Display::GetHash()
+	{
+		uint64_t hash = FNV_OFFSET_BASIS;
+		int wordCount = GetHeight() * wordsPerRow;
+
+		// Rows are hashed one byte at a time, starting with the left-most pixels, so the hash doesn't depend on the host's byte order. 
+		// The second plane is only hashed if anything is drawn on it, so a single-plane screen has the same hash in any program.
+		for (int plane = 0; plane < PLANE_COUNT; plane++)
+		{
+			if (plane > 0 && std::all_of(planes[plane], planes[plane] + wordCount, [](uint64_t word) { return word == 0; })) continue;
+
+			for (int index = 0; index < wordCount; index++)
+			{
+				for (int shift = 56; shift >= 0; shift -= 8)
+				{
+					hash ^= (planes[plane][index] >> shift) & 0xFF;
+					hash *= FNV_PRIME;
+				}
+			}
+		}
+
+		return hash;
+	}
+
+	bool Display::HasChanged()
+	{
+		if (isResolutionChanged) return true;
 
-		return lowResScreenPixels[x + (y * LOW_RES_SCREEN_WIDTH)];
+		for (uint64_t rows = dirtyRowMask; rows != 0; rows &= rows - 1)
+		{
+			int y = CountTrailingZeros(rows);
+
+			for (int plane = 0; plane < PLANE_COUNT; plane++)
+			{
+				for (int index = y * wordsPerRow; index < (y + 1) * wordsPerRow; index++)
+				{
+					if (planes[plane][index] != cleanPlanes[plane][index]) return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	const std::vector<Display::DirtyRect>& Display::GetDirtyRects()
+	{
+		dirtyRects.clear();
+
+		if (isResolutionChanged)
+		{
+			dirtyRects.push_back({ 0, 0, GetWidth(), GetHeight() });
+			return dirtyRects;
+		}
+
+		// Set while a rect is being extended over consecutive changed rows
+		bool isRectOpen = false;
+		int rectLeft = 0;
+		int rectRight = 0;
+
+		for (int y = 0; y < GetHeight(); y++)
+		{
+			// The changed pixels of the row in all planes, and the left-most and right-most of them
+			int left = -1;
+			int right = -1;
+
+			if ((dirtyRowMask & (1ull << y)) != 0)
+			{
+				for (int word = 0; word < wordsPerRow; word++)
+				{
+					uint64_t changedPixels = 0;
+					for (int plane = 0; plane < PLANE_COUNT; plane++) changedPixels |= planes[plane][y * wordsPerRow + word] ^ cleanPlanes[plane][y * wordsPerRow + word];
+
+					if (changedPixels == 0) continue;
+
+					if (left < 0) left = word * 64 + CountLeadingZeros(changedPixels);
+					right = word * 64 + 63 - CountTrailingZeros(changedPixels);
+				}
+			}
+
+			if (left < 0)
+			{
+				isRectOpen = false;
+				continue;
+			}
+
+			if (!isRectOpen)
+			{
+				dirtyRects.push_back({ left, y, 0, 0 });
+				rectLeft = left;
+				rectRight = right;
+				isRectOpen = true;
+			}
+
+			rectLeft = std::min(rectLeft, left);
+			rectRight = std::max(rectRight, right);
+
+			DirtyRect& rect = dirtyRects.back();
+			rect.x = rectLeft;
+			rect.width = rectRight - rectLeft + 1;
+			rect.height = y - rect.y + 1;
+		}
+
+		return dirtyRects;
+	}
+
+	void Display::ClearDirtyRegions()
+	{
+		if (isResolutionChanged)
+		{
+			for (int plane = 0; plane < PLANE_COUNT; plane++) std::copy(planes[plane], planes[plane] + MAX_PLANE_WORD_COUNT, cleanPlanes[plane]);
+
+			isResolutionChanged = false;
+			dirtyRowMask = 0;
+			return;
+		}
+
+		for (uint64_t rows = dirtyRowMask; rows != 0; rows &= rows - 1)
+		{
+			int y = CountTrailingZeros(rows);
+
+			for (int plane = 0; plane < PLANE_COUNT; plane++)
+			{
+				std::copy(planes[plane] + y * wordsPerRow, planes[plane] + (y + 1) * wordsPerRow, cleanPlanes[plane] + y * wordsPerRow);
+			}
+		}
+
+		dirtyRowMask = 0;
+	}
+
+	uint64_t Display::GetAllRowsMask()
+	{
+		return GetHeight() == 64 ? ~0ull : (1ull << GetHeight()) - 1;
 	}
 }
\ No newline at end of file
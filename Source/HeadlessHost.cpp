@@ -0,0 +1,26 @@
+#include "HeadlessHost.hpp"
+
+namespace SHG
+{
+	bool HeadlessHost::ProcessEvents(Keypad* keypad)
+	{
+		// There's no input device, so there's nothing to process
+		return true;
+	}
+
+	void HeadlessHost::Present(Display* display)
+	{
+		presentedFrameCount++;
+		if (display->HasChanged()) changedFrameCount++;
+	}
+
+	int HeadlessHost::GetPresentedFrameCount()
+	{
+		return presentedFrameCount;
+	}
+
+	int HeadlessHost::GetChangedFrameCount()
+	{
+		return changedFrameCount;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include "InputRecording.hpp"
+
+namespace SHG
+{
+	static const std::string FORMAT_NAME = "chip8-input";
+
+	void InputRecording::Clear()
+	{
+		events.clear();
+	}
+
+	void InputRecording::AddEvent(const Event& event)
+	{
+		events.push_back(event);
+	}
+
+	const std::vector<InputRecording::Event>& InputRecording::GetEvents()
+	{
+		return events;
+	}
+
+	uint64_t InputRecording::GetSeed()
+	{
+		return seed;
+	}
+
+	void InputRecording::SetSeed(uint64_t seed)
+	{
+		this->seed = seed;
+	}
+
+	int InputRecording::GetInstructionsPerSecond()
+	{
+		return instructionsPerSecond;
+	}
+
+	void InputRecording::SetInstructionsPerSecond(int instructionsPerSecond)
+	{
+		this->instructionsPerSecond = instructionsPerSecond;
+	}
+
+	int InputRecording::GetFrameCount()
+	{
+		return frameCount;
+	}
+
+	void InputRecording::SetFrameCount(int frameCount)
+	{
+		this->frameCount = frameCount;
+	}
+
+	QuirkProfile InputRecording::GetQuirkProfile()
+	{
+		return quirkProfile;
+	}
+
+	void InputRecording::SetQuirkProfile(QuirkProfile quirkProfile)
+	{
+		this->quirkProfile = quirkProfile;
+	}
+
+	bool InputRecording::SaveToFile(std::string filePath)
+	{
+		std::ofstream file(filePath);
+
+		file << FORMAT_NAME << " " << FORMAT_VERSION << std::endl;
+		file << "seed " << seed << std::endl;
+		file << "instructions-per-second " << instructionsPerSecond << std::endl;
+		file << "frames " << frameCount << std::endl;
+		file << "quirks " << GetQuirkProfileName(quirkProfile) << std::endl;
+		file << "# frame instruction pressed-keys released-keys" << std::endl;
+
+		for (const Event& event : events)
+		{
+			file << event.frame << " " << event.instruction << " " << std::hex << std::setfill('0') 
+				<< std::setw(4) << event.keyStates << " " << std::setw(4) << event.releasedKeyStates << std::dec << std::endl;
+		}
+
+		if (!file)
+		{
+			std::cout << "Could not write input recording: " << filePath << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool InputRecording::LoadFromFile(std::string filePath)
+	{
+		std::ifstream file(filePath);
+
+		if (!file.is_open())
+		{
+			std::cout << "Invalid input recording file provided." << std::endl;
+			return false;
+		}
+
+		std::string name;
+		int version = 0;
+		file >> name >> version;
+
+		if (name != FORMAT_NAME || version != FORMAT_VERSION)
+		{
+			std::cout << "The input recording is invalid or was made by a different version of the emulator." << std::endl;
+			return false;
+		}
+
+		events.clear();
+		quirkProfile = QuirkProfile::Default;
+
+		std::string line;
+		int lineNumber = 0;
+
+		while (std::getline(file, line))
+		{
+			lineNumber++;
+
+			std::istringstream fields(line);
+			std::string first;
+
+			if (!(fields >> first) || first[0] == '#') continue;
+
+			bool isValid = true;
+
+			if (first == "seed") isValid = (bool)(fields >> seed);
+			else if (first == "instructions-per-second") isValid = (bool)(fields >> instructionsPerSecond);
+			else if (first == "frames") isValid = (bool)(fields >> frameCount);
+			else if (first == "quirks")
+			{
+				std::string name;
+				isValid = fields >> name && ParseQuirkProfile(name, &quirkProfile);
+			}
+			else
+			{
+				Event event;
+				uint32_t keyStates = 0;
+				uint32_t releasedKeyStates = 0;
+
+				try
+				{
+					event.frame = std::stoull(first);
+				}
+				catch (std::exception const&)
+				{
+					isValid = false;
+				}
+
+				isValid = isValid && (fields >> event.instruction >> std::hex >> keyStates >> releasedKeyStates);
+				event.keyStates = (uint16_t)keyStates;
+				event.releasedKeyStates = (uint16_t)releasedKeyStates;
+
+				if (isValid) events.push_back(event);
+			}
+
+			if (!isValid)
+			{
+				std::cout << "Invalid line " << lineNumber << " in input recording: " << line << std::endl;
+				return false;
+			}
+		}
+
+		// Events that were written by hand may be out of order
+		std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b)
+		{
+			return a.frame < b.frame || (a.frame == b.frame && a.instruction < b.instruction);
+		});
+
+		return true;
+	}
+}
\ No newline at end of file
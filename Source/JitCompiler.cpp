@@ -0,0 +1,842 @@
+#include <vector>
+#include "JitCompiler.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SHG_JIT_X64 1
+#endif
+
+#ifdef SHG_JIT_X64
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+namespace SHG
+{
+	// Size of the buffer that holds all compiled code. When it's full, all compiled code is discarded.
+	static const size_t CODE_BUFFER_SIZE = 4 * 1024 * 1024;
+
+	// Compiling stops when fewer than this many bytes are left in the code buffer,
+	// which is more than the largest possible block needs.
+	static const size_t MAX_BLOCK_CODE_SIZE = 16 * 1024;
+
+#ifdef SHG_JIT_X64
+	enum X64Register
+	{
+		RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+		R8, R9, R10, R11, R12, R13, R14, R15
+	};
+
+	// Opcodes of the 'op r/m32, r32' forms, and the matching /digit extensions of the 'op r/m32, imm32' forms
+	enum AluOperation { ALU_ADD = 0x01, ALU_OR = 0x09, ALU_AND = 0x21, ALU_SUB = 0x29, ALU_XOR = 0x31, ALU_CMP = 0x39 };
+	enum AluImmediateOperation { ALU_IMM_ADD = 0, ALU_IMM_AND = 4, ALU_IMM_CMP = 7 };
+	enum ShiftOperation { SHIFT_LEFT = 4, SHIFT_RIGHT = 5 };
+	enum ConditionCode { CONDITION_EQUAL = 0x4, CONDITION_NOT_EQUAL = 0x5, CONDITION_ABOVE = 0x7 };
+
+#ifdef _WIN32
+	static const X64Register FIRST_ARGUMENT = RCX;
+	static const X64Register SECOND_ARGUMENT = RDX;
+#else
+	static const X64Register FIRST_ARGUMENT = RDI;
+	static const X64Register SECOND_ARGUMENT = RSI;
+#endif
+
+	// Holds the JitContext pointer for the whole block
+	static const X64Register CONTEXT_REGISTER = R15;
+
+	// Host registers that CHIP-8 registers can be assigned to. RAX and RDX are used as scratch registers.
+	static const X64Register ALLOCATABLE_REGISTERS[] = { RSI, RDI, R8, R9, R10, R11, RBX, RBP, R12, R13, R14, RCX };
+	static const int ALLOCATABLE_REGISTER_COUNT = sizeof(ALLOCATABLE_REGISTERS) / sizeof(ALLOCATABLE_REGISTERS[0]);
+
+	// Callee-saved registers (on either calling convention) that are pushed in the prologue
+	static const X64Register SAVED_REGISTERS[] = { RBX, RBP, RSI, RDI, R12, R13, R14, R15 };
+
+	// Keeps the stack 16-byte aligned for fallback calls and leaves room for the Windows shadow space
+	static const uint8_t STACK_RESERVE = 40;
+
+	// FX65 loads into more registers as X gets larger, so it's only translated for small values of X
+	static const int MAX_TRANSLATED_LOAD_REGISTER = 7;
+
+	static const int I_REGISTER_SLOT = 16;
+	static const int NO_REGISTER = -1;
+
+	// Writes x86-64 machine code into a buffer
+	class X64Emitter
+	{
+	public:
+		X64Emitter(uint8_t* code) : code(code) {}
+
+		size_t GetSize() { return size; }
+
+		void MovRegImm32(int reg, uint32_t value)
+		{
+			Rex(false, 0, reg, false);
+			Byte(0xB8 + (reg & 7));
+			Dword(value);
+		}
+
+		void MovRegImm64(int reg, uint64_t value)
+		{
+			Rex(true, 0, reg, false);
+			Byte(0xB8 + (reg & 7));
+			Qword(value);
+		}
+
+		void MovRegReg32(int destination, int source)
+		{
+			Alu(0x89, destination, source);
+		}
+
+		void MovRegReg64(int destination, int source)
+		{
+			Rex(true, source, destination, false);
+			Byte(0x89);
+			ModRmRegister(source, destination);
+		}
+
+		void Alu(int opcode, int destination, int source)
+		{
+			Rex(false, source, destination, false);
+			Byte(opcode);
+			ModRmRegister(source, destination);
+		}
+
+		void AluImm32(int extension, int destination, uint32_t value)
+		{
+			Rex(false, 0, destination, false);
+			Byte(0x81);
+			ModRmRegister(extension, destination);
+			Dword(value);
+		}
+
+		void Shift(int extension, int reg, uint8_t count)
+		{
+			Rex(false, 0, reg, false);
+			Byte(0xC1);
+			ModRmRegister(extension, reg);
+			Byte(count);
+		}
+
+		void Cmov(int condition, int destination, int source)
+		{
+			Rex(false, destination, source, false);
+			Byte(0x0F);
+			Byte(0x40 + condition);
+			ModRmRegister(destination, source);
+		}
+
+		void Setcc(int condition, int reg)
+		{
+			Rex(false, 0, reg, true);
+			Byte(0x0F);
+			Byte(0x90 + condition);
+			ModRmRegister(0, reg);
+		}
+
+		void ImulImm8(int destination, int source, uint8_t value)
+		{
+			Rex(false, destination, source, false);
+			Byte(0x6B);
+			ModRmRegister(destination, source);
+			Byte(value);
+		}
+
+		void Lea32(int destination, int base, int32_t displacement)
+		{
+			Rex(false, destination, base, false);
+			Byte(0x8D);
+			ModRmMemory(destination, base, displacement);
+		}
+
+		void MovzxRegMem8(int destination, int base, int32_t displacement)
+		{
+			Rex(false, destination, base, false);
+			Byte(0x0F);
+			Byte(0xB6);
+			ModRmMemory(destination, base, displacement);
+		}
+
+		void MovzxRegMem16(int destination, int base, int32_t displacement)
+		{
+			Rex(false, destination, base, false);
+			Byte(0x0F);
+			Byte(0xB7);
+			ModRmMemory(destination, base, displacement);
+		}
+
+		// movzx destination, byte [base + index]. The base can't be RBP or R13.
+		void MovzxRegMemIndexed8(int destination, int base, int index)
+		{
+			uint8_t rex = 0x40 | ((destination >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+			if (rex != 0x40) Byte(rex);
+
+			Byte(0x0F);
+			Byte(0xB6);
+			Byte(0x04 | ((destination & 7) << 3));
+			Byte(((index & 7) << 3) | (base & 7));
+		}
+
+		void MovMem8Reg(int base, int32_t displacement, int source)
+		{
+			// The REX prefix is always needed so that SIL/DIL/BPL can be addressed
+			Rex(false, source, base, true);
+			Byte(0x88);
+			ModRmMemory(source, base, displacement);
+		}
+
+		void MovMem16Reg(int base, int32_t displacement, int source)
+		{
+			Byte(0x66);
+			Rex(false, source, base, false);
+			Byte(0x89);
+			ModRmMemory(source, base, displacement);
+		}
+
+		void MovMem16Imm(int base, int32_t displacement, uint16_t value)
+		{
+			Byte(0x66);
+			Rex(false, 0, base, false);
+			Byte(0xC7);
+			ModRmMemory(0, base, displacement);
+			Byte(value & 0xFF);
+			Byte(value >> 8);
+		}
+
+		void MovReg64Mem(int destination, int base, int32_t displacement)
+		{
+			Rex(true, destination, base, false);
+			Byte(0x8B);
+			ModRmMemory(destination, base, displacement);
+		}
+
+		void Push(int reg)
+		{
+			if (reg >= R8) Byte(0x41);
+			Byte(0x50 + (reg & 7));
+		}
+
+		void Pop(int reg)
+		{
+			if (reg >= R8) Byte(0x41);
+			Byte(0x58 + (reg & 7));
+		}
+
+		void SubRsp(uint8_t value)
+		{
+			Byte(0x48);
+			Byte(0x83);
+			Byte(0xEC);
+			Byte(value);
+		}
+
+		void AddRsp(uint8_t value)
+		{
+			Byte(0x48);
+			Byte(0x83);
+			Byte(0xC4);
+			Byte(value);
+		}
+
+		void CallReg(int reg)
+		{
+			Rex(false, 0, reg, false);
+			Byte(0xFF);
+			ModRmRegister(2, reg);
+		}
+
+		void Ret()
+		{
+			Byte(0xC3);
+		}
+
+	private:
+		uint8_t* code;
+		size_t size{};
+
+		void Byte(uint8_t value)
+		{
+			code[size++] = value;
+		}
+
+		void Dword(uint32_t value)
+		{
+			for (int i = 0; i < 4; i++) Byte((value >> (i * 8)) & 0xFF);
+		}
+
+		void Qword(uint64_t value)
+		{
+			for (int i = 0; i < 8; i++) Byte((value >> (i * 8)) & 0xFF);
+		}
+
+		void Rex(bool is64Bit, int reg, int rm, bool isRequired)
+		{
+			uint8_t rex = 0x40 | (is64Bit ? 0x08 : 0) | ((reg >> 3) << 2) | (rm >> 3);
+			if (rex != 0x40 || isRequired) Byte(rex);
+		}
+
+		void ModRmRegister(int reg, int rm)
+		{
+			Byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+		}
+
+		// [base + disp32]
+		void ModRmMemory(int reg, int base, int32_t displacement)
+		{
+			Byte(0x80 | ((reg & 7) << 3) | (base & 7));
+
+			// RSP and R12 can only be used as a base through a SIB byte
+			if ((base & 7) == RSP) Byte(0x24);
+
+			Dword((uint32_t)displacement);
+		}
+	};
+
+	// Translates one block, keeping track of which host register holds each CHIP-8 register
+	class BlockTranslator
+	{
+	public:
+		BlockTranslator(uint8_t* code, JitCompiler::FallbackFunction fallback, const QuirkSettings& quirks) : emitter(code), fallback(fallback), quirks(quirks)
+		{
+			for (int i = 0; i <= I_REGISTER_SLOT; i++)
+			{
+				hostRegisters[i] = NO_REGISTER;
+				isDirty[i] = false;
+			}
+		}
+
+		size_t GetSize() { return emitter.GetSize(); }
+
+		// Assigns host registers to every CHIP-8 register used by the first instructions of the block.
+		// Returns how many instructions can be compiled before running out of host registers.
+		int AllocateRegisters(const CPU::DecodedInstruction* instructions, int count)
+		{
+			int allocatedCount = 0;
+
+			for (int i = 0; i < count; i++)
+			{
+				bool isUsed[I_REGISTER_SLOT + 1]{};
+				GetUsedRegisters(instructions[i], isUsed);
+
+				int newCount = allocatedCount;
+				for (int slot = 0; slot <= I_REGISTER_SLOT; slot++)
+				{
+					if (isUsed[slot] && hostRegisters[slot] == NO_REGISTER) newCount++;
+				}
+
+				if (newCount > ALLOCATABLE_REGISTER_COUNT) return i;
+
+				for (int slot = 0; slot <= I_REGISTER_SLOT; slot++)
+				{
+					if (isUsed[slot] && hostRegisters[slot] == NO_REGISTER) hostRegisters[slot] = ALLOCATABLE_REGISTERS[allocatedCount++];
+				}
+			}
+
+			return count;
+		}
+
+		void EmitPrologue()
+		{
+			for (X64Register reg : SAVED_REGISTERS) emitter.Push(reg);
+
+			emitter.SubRsp(STACK_RESERVE);
+			emitter.MovRegReg64(CONTEXT_REGISTER, FIRST_ARGUMENT);
+
+			LoadRegisters();
+		}
+
+		// Returns true if the instruction ended the block
+		bool EmitInstruction(uint16_t address, const CPU::DecodedInstruction& instruction)
+		{
+			uint16_t nextAddress = address + 2;
+
+			switch (instruction.opcode & 0xF000)
+			{
+			case 0x1000:
+				FlushRegisters();
+				StoreProgramCounter(instruction.nnn);
+				return true;
+			case 0x3000:
+			case 0x4000:
+				FlushRegisters();
+				EmitSkipAddresses(nextAddress);
+				emitter.AluImm32(ALU_IMM_CMP, V(instruction.x), instruction.kk);
+				EmitSkip((instruction.opcode & 0xF000) == 0x3000 ? CONDITION_EQUAL : CONDITION_NOT_EQUAL);
+				return true;
+			case 0x5000:
+			case 0x9000:
+				// XO-CHIP's 5XY2 and 5XY3 are executed by the interpreter
+				if ((instruction.opcode & 0xF00F) == 0x5002 || (instruction.opcode & 0xF00F) == 0x5003) break;
+
+				FlushRegisters();
+				EmitSkipAddresses(nextAddress);
+				emitter.Alu(ALU_CMP, V(instruction.x), V(instruction.y));
+				EmitSkip((instruction.opcode & 0xF000) == 0x5000 ? CONDITION_EQUAL : CONDITION_NOT_EQUAL);
+				return true;
+			case 0x6000:
+				emitter.MovRegImm32(V(instruction.x), instruction.kk);
+				MarkDirty(instruction.x);
+				return false;
+			case 0x7000:
+				emitter.AluImm32(ALU_IMM_ADD, V(instruction.x), instruction.kk);
+				emitter.AluImm32(ALU_IMM_AND, V(instruction.x), 0xFF);
+				MarkDirty(instruction.x);
+				return false;
+			case 0x8000:
+				if (IsTranslatedArithmetic(instruction.opcode))
+				{
+					EmitArithmetic(instruction);
+					return false;
+				}
+				break;
+			case 0xA000:
+				emitter.MovRegImm32(V(I_REGISTER_SLOT), instruction.nnn);
+				MarkDirty(I_REGISTER_SLOT);
+				return false;
+			case 0xB000:
+				FlushRegisters();
+				emitter.MovRegReg32(RAX, V(quirks.isJumpingWithVx ? instruction.x : 0));
+				emitter.AluImm32(ALU_IMM_ADD, RAX, instruction.nnn);
+				emitter.MovReg64Mem(RDX, CONTEXT_REGISTER, offsetof(JitContext, programCounter));
+				emitter.MovMem16Reg(RDX, 0, RAX);
+				return true;
+			case 0xF000:
+				if (EmitMiscellaneous(instruction)) return false;
+				break;
+			}
+
+			EmitFallback(nextAddress, instruction);
+			return instruction.endsBlock;
+		}
+
+		void EmitExit(uint16_t nextAddress)
+		{
+			FlushRegisters();
+			StoreProgramCounter(nextAddress);
+		}
+
+		void EmitEpilogue()
+		{
+			emitter.AddRsp(STACK_RESERVE);
+
+			for (int i = sizeof(SAVED_REGISTERS) / sizeof(SAVED_REGISTERS[0]) - 1; i >= 0; i--) emitter.Pop(SAVED_REGISTERS[i]);
+
+			emitter.Ret();
+		}
+
+	private:
+		X64Emitter emitter;
+		JitCompiler::FallbackFunction fallback;
+		QuirkSettings quirks;
+
+		// Host register assigned to each V register, and to I (in the last slot)
+		int hostRegisters[I_REGISTER_SLOT + 1];
+		bool isDirty[I_REGISTER_SLOT + 1];
+
+		int V(int slot)
+		{
+			return hostRegisters[slot];
+		}
+
+		void MarkDirty(int slot)
+		{
+			isDirty[slot] = true;
+		}
+
+		static bool IsTranslatedArithmetic(uint16_t opcode)
+		{
+			uint8_t operation = opcode & 0x000F;
+			return operation <= 0x7 || operation == 0xE;
+		}
+
+		static bool IsTranslatedMiscellaneous(uint16_t opcode)
+		{
+			switch (opcode & 0xF0FF)
+			{
+			case 0xF007:
+			case 0xF015:
+			case 0xF018:
+			case 0xF01E:
+			case 0xF029:
+				return true;
+			case 0xF065:
+				return ((opcode & 0x0F00) >> 8) <= MAX_TRANSLATED_LOAD_REGISTER;
+			}
+
+			return false;
+		}
+
+		void GetUsedRegisters(const CPU::DecodedInstruction& instruction, bool* isUsed)
+		{
+			switch (instruction.opcode & 0xF000)
+			{
+			case 0x3000:
+			case 0x4000:
+			case 0x6000:
+			case 0x7000:
+				isUsed[instruction.x] = true;
+				break;
+			case 0x5000:
+			case 0x9000:
+				isUsed[instruction.x] = true;
+				isUsed[instruction.y] = true;
+				break;
+			case 0x8000:
+				if (!IsTranslatedArithmetic(instruction.opcode)) break;
+
+				isUsed[instruction.x] = true;
+				isUsed[instruction.y] = true;
+				isUsed[0xF] = true;
+				break;
+			case 0xA000:
+				isUsed[I_REGISTER_SLOT] = true;
+				break;
+			case 0xB000:
+				isUsed[quirks.isJumpingWithVx ? instruction.x : 0] = true;
+				break;
+			case 0xF000:
+				if (!IsTranslatedMiscellaneous(instruction.opcode)) break;
+
+				isUsed[instruction.x] = true;
+				if ((instruction.opcode & 0x00FF) == 0x1E || (instruction.opcode & 0x00FF) == 0x29) isUsed[I_REGISTER_SLOT] = true;
+
+				if ((instruction.opcode & 0x00FF) == 0x65)
+				{
+					for (int i = 0; i <= instruction.x; i++) isUsed[i] = true;
+					isUsed[I_REGISTER_SLOT] = true;
+				}
+				break;
+			}
+		}
+
+		void EmitArithmetic(const CPU::DecodedInstruction& instruction)
+		{
+			int x = V(instruction.x);
+			int y = V(instruction.y);
+			int vf = V(0xF);
+
+			// The source of the shifts depends on the quirk profile
+			int source = quirks.isShiftingVy ? y : x;
+
+			// The sequences below update VF at the same point as the interpreter does,
+			// so the results match when X or Y is F.
+			switch (instruction.opcode & 0x000F)
+			{
+			case 0x0:
+				emitter.MovRegReg32(x, y);
+				break;
+			case 0x1:
+				emitter.Alu(ALU_OR, x, y);
+				EmitFlagReset(vf);
+				break;
+			case 0x2:
+				emitter.Alu(ALU_AND, x, y);
+				EmitFlagReset(vf);
+				break;
+			case 0x3:
+				emitter.Alu(ALU_XOR, x, y);
+				EmitFlagReset(vf);
+				break;
+			case 0x4:
+				emitter.Alu(ALU_ADD, x, y);
+				emitter.MovRegReg32(RAX, x);
+				emitter.Shift(SHIFT_RIGHT, RAX, 8);
+				emitter.AluImm32(ALU_IMM_AND, x, 0xFF);
+				emitter.MovRegReg32(vf, RAX);
+				MarkDirty(0xF);
+				break;
+			// The flag is kept in RAX until it's written to VF, either before or after the result
+			case 0x5:
+				emitter.Alu(ALU_XOR, RAX, RAX);
+				emitter.Alu(ALU_CMP, x, y);
+				emitter.Setcc(CONDITION_ABOVE, RAX);
+				if (!quirks.isFlagWrittenLast) emitter.MovRegReg32(vf, RAX);
+				emitter.Alu(ALU_SUB, x, y);
+				emitter.AluImm32(ALU_IMM_AND, x, 0xFF);
+				if (quirks.isFlagWrittenLast) emitter.MovRegReg32(vf, RAX);
+				MarkDirty(0xF);
+				break;
+			case 0x6:
+				emitter.MovRegReg32(RAX, source);
+				emitter.AluImm32(ALU_IMM_AND, RAX, 1);
+				if (!quirks.isFlagWrittenLast) emitter.MovRegReg32(vf, RAX);
+				if (source != x) emitter.MovRegReg32(x, source);
+				emitter.Shift(SHIFT_RIGHT, x, 1);
+				if (quirks.isFlagWrittenLast) emitter.MovRegReg32(vf, RAX);
+				MarkDirty(0xF);
+				break;
+			case 0x7:
+				emitter.Alu(ALU_XOR, RDX, RDX);
+				emitter.Alu(ALU_CMP, y, x);
+				emitter.Setcc(CONDITION_ABOVE, RDX);
+				if (!quirks.isFlagWrittenLast) emitter.MovRegReg32(vf, RDX);
+				emitter.MovRegReg32(RAX, y);
+				emitter.Alu(ALU_SUB, RAX, x);
+				emitter.AluImm32(ALU_IMM_AND, RAX, 0xFF);
+				emitter.MovRegReg32(x, RAX);
+				if (quirks.isFlagWrittenLast) emitter.MovRegReg32(vf, RDX);
+				MarkDirty(0xF);
+				break;
+			case 0xE:
+				emitter.MovRegReg32(RAX, source);
+				emitter.Shift(SHIFT_RIGHT, RAX, 7);
+				if (!quirks.isFlagWrittenLast) emitter.MovRegReg32(vf, RAX);
+				if (source != x) emitter.MovRegReg32(x, source);
+				emitter.Shift(SHIFT_LEFT, x, 1);
+				emitter.AluImm32(ALU_IMM_AND, x, 0xFF);
+				if (quirks.isFlagWrittenLast) emitter.MovRegReg32(vf, RAX);
+				MarkDirty(0xF);
+				break;
+			}
+
+			MarkDirty(instruction.x);
+		}
+
+		// Clears VF after the logical instructions, if the quirk profile does
+		void EmitFlagReset(int vf)
+		{
+			if (!quirks.isFlagReset) return;
+
+			emitter.MovRegImm32(vf, 0);
+			MarkDirty(0xF);
+		}
+
+		// Returns false if the instruction isn't translated
+		bool EmitMiscellaneous(const CPU::DecodedInstruction& instruction)
+		{
+			if (!IsTranslatedMiscellaneous(instruction.opcode)) return false;
+
+			int x = V(instruction.x);
+			int i = V(I_REGISTER_SLOT);
+
+			switch (instruction.opcode & 0x00FF)
+			{
+			case 0x07:
+				emitter.MovReg64Mem(RAX, CONTEXT_REGISTER, offsetof(JitContext, timerRegisters));
+				emitter.MovzxRegMem8(x, RAX, 0);
+				MarkDirty(instruction.x);
+				break;
+			case 0x15:
+			case 0x18:
+				emitter.MovReg64Mem(RAX, CONTEXT_REGISTER, offsetof(JitContext, timerRegisters));
+				emitter.MovMem16Reg(RAX, (instruction.opcode & 0x00FF) == 0x15 ? 0 : sizeof(uint16_t), x);
+				break;
+			case 0x1E:
+				emitter.Alu(ALU_ADD, i, x);
+				emitter.AluImm32(ALU_IMM_AND, i, 0xFFFF);
+				MarkDirty(I_REGISTER_SLOT);
+				break;
+			case 0x29:
+				emitter.ImulImm8(i, x, Memory::FONT_SPRITE_SIZE);
+				MarkDirty(I_REGISTER_SLOT);
+				break;
+			case 0x65:
+				emitter.MovReg64Mem(RDX, CONTEXT_REGISTER, offsetof(JitContext, memory));
+
+				for (int index = 0; index <= instruction.x; index++)
+				{
+					emitter.Lea32(RAX, i, index);
+					emitter.AluImm32(ALU_IMM_AND, RAX, Memory::TOTAL_MEMORY - 1);
+					emitter.MovzxRegMemIndexed8(V(index), RDX, RAX);
+					MarkDirty(index);
+				}
+
+				if (quirks.isIncrementingI)
+				{
+					emitter.AluImm32(ALU_IMM_ADD, i, instruction.x + 1);
+					emitter.AluImm32(ALU_IMM_AND, i, 0xFFFF);
+					MarkDirty(I_REGISTER_SLOT);
+				}
+				break;
+			}
+
+			return true;
+		}
+
+		// Sets RAX to the address of the next instruction, and RDX to the address after it. The instruction after a skip 
+		// may be F000 NNNN, which is skipped as a whole, and since it may be overwritten, it's checked when the block runs.
+		void EmitSkipAddresses(uint16_t nextAddress)
+		{
+			emitter.MovRegImm32(RDX, (uint16_t)(nextAddress + 2));
+
+			if (nextAddress + 1 < Memory::TOTAL_MEMORY)
+			{
+				// RDX += (memory[nextAddress] == 0xF0 && memory[nextAddress + 1] == 0x00) ? 2 : 0
+				emitter.MovReg64Mem(RAX, CONTEXT_REGISTER, offsetof(JitContext, memory));
+				emitter.MovzxRegMem16(RAX, RAX, nextAddress);
+				emitter.AluImm32(ALU_IMM_CMP, RAX, 0x00F0);
+				emitter.MovRegImm32(RAX, 0);
+				emitter.Setcc(CONDITION_EQUAL, RAX);
+				emitter.Alu(ALU_ADD, RAX, RAX);
+				emitter.Alu(ALU_ADD, RDX, RAX);
+				emitter.AluImm32(ALU_IMM_AND, RDX, 0xFFFF);
+			}
+
+			emitter.MovRegImm32(RAX, nextAddress);
+		}
+
+		// Expects the registers to be flushed, RAX to hold the address of the next instruction, 
+		// RDX the address after it, and the flags to be set by the comparison.
+		void EmitSkip(ConditionCode condition)
+		{
+			emitter.Cmov(condition, RAX, RDX);
+
+			emitter.MovReg64Mem(RDX, CONTEXT_REGISTER, offsetof(JitContext, programCounter));
+			emitter.MovMem16Reg(RDX, 0, RAX);
+		}
+
+		// Executes the instruction with the interpreter. The program counter is updated first,
+		// since handlers like the skips and FX0A expect it to point to the next instruction.
+		void EmitFallback(uint16_t nextAddress, const CPU::DecodedInstruction& instruction)
+		{
+			FlushRegisters();
+			if (instruction.endsBlock) StoreProgramCounter(nextAddress);
+
+			emitter.MovReg64Mem(FIRST_ARGUMENT, CONTEXT_REGISTER, offsetof(JitContext, cpu));
+			emitter.MovRegImm64(SECOND_ARGUMENT, (uint64_t)&instruction);
+			emitter.MovRegImm64(RAX, (uint64_t)fallback);
+			emitter.CallReg(RAX);
+
+			// The handler may have changed any register, and the call may have overwritten the host registers
+			if (!instruction.endsBlock) LoadRegisters();
+		}
+
+		void LoadRegisters()
+		{
+			emitter.MovReg64Mem(RAX, CONTEXT_REGISTER, offsetof(JitContext, vRegisters));
+
+			for (int slot = 0; slot < I_REGISTER_SLOT; slot++)
+			{
+				if (hostRegisters[slot] != NO_REGISTER) emitter.MovzxRegMem8(hostRegisters[slot], RAX, slot);
+			}
+
+			if (hostRegisters[I_REGISTER_SLOT] != NO_REGISTER)
+			{
+				emitter.MovReg64Mem(RAX, CONTEXT_REGISTER, offsetof(JitContext, iRegister));
+				emitter.MovzxRegMem16(hostRegisters[I_REGISTER_SLOT], RAX, 0);
+			}
+		}
+
+		// Writes registers that were changed back to the CPU. RAX is overwritten.
+		void FlushRegisters()
+		{
+			emitter.MovReg64Mem(RAX, CONTEXT_REGISTER, offsetof(JitContext, vRegisters));
+
+			for (int slot = 0; slot < I_REGISTER_SLOT; slot++)
+			{
+				if (!isDirty[slot]) continue;
+
+				emitter.MovMem8Reg(RAX, slot, hostRegisters[slot]);
+				isDirty[slot] = false;
+			}
+
+			if (isDirty[I_REGISTER_SLOT])
+			{
+				emitter.MovReg64Mem(RAX, CONTEXT_REGISTER, offsetof(JitContext, iRegister));
+				emitter.MovMem16Reg(RAX, 0, hostRegisters[I_REGISTER_SLOT]);
+				isDirty[I_REGISTER_SLOT] = false;
+			}
+		}
+
+		void StoreProgramCounter(uint16_t address)
+		{
+			emitter.MovReg64Mem(RAX, CONTEXT_REGISTER, offsetof(JitContext, programCounter));
+			emitter.MovMem16Imm(RAX, 0, address);
+		}
+	};
+#endif
+
+	bool JitCompiler::IsSupported()
+	{
+#ifdef SHG_JIT_X64
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	JitCompiler::JitCompiler(JitContext context, FallbackFunction fallback, QuirkSettings quirks)
+	{
+		this->context = context;
+		this->quirks = quirks;
+		this->fallback = fallback;
+
+#ifdef SHG_JIT_X64
+#ifdef _WIN32
+		void* buffer = VirtualAlloc(nullptr, CODE_BUFFER_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+#else
+		void* buffer = mmap(nullptr, CODE_BUFFER_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (buffer == MAP_FAILED) buffer = nullptr;
+#endif
+
+		if (buffer != nullptr)
+		{
+			codeBuffer = (uint8_t*)buffer;
+			codeBufferSize = CODE_BUFFER_SIZE;
+		}
+#endif
+	}
+
+	JitCompiler::~JitCompiler()
+	{
+		if (codeBuffer == nullptr) return;
+
+#ifdef SHG_JIT_X64
+#ifdef _WIN32
+		VirtualFree(codeBuffer, 0, MEM_RELEASE);
+#else
+		munmap(codeBuffer, codeBufferSize);
+#endif
+#endif
+	}
+
+	JitCompiler::NativeBlock JitCompiler::Compile(uint16_t startAddress, const CPU::DecodedInstruction* instructions, int count, int* compiledCount)
+	{
+		*compiledCount = 0;
+
+#ifdef SHG_JIT_X64
+		if (codeBuffer == nullptr || codeBufferSize - codeBufferUsed < MAX_BLOCK_CODE_SIZE) return nullptr;
+
+		uint8_t* code = codeBuffer + codeBufferUsed;
+		BlockTranslator translator(code, fallback, quirks);
+
+		int translatedCount = translator.AllocateRegisters(instructions, count);
+		if (translatedCount == 0) return nullptr;
+
+		translator.EmitPrologue();
+
+		uint16_t address = startAddress;
+		bool hasExited = false;
+
+		for (int i = 0; i < translatedCount && !hasExited; i++)
+		{
+			hasExited = translator.EmitInstruction(address, instructions[i]);
+			address += 2;
+		}
+
+		if (!hasExited) translator.EmitExit(address);
+
+		translator.EmitEpilogue();
+
+		codeBufferUsed += translator.GetSize();
+		*compiledCount = translatedCount;
+
+		return (NativeBlock)code;
+#else
+		return nullptr;
+#endif
+	}
+
+	bool JitCompiler::IsFull()
+	{
+		return codeBuffer != nullptr && codeBufferSize - codeBufferUsed < MAX_BLOCK_CODE_SIZE;
+	}
+
+	void JitCompiler::Reset()
+	{
+		codeBufferUsed = 0;
+	}
+}
@@ -1,57 +1,88 @@
-#include <map>
-#include <iostream>
-#include <iomanip>
 #include "Keypad.hpp"
+#include "Bits.hpp"
 
 namespace SHG
 {
-	static const std::map<SDL_Keycode, uint8_t> KEYS =
+	bool Keypad::IsKeyPressed(uint8_t key)
 	{
-		{SDLK_1, 0x1}, {SDLK_2, 0x2},    {SDLK_3, 0x3},		{SDLK_4, 0xC},
-		{SDLK_q, 0x4}, {SDLK_w, 0x5},    {SDLK_e, 0x6},     {SDLK_r, 0xD},
-		{SDLK_a, 0x7}, {SDLK_s, 0x8},    {SDLK_d, 0x9},     {SDLK_f, 0xE},
-		{SDLK_z, 0xA}, {SDLK_x, 0x0},	 {SDLK_c, 0xB},		{SDLK_v, 0xF}
-	};
+		if (key >= KEY_COUNT) return false;
 
-	Keypad::Keypad()
-	{
-		for (int i = 0; i < 16; i++) keyStates[i] = false;
+		return (keyStates.load(std::memory_order_relaxed) >> key) & 1;
 	}
 
-	bool Keypad::IsKeyPressed(uint8_t key)
+	void Keypad::SetKeyState(uint8_t key, bool isPressed)
 	{
-		return keyStates[key];
-	}
+		if (key >= KEY_COUNT) return;
 
-	void Keypad::Update(SDL_Event e)
-	{
-		SDL_Keycode keyCode = e.key.keysym.sym;
-		if (KEYS.count(keyCode) == 0) return;
+		uint16_t keyBit = (uint16_t)(1 << key);
 
-		if (e.type == SDL_KEYDOWN)
+		if (isPressed)
 		{
-			keyStates[KEYS.at(keyCode)] = true;
-
-			/*std::cout << "Detected key press: " << std::hex << std::setfill('0') << std::setw(2) << (int)KEYS.at(e.key.keysym.sym) << std::endl;
-			std::cout << std::resetiosflags(std::ios::hex);*/
+			keyStates.fetch_or(keyBit, std::memory_order_relaxed);
 		}
-		else if (e.type == SDL_KEYUP)
+		else
 		{
-			keyStates[KEYS.at(keyCode)] = false;
+			uint16_t previousKeyStates = keyStates.fetch_and((uint16_t)~keyBit, std::memory_order_relaxed);
+			if (previousKeyStates & keyBit) releasedKeyStates.fetch_or(keyBit, std::memory_order_relaxed);
 		}
-	}
 
-	bool Keypad::GetKeyPressedThisFrame(uint8_t* key)
-	{
-		for (int i = 0; i < 16; i++)
 		{
-			if (keyStates[i])
-			{
-				*key = i;
-				return true;
-			}
+			std::lock_guard<std::mutex> lock(keyEventMutex);
+			keyEventCount++;
 		}
 
-		return false;
+		keyEventCondition.notify_all();
+	}
+
+	uint16_t Keypad::GetKeyStates()
+	{
+		return keyStates.load(std::memory_order_relaxed);
+	}
+
+	uint16_t Keypad::GetReleasedKeyStates()
+	{
+		return releasedKeyStates.load(std::memory_order_relaxed);
+	}
+
+	void Keypad::SetKeyStates(uint16_t keyStates, uint16_t releasedKeyStates)
+	{
+		this->keyStates.store(keyStates, std::memory_order_relaxed);
+		this->releasedKeyStates.store(releasedKeyStates, std::memory_order_relaxed);
+	}
+
+	bool Keypad::GetReleasedKey(uint8_t* key)
+	{
+		uint16_t releasedKeys = releasedKeyStates.load(std::memory_order_relaxed);
+		if (releasedKeys == 0) return false;
+
+		// The lowest released key is reported, same as checking every key in order
+		*key = (uint8_t)CountTrailingZeros(releasedKeys);
+		releasedKeyStates.fetch_and((uint16_t)~(1 << *key), std::memory_order_relaxed);
+
+		return true;
+	}
+
+	void Keypad::ClearReleasedKeys()
+	{
+		releasedKeyStates.store(0, std::memory_order_relaxed);
+	}
+
+	void Keypad::ClearReleasedKey(uint8_t key)
+	{
+		if (key < KEY_COUNT) releasedKeyStates.fetch_and((uint16_t)~(1 << key), std::memory_order_relaxed);
+	}
+
+	void Keypad::WaitForKeyEvent(std::chrono::steady_clock::time_point deadline)
+	{
+		std::unique_lock<std::mutex> lock(keyEventMutex);
+
+		uint32_t startEventCount = keyEventCount;
+		keyEventCondition.wait_until(lock, deadline, [&] { return keyEventCount != startEventCount; });
+	}
+
+	uint32_t Keypad::GetKeyEventCount()
+	{
+		std::lock_guard<std::mutex> lock(keyEventMutex);
+		return keyEventCount;
 	}
 }
\ No newline at end of file
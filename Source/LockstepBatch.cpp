@@ -0,0 +1,596 @@
+#include <algorithm>
+#include "LockstepBatch.hpp"
+#include "Bits.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SHG_LOCKSTEP_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(SHG_LOCKSTEP_AVX2) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// GCC and Clang only allow AVX2 intrinsics in functions compiled for AVX2,
+// so the rest of the program doesn't require an AVX2 CPU.
+#if defined(SHG_LOCKSTEP_AVX2) && defined(__GNUC__)
+#define SHG_AVX2_FUNCTION __attribute__((target("avx2")))
+#else
+#define SHG_AVX2_FUNCTION
+#endif
+
+namespace SHG
+{
+	static const uint32_t ALL_LANES = 0xFFFFFFFF;
+
+	// Returns false for the SUPER-CHIP and XO-CHIP instructions, which the CPU executes differently from a lane
+	static bool IsChip8Instruction(uint16_t instruction)
+	{
+		switch (instruction >> 12)
+		{
+		case 0x0: return (instruction & 0xFFE0) != 0x00C0 && (instruction < 0x00FB || instruction > 0x00FF);
+		case 0x5: return (instruction & 0x000F) != 0x2 && (instruction & 0x000F) != 0x3;
+		case 0xD: return (instruction & 0x000F) != 0;
+		case 0xF:
+			switch (instruction & 0x00FF)
+			{
+			case 0x00: return instruction != 0xF000;
+			case 0x02: return instruction != 0xF002;
+			case 0x01:
+			case 0x30:
+			case 0x3A:
+			case 0x75:
+			case 0x85:
+				return false;
+			}
+			return true;
+		}
+
+		return true;
+	}
+
+	LockstepBatch::LockstepBatch() : memories(LANE_COUNT * Memory::TOTAL_MEMORY)
+	{
+		isAvx2Enabled = IsAvx2Supported();
+
+		for (int lane = 0; lane < LANE_COUNT; lane++) programCounters[lane] = Memory::RESERVED_MEMORY_SIZE;
+	}
+
+	bool LockstepBatch::IsAvx2Supported()
+	{
+#if defined(SHG_LOCKSTEP_AVX2) && defined(_MSC_VER)
+		int info[4];
+
+		// The CPU has to support AVX2, and the OS has to save the AVX registers
+		__cpuid(info, 1);
+		bool isAvxEnabled = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+
+		__cpuidex(info, 7, 0);
+		return isAvxEnabled && (info[1] & (1 << 5)) != 0;
+#elif defined(SHG_LOCKSTEP_AVX2)
+		return __builtin_cpu_supports("avx2");
+#else
+		return false;
+#endif
+	}
+
+	bool LockstepBatch::LoadRom(const uint8_t* rom, int size)
+	{
+		// The fonts and the ROM are placed in memory the same way as for a single machine
+		Memory memory;
+		if (!memory.LoadRom(rom, size)) return false;
+
+		for (int lane = 0; lane < LANE_COUNT; lane++)
+		{
+			std::copy(memory.GetData(), memory.GetData() + Memory::TOTAL_MEMORY, memories.begin() + lane * Memory::TOTAL_MEMORY);
+		}
+
+		return true;
+	}
+
+	void LockstepBatch::RunFrames(int instructionsPerSecond, int frameCount)
+	{
+		this->instructionsPerSecond = std::max(instructionsPerSecond, 1);
+		frameInstructionRemainder = 0;
+
+		for (int frame = 0; frame < frameCount; frame++) RunFrame(GetFrameInstructionCount());
+	}
+
+	void LockstepBatch::RunFrame(int instructionCount)
+	{
+		// Lanes that are waiting for a key only continue once a key has been released
+		for (uint32_t lanes = waitingLanes; lanes != 0; lanes &= lanes - 1)
+		{
+			int lane = CountTrailingZeros(lanes);
+			uint8_t key = 0;
+
+			if (!keypads[lane].GetReleasedKey(&key)) continue;
+
+			vRegisters[keyWaitRegisters[lane]][lane] = key;
+			waitingLanes &= ~(1u << lane);
+		}
+
+		uint32_t activeLanes = ALL_LANES & ~waitingLanes & ~failedLanes;
+
+		for (int step = 0; step < instructionCount && activeLanes != 0; step++)
+		{
+			Step(activeLanes);
+
+			// Lanes that started waiting for a key in this step don't execute anything else in this frame, same as the CPU
+			for (uint32_t lanes = activeLanes & waitingLanes; lanes != 0; lanes &= lanes - 1)
+			{
+				instructionCounts[CountTrailingZeros(lanes)] += step + 1;
+			}
+
+			activeLanes &= ~(waitingLanes | failedLanes);
+		}
+
+		for (uint32_t lanes = activeLanes; lanes != 0; lanes &= lanes - 1)
+		{
+			instructionCounts[CountTrailingZeros(lanes)] += instructionCount;
+		}
+
+		UpdateTimers();
+	}
+
+	Display& LockstepBatch::GetDisplay(int lane)
+	{
+		return displays[lane];
+	}
+
+	Keypad& LockstepBatch::GetKeypad(int lane)
+	{
+		return keypads[lane];
+	}
+
+	void LockstepBatch::SaveRegisters(int lane, CPU::RegisterState* state)
+	{
+		*state = CPU::RegisterState{};
+
+		for (int i = 0; i < CPU::REGISTER_COUNT; i++) state->vRegisters[i] = vRegisters[i][lane];
+		for (int i = 0; i < CPU::STACK_SIZE; i++) state->stack[i] = stacks[i][lane];
+
+		state->iRegister = iRegisters[lane];
+		state->programCounter = programCounters[lane];
+		state->stackPointer = stackPointers[lane];
+		state->timerRegisters[DELAY_TIMER_INDEX] = timerRegisters[DELAY_TIMER_INDEX][lane];
+		state->timerRegisters[SOUND_TIMER_INDEX] = timerRegisters[SOUND_TIMER_INDEX][lane];
+	}
+
+	uint64_t LockstepBatch::GetInstructionCount(int lane)
+	{
+		return instructionCounts[lane];
+	}
+
+	bool LockstepBatch::HasLaneFailed(int lane)
+	{
+		return (failedLanes >> lane) & 1;
+	}
+
+	void LockstepBatch::SetRandomSeed(int lane, uint64_t seed)
+	{
+		randoms[lane].Seed(seed);
+	}
+
+	void LockstepBatch::SetAvx2Enabled(bool isEnabled)
+	{
+		isAvx2Enabled = isEnabled && IsAvx2Supported();
+	}
+
+	uint64_t LockstepBatch::GetVectorInstructionCount()
+	{
+		return vectorInstructionCount;
+	}
+
+	uint64_t LockstepBatch::GetScalarInstructionCount()
+	{
+		return scalarInstructionCount;
+	}
+
+	int LockstepBatch::GetFrameInstructionCount()
+	{
+		// Same as the CPU, so that every lane executes the same number of instructions per frame as a single machine
+		frameInstructionRemainder += instructionsPerSecond;
+
+		int count = frameInstructionRemainder / CPU::FRAMES_PER_SECOND;
+		frameInstructionRemainder %= CPU::FRAMES_PER_SECOND;
+
+		return count;
+	}
+
+	void LockstepBatch::UpdateTimers()
+	{
+		for (int timer = 0; timer < 2; timer++)
+		{
+			for (int lane = 0; lane < LANE_COUNT; lane++)
+			{
+				if (timerRegisters[timer][lane] > 0) timerRegisters[timer][lane]--;
+			}
+		}
+	}
+
+	void LockstepBatch::Step(uint32_t activeLanes)
+	{
+		// Every active lane executes exactly one instruction. Lanes at the same address are grouped together,
+		// and each group is executed at once.
+		uint32_t remainingLanes = activeLanes;
+
+		while (remainingLanes != 0)
+		{
+			int firstLane = CountTrailingZeros(remainingLanes);
+			uint16_t address = programCounters[firstLane];
+			uint16_t instruction = FetchInstruction(firstLane, address);
+
+			uint32_t groupLanes = GetLanesAtAddress(address, remainingLanes);
+
+			// If the code at this address has been overwritten, the lanes may have different instructions there
+			if (isAddressWritten[address & (Memory::TOTAL_MEMORY - 1)] || isAddressWritten[(address + 1) & (Memory::TOTAL_MEMORY - 1)])
+			{
+				for (uint32_t lanes = groupLanes; lanes != 0; lanes &= lanes - 1)
+				{
+					int lane = CountTrailingZeros(lanes);
+					if (FetchInstruction(lane, address) != instruction) groupLanes &= ~(1u << lane);
+				}
+			}
+
+			remainingLanes &= ~groupLanes;
+
+			if (groupLanes != (1u << firstLane) && ExecuteVector(instruction, groupLanes))
+			{
+				vectorInstructionCount++;
+				continue;
+			}
+
+			for (uint32_t lanes = groupLanes; lanes != 0; lanes &= lanes - 1)
+			{
+				ExecuteLane(CountTrailingZeros(lanes), instruction);
+				scalarInstructionCount++;
+			}
+		}
+	}
+
+	uint16_t LockstepBatch::FetchInstruction(int lane, uint16_t address)
+	{
+		const uint8_t* memory = &memories[lane * Memory::TOTAL_MEMORY];
+
+		return (memory[address & (Memory::TOTAL_MEMORY - 1)] << 8) | memory[(address + 1) & (Memory::TOTAL_MEMORY - 1)];
+	}
+
+	uint32_t LockstepBatch::GetLanesAtAddress(uint16_t address, uint32_t lanes)
+	{
+		uint32_t matchingLanes = 0;
+
+		for (int lane = 0; lane < LANE_COUNT; lane++)
+		{
+			if (programCounters[lane] == address) matchingLanes |= 1u << lane;
+		}
+
+		return matchingLanes & lanes;
+	}
+
+	bool LockstepBatch::ExecuteVector(uint16_t instruction, uint32_t lanes)
+	{
+#ifdef SHG_LOCKSTEP_AVX2
+		if (isAvx2Enabled && ExecuteVectorAvx2(instruction, lanes)) return true;
+#endif
+
+		uint8_t x = (instruction & 0x0F00) >> 8;
+		uint16_t nnn = instruction & 0x0FFF;
+
+		// The remaining instructions that only change registers are applied to each lane in a simple loop, 
+		// which is still much cheaper than decoding the instruction again for every lane
+		switch (instruction & 0xF0FF)
+		{
+		case 0xF007:
+			for (int lane = 0; lane < LANE_COUNT; lane++)
+			{
+				if ((lanes >> lane) & 1) vRegisters[x][lane] = (uint8_t)timerRegisters[DELAY_TIMER_INDEX][lane];
+			}
+			break;
+		case 0xF015:
+		case 0xF018:
+		{
+			uint16_t* timers = timerRegisters[(instruction & 0x00FF) == 0x15 ? DELAY_TIMER_INDEX : SOUND_TIMER_INDEX];
+
+			for (int lane = 0; lane < LANE_COUNT; lane++)
+			{
+				if ((lanes >> lane) & 1) timers[lane] = vRegisters[x][lane];
+			}
+			break;
+		}
+		case 0xF01E:
+			for (int lane = 0; lane < LANE_COUNT; lane++)
+			{
+				if ((lanes >> lane) & 1) iRegisters[lane] += vRegisters[x][lane];
+			}
+			break;
+		case 0xF029:
+			for (int lane = 0; lane < LANE_COUNT; lane++)
+			{
+				if ((lanes >> lane) & 1) iRegisters[lane] = vRegisters[x][lane] * Memory::FONT_SPRITE_SIZE;
+			}
+			break;
+		default:
+			switch (instruction >> 12)
+			{
+			case 0xA:
+				for (int lane = 0; lane < LANE_COUNT; lane++)
+				{
+					if ((lanes >> lane) & 1) iRegisters[lane] = nnn;
+				}
+				break;
+			case 0x1:
+				for (int lane = 0; lane < LANE_COUNT; lane++)
+				{
+					if ((lanes >> lane) & 1) programCounters[lane] = nnn;
+				}
+
+				// Jumps don't move to the next instruction
+				return true;
+			default:
+				return false;
+			}
+			break;
+		}
+
+		for (int lane = 0; lane < LANE_COUNT; lane++) programCounters[lane] += ((lanes >> lane) & 1) * 2;
+
+		return true;
+	}
+
+#ifdef SHG_LOCKSTEP_AVX2
+	// Expands a lane mask into a vector with 0xFF in the bytes of the selected lanes
+	SHG_AVX2_FUNCTION static __m256i ExpandLaneMask(uint32_t lanes)
+	{
+		const __m256i byteSelect = _mm256_setr_epi64x(0x0000000000000000, 0x0101010101010101, 0x0202020202020202, 0x0303030303030303);
+		const __m256i bitSelect = _mm256_set1_epi64x((int64_t)0x8040201008040201);
+
+		__m256i laneBits = _mm256_shuffle_epi8(_mm256_set1_epi32((int)lanes), byteSelect);
+		return _mm256_cmpeq_epi8(_mm256_and_si256(laneBits, bitSelect), bitSelect);
+	}
+
+	// Returns a vector with 1 in the bytes where a is greater than b, when both are unsigned
+	SHG_AVX2_FUNCTION static __m256i GreaterThanAsFlag(__m256i a, __m256i b)
+	{
+		__m256i isLessOrEqual = _mm256_cmpeq_epi8(_mm256_max_epu8(a, b), b);
+		return _mm256_andnot_si256(isLessOrEqual, _mm256_set1_epi8(1));
+	}
+
+	SHG_AVX2_FUNCTION bool LockstepBatch::ExecuteVectorAvx2(uint16_t instruction, uint32_t lanes)
+	{
+		uint8_t x = (instruction & 0x0F00) >> 8;
+		uint8_t y = (instruction & 0x00F0) >> 4;
+		uint8_t kk = instruction & 0x00FF;
+		uint8_t opcode = instruction >> 12;
+
+		// Instructions where the result depends on VF being written before or after Vx are rare, and left to the scalar path
+		bool isAliasingVF = x == VF_REG_INDEX || y == VF_REG_INDEX;
+
+		__m256i vx = _mm256_load_si256((const __m256i*)vRegisters[x]);
+		__m256i vy = _mm256_load_si256((const __m256i*)vRegisters[y]);
+		__m256i vf = _mm256_load_si256((const __m256i*)vRegisters[VF_REG_INDEX]);
+		__m256i one = _mm256_set1_epi8(1);
+
+		__m256i newVx = vx;
+		__m256i newVf = vf;
+
+		// Lanes that skip the next instruction
+		uint32_t skipLanes = 0;
+
+		switch (opcode)
+		{
+		case 0x3:
+			skipLanes = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(vx, _mm256_set1_epi8((char)kk)));
+			break;
+		case 0x4:
+			skipLanes = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(vx, _mm256_set1_epi8((char)kk)));
+			break;
+		case 0x5:
+			// 5XY2 and 5XY3 aren't CHIP-8 instructions, and fail the lanes on the scalar path
+			if ((instruction & 0x000F) == 0x2 || (instruction & 0x000F) == 0x3) return false;
+			skipLanes = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(vx, vy));
+			break;
+		case 0x9:
+			skipLanes = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(vx, vy));
+			break;
+		case 0x6:
+			newVx = _mm256_set1_epi8((char)kk);
+			break;
+		case 0x7:
+			newVx = _mm256_add_epi8(vx, _mm256_set1_epi8((char)kk));
+			break;
+		case 0x8:
+			switch (instruction & 0x000F)
+			{
+			case 0x0: newVx = vy; break;
+			case 0x1: newVx = _mm256_or_si256(vx, vy); break;
+			case 0x2: newVx = _mm256_and_si256(vx, vy); break;
+			case 0x3: newVx = _mm256_xor_si256(vx, vy); break;
+			case 0x4:
+				if (isAliasingVF) return false;
+				newVx = _mm256_add_epi8(vx, vy);
+
+				// The addition carried if the result is smaller than Vx
+				newVf = GreaterThanAsFlag(vx, newVx);
+				break;
+			case 0x5:
+				if (isAliasingVF) return false;
+				newVf = GreaterThanAsFlag(vx, vy);
+				newVx = _mm256_sub_epi8(vx, vy);
+				break;
+			case 0x6:
+				if (x == VF_REG_INDEX) return false;
+				newVf = _mm256_and_si256(vx, one);
+				newVx = _mm256_and_si256(_mm256_srli_epi16(vx, 1), _mm256_set1_epi8(0x7F));
+				break;
+			case 0x7:
+				if (isAliasingVF) return false;
+				newVf = GreaterThanAsFlag(vy, vx);
+				newVx = _mm256_sub_epi8(vy, vx);
+				break;
+			case 0xE:
+				if (x == VF_REG_INDEX) return false;
+				newVf = _mm256_and_si256(_mm256_srli_epi16(vx, 7), one);
+				newVx = _mm256_add_epi8(vx, vx);
+				break;
+			default:
+				return false;
+			}
+			break;
+		default:
+			return false;
+		}
+
+		__m256i laneMask = ExpandLaneMask(lanes);
+		_mm256_store_si256((__m256i*)vRegisters[x], _mm256_blendv_epi8(vx, newVx, laneMask));
+
+		// VF is stored after Vx, so that it's only changed by the instructions that set it
+		if (x != VF_REG_INDEX) _mm256_store_si256((__m256i*)vRegisters[VF_REG_INDEX], _mm256_blendv_epi8(vf, newVf, laneMask));
+
+		// Every lane moves to the next instruction, and the ones that skip move once more
+		skipLanes &= lanes;
+
+		for (int lane = 0; lane < LANE_COUNT; lane++)
+		{
+			programCounters[lane] += ((lanes >> lane) & 1) * 2 + ((skipLanes >> lane) & 1) * 2;
+		}
+
+		return true;
+	}
+#endif
+
+	void LockstepBatch::ExecuteLane(int lane, uint16_t instruction)
+	{
+		if (!IsChip8Instruction(instruction))
+		{
+			failedLanes |= 1u << lane;
+			return;
+		}
+
+		uint8_t* memory = &memories[lane * Memory::TOTAL_MEMORY];
+		const int addressMask = Memory::TOTAL_MEMORY - 1;
+
+		uint8_t x = (instruction & 0x0F00) >> 8;
+		uint8_t y = (instruction & 0x00F0) >> 4;
+		uint8_t kk = instruction & 0x00FF;
+		uint8_t n = instruction & 0x000F;
+		uint16_t nnn = instruction & 0x0FFF;
+
+		uint8_t& vx = vRegisters[x][lane];
+		uint8_t& vy = vRegisters[y][lane];
+		uint8_t& vf = vRegisters[VF_REG_INDEX][lane];
+		uint16_t& pc = programCounters[lane];
+		uint16_t& i = iRegisters[lane];
+
+		pc += 2;
+
+		switch (instruction >> 12)
+		{
+		case 0x0:
+			if (instruction == 0x00E0) displays[lane].Clear();
+			else if (instruction == 0x00EE) pc = stacks[stackPointers[lane]-- & (CPU::STACK_SIZE - 1)][lane];
+			else pc = nnn;
+			break;
+		case 0x1: pc = nnn; break;
+		case 0x2:
+			stacks[++stackPointers[lane] & (CPU::STACK_SIZE - 1)][lane] = pc;
+			pc = nnn;
+			break;
+		case 0x3: if (vx == kk) pc += 2; break;
+		case 0x4: if (vx != kk) pc += 2; break;
+		case 0x5: if (vx == vy) pc += 2; break;
+		case 0x6: vx = kk; break;
+		case 0x7: vx += kk; break;
+		case 0x8:
+			switch (n)
+			{
+			case 0x0: vx = vy; break;
+			case 0x1: vx |= vy; break;
+			case 0x2: vx &= vy; break;
+			case 0x3: vx ^= vy; break;
+			case 0x4:
+			{
+				uint16_t sum = vx + vy;
+				vx = sum & 0xFF;
+				vf = sum > 0xFF ? 1 : 0;
+				break;
+			}
+			case 0x5:
+				vf = vx > vy ? 1 : 0;
+				vx -= vy;
+				break;
+			case 0x6:
+				vf = vx & 1;
+				vx /= 2;
+				break;
+			case 0x7:
+				vf = vy > vx ? 1 : 0;
+				vx = vy - vx;
+				break;
+			case 0xE:
+				vf = (vx & 0x80) >> 7;
+				vx *= 2;
+				break;
+			}
+			break;
+		case 0x9: if (vx != vy) pc += 2; break;
+		case 0xA: i = nnn; break;
+		case 0xB: pc = nnn + vRegisters[0][lane]; break;
+		case 0xC: vx = randoms[lane].NextByte() & kk; break;
+		case 0xD:
+		{
+			int spriteX = vx % Display::LOW_RES_SCREEN_WIDTH;
+			int spriteY = vy % Display::LOW_RES_SCREEN_HEIGHT;
+			bool isCollision = false;
+
+			for (int row = 0; row < n && spriteY + row < Display::LOW_RES_SCREEN_HEIGHT; row++)
+			{
+				if (displays[lane].DrawSpriteRow(spriteX, spriteY + row, memory[(i + row) & addressMask])) isCollision = true;
+			}
+
+			vf = isCollision ? 1 : 0;
+			break;
+		}
+		case 0xE:
+			if (kk == 0x9E && keypads[lane].IsKeyPressed(vx)) pc += 2;
+			else if (kk == 0xA1 && !keypads[lane].IsKeyPressed(vx)) pc += 2;
+			break;
+		case 0xF:
+			switch (kk)
+			{
+			case 0x07: vx = (uint8_t)timerRegisters[DELAY_TIMER_INDEX][lane]; break;
+			case 0x0A:
+				keypads[lane].ClearReleasedKeys();
+				keyWaitRegisters[lane] = x;
+				waitingLanes |= 1u << lane;
+				break;
+			case 0x15: timerRegisters[DELAY_TIMER_INDEX][lane] = vx; break;
+			case 0x18: timerRegisters[SOUND_TIMER_INDEX][lane] = vx; break;
+			case 0x1E: i += vx; break;
+			case 0x29: i = vx * Memory::FONT_SPRITE_SIZE; break;
+			case 0x33:
+			{
+				uint8_t digits[3] = { (uint8_t)(vx / 100), (uint8_t)(vx / 10 % 10), (uint8_t)(vx % 10) };
+
+				for (int digit = 0; digit < 3; digit++)
+				{
+					memory[(i + digit) & addressMask] = digits[digit];
+					isAddressWritten[(i + digit) & addressMask] = true;
+				}
+				break;
+			}
+			case 0x55:
+				for (int index = 0; index <= x; index++)
+				{
+					memory[(i + index) & addressMask] = vRegisters[index][lane];
+					isAddressWritten[(i + index) & addressMask] = true;
+				}
+				break;
+			case 0x65:
+				for (int index = 0; index <= x; index++) vRegisters[index][lane] = memory[(i + index) & addressMask];
+				break;
+			}
+			break;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <memory>
+#include <algorithm>
+#include "Machine.hpp"
+#include "RewindBuffer.hpp"
+
+namespace SHG
+{
+	// A full copy of the machine is kept once per second, so a long rewind never has to decode more than a second of frames
+	static const int REWIND_KEYFRAME_INTERVAL = CPU::FRAMES_PER_SECOND;
+
+	Machine::Machine() : cpu(&memory, &display, &keypad)
+	{
+	}
+
+	Machine::~Machine() = default;
+
+	bool Machine::LoadRom(std::string filePath)
+	{
+		return memory.LoadRom(filePath);
+	}
+
+	bool Machine::LoadRom(const uint8_t* rom, int size)
+	{
+		return memory.LoadRom(rom, size);
+	}
+
+	void Machine::StartCycle(Host* host, int instructionsPerSecond)
+	{
+		cpu.StartCycle(host, instructionsPerSecond);
+		RestoreRunAheadState();
+	}
+
+	void Machine::RunFrames(int instructionsPerSecond, int frameCount)
+	{
+		cpu.RunFrames(&headlessHost, instructionsPerSecond, frameCount);
+		RestoreRunAheadState();
+	}
+
+	uint64_t Machine::GetFramebufferHash()
+	{
+		return display.GetHash();
+	}
+
+	void Machine::SaveState(State* state)
+	{
+		// Zero the padding, so that two states of the same machine can be compared byte by byte
+		memset(state, 0, sizeof(State));
+
+		state->magic = STATE_MAGIC;
+		state->version = STATE_VERSION;
+		state->size = sizeof(State);
+		memcpy(state->memory, memory.GetData(), Memory::TOTAL_MEMORY);
+		display.GetScreen(&state->screen);
+		cpu.SaveState(&state->cpu);
+		state->keyStates = keypad.GetKeyStates();
+		state->releasedKeyStates = keypad.GetReleasedKeyStates();
+	}
+
+	bool Machine::LoadState(const State& state)
+	{
+		if (state.magic != STATE_MAGIC || state.version != STATE_VERSION || state.size != sizeof(State))
+		{
+			std::cout << "The save state is invalid or was made by a different version of the emulator." << std::endl;
+			return false;
+		}
+
+		memory.RestoreData(state.memory);
+		display.SetScreen(state.screen);
+		cpu.LoadState(state.cpu);
+		keypad.SetKeyStates(state.keyStates, state.releasedKeyStates);
+
+		return true;
+	}
+
+	bool Machine::SaveStateToFile(std::string filePath)
+	{
+		std::unique_ptr<State> state = std::make_unique<State>();
+		SaveState(state.get());
+
+		std::ofstream file(filePath, std::fstream::binary);
+		file.write((const char*)state.get(), sizeof(State));
+
+		if (!file)
+		{
+			std::cout << "Could not write save state: " << filePath << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Machine::LoadStateFromFile(std::string filePath)
+	{
+		std::ifstream file(filePath, std::fstream::binary);
+
+		if (!file.is_open())
+		{
+			std::cout << "Invalid save state file provided." << std::endl;
+			return false;
+		}
+
+		std::unique_ptr<State> state = std::make_unique<State>();
+		file.read((char*)state.get(), sizeof(State));
+
+		// The version is checked by LoadState, but a shorter file can't be a valid state of any version
+		if (file.gcount() != sizeof(State))
+		{
+			std::cout << "The save state is invalid or was made by a different version of the emulator." << std::endl;
+			return false;
+		}
+
+		return LoadState(*state);
+	}
+
+	void Machine::EnableRewind(Host* host, size_t capacity)
+	{
+		rewindBuffer = std::make_unique<RewindBuffer>(capacity, REWIND_KEYFRAME_INTERVAL);
+		rewindState = std::make_unique<State>();
+		rewindHost = host;
+
+		SetFrameHook();
+	}
+
+	void Machine::EnableRunAhead(int frameCount)
+	{
+		runAheadFrameCount = std::max(frameCount, 0);
+		if (runAheadState == nullptr) runAheadState = std::make_unique<State>();
+
+		SetFrameHook();
+	}
+
+	void Machine::SetFrameHook()
+	{
+		cpu.SetFrameHook([this]() { return UpdateFrame(); });
+	}
+
+	bool Machine::UpdateFrame()
+	{
+		// Go back to the real state before the real frame is run
+		RestoreRunAheadState();
+
+		if (rewindBuffer != nullptr && !UpdateRewind()) return false;
+		if (runAheadFrameCount == 0) return true;
+
+		RunAhead();
+		return false;
+	}
+
+	bool Machine::UpdateRewind()
+	{
+		if (!isRewound)
+		{
+			SaveState(rewindState.get());
+			rewindBuffer->Push(*rewindState);
+		}
+
+		isRewound = false;
+		if (!rewindHost->IsRewindRequested()) return true;
+
+		if (rewindBuffer->StepBack(rewindState.get()))
+		{
+			// The keys that are held right now matter, not the ones that were held at that point
+			uint16_t keyStates = keypad.GetKeyStates();
+			uint16_t releasedKeyStates = keypad.GetReleasedKeyStates();
+
+			LoadState(*rewindState);
+			keypad.SetKeyStates(keyStates, releasedKeyStates);
+		}
+
+		isRewound = true;
+		return false;
+	}
+
+	void Machine::RunAhead()
+	{
+		cpu.RunFrame(cpu.GetFrameInstructionCount());
+
+		SaveState(runAheadState.get());
+		isRunningAhead = true;
+
+		// The frames ahead are thrown away, so they aren't traced or profiled
+		Tracer* tracer = cpu.GetTracer();
+		Profiler* profiler = cpu.GetProfiler();
+		cpu.SetTracer(nullptr);
+		cpu.SetProfiler(nullptr);
+
+		// The frames ahead use the keys that are held now, and the screen is left as the last of them drew it
+		for (int frame = 0; frame < runAheadFrameCount; frame++) cpu.RunFrame(cpu.GetFrameInstructionCount());
+
+		cpu.SetTracer(tracer);
+		cpu.SetProfiler(profiler);
+	}
+
+	void Machine::RestoreRunAheadState()
+	{
+		if (!isRunningAhead) return;
+
+		// Keys that changed while running ahead are kept, and releases that were taken by FX0A are given back
+		uint16_t keyStates = keypad.GetKeyStates();
+		uint16_t releasedKeyStates = keypad.GetReleasedKeyStates() | runAheadState->releasedKeyStates;
+
+		LoadState(*runAheadState);
+		keypad.SetKeyStates(keyStates, releasedKeyStates);
+
+		isRunningAhead = false;
+	}
+
+	Memory& Machine::GetMemory()
+	{
+		return memory;
+	}
+
+	Display& Machine::GetDisplay()
+	{
+		return display;
+	}
+
+	Keypad& Machine::GetKeypad()
+	{
+		return keypad;
+	}
+
+	CPU& Machine::GetCPU()
+	{
+		return cpu;
+	}
+
+	HeadlessHost& Machine::GetHeadlessHost()
+	{
+		return headlessHost;
+	}
+}
\ No newline at end of file
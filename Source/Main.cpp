@@ -1,50 +1,481 @@
 #include <iostream>
+#include <fstream>
 #include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <random>
+#include <iomanip>
 #include <SDL.h>
-#include "Memory.hpp"
-#include "Display.hpp"
-#include "Keypad.hpp"
-#include "CPU.hpp"
+#include "Machine.hpp"
+#include "SDLHost.hpp"
+#include "HeadlessHost.hpp"
+#include "Benchmark.hpp"
+#include "BenchmarkSuite.hpp"
+#include "JitCompiler.hpp"
+#include "BatchRunner.hpp"
+#include "InputRecording.hpp"
+#include "RomLibrary.hpp"
+#include "Tracer.hpp"
+#include "Profiler.hpp"
 
 using namespace std::chrono;
 
 static const int SCREEN_WIDTH = 640;
 static const int SCREEN_HEIGHT = 320;
-static const int ROM_PATH_INDEX = 1;
-static const int INSTRUCTIONS_PER_SECOND_INDEX = 2;
+static const int ROM_PATH_INDEX = 0;
+static const int INSTRUCTIONS_PER_SECOND_INDEX = 1;
+static const int DEFAULT_HEADLESS_FRAME_COUNT = 3600;
+static const int DEFAULT_AUDIO_BUFFER_SIZE = 512;
+static const char* DEFAULT_BATCH_OUTPUT_PATH = "results.csv";
+static const char* DEFAULT_BENCHMARK_SUITE_OUTPUT_PATH = "benchmark.csv";
+
+static void RunHeadless(SHG::Machine& machine, int instructionsPerSecond, int frameCount)
+{
+	SHG::HeadlessHost& host = machine.GetHeadlessHost();
+
+	auto startTime = steady_clock::now();
+	machine.RunFrames(instructionsPerSecond, frameCount);
+	double elapsedSeconds = duration_cast<duration<double>>(steady_clock::now() - startTime).count();
+
+	uint64_t instructionCount = machine.GetCPU().GetInstructionCount();
+
+	std::cout << "Frames: " << host.GetPresentedFrameCount() << " (" << host.GetChangedFrameCount() << " changed)" << std::endl;
+	std::cout << "Instructions: " << instructionCount << std::endl;
+	std::cout << "Framebuffer hash: " << std::hex << std::setw(16) << std::setfill('0') << machine.GetFramebufferHash() << std::dec << std::endl;
+	std::cout << "Elapsed time: " << elapsedSeconds * 1000.0 << " ms" << std::endl;
+	if (elapsedSeconds > 0) std::cout << "Instructions per second (host): " << (uint64_t)(instructionCount / elapsedSeconds) << std::endl;
+}
+
+static void ListLibrary(std::string directory)
+{
+	SHG::RomLibrary library;
+	if (!library.Scan(directory)) return;
+
+	for (const SHG::RomLibrary::Entry& entry : library.GetEntries())
+	{
+		std::cout << entry.sha1 << "  " << std::setw(5) << entry.size << "  " << std::left << std::setw(7) << entry.platform << std::right 
+			<< "  " << entry.path << std::endl;
+	}
+
+	std::cout << library.GetEntries().size() << " ROMs (" << library.GetHashedCount() << " read, " 
+		<< library.GetCachedCount() << " from the index)" << std::endl;
+}
 
 int main(int argc, char* argv[])
 {
-	if (argc < 2)
+	std::vector<std::string> positionalArgs;
+	bool isHeadless = false;
+	bool isBenchmark = false;
+	bool isBenchmarkSuite = false;
+	bool isJitCheckEnabled = false;
+	bool isVsyncEnabled = false;
+	bool isLockstepEnabled = false;
+	bool isMuted = false;
+	bool isAudioClockEnabled = false;
+	int audioBufferSize = DEFAULT_AUDIO_BUFFER_SIZE;
+	std::string keyLayout = SHG::SDLHost::DEFAULT_KEY_LAYOUT;
+	SHG::CPU::DispatchMode dispatchMode = SHG::CPU::DispatchMode::BlockCache;
+	int frameCount = DEFAULT_HEADLESS_FRAME_COUNT;
+	uint64_t seed = 0;
+	bool isSeedSet = false;
+	std::string recordPath;
+	std::string replayPath;
+	std::string tracePath;
+	std::string decodeTracePath;
+	std::string profilePath;
+	std::string profileStacksPath;
+	int rewindMegabytes = 0;
+	int runAheadFrameCount = 0;
+	std::string loadStatePath;
+	std::string saveStatePath;
+	std::string batchManifestPath;
+	std::string libraryPath;
+	std::string outputPath;
+	std::string baselinePath;
+	std::string quirksName = "default";
+	int threadCount = (int)std::thread::hardware_concurrency();
+
+	for (int i = 1; i < argc; i++)
 	{
-		std::cout << "No ROM file provided. Shutting Down..." << std::endl;
+		std::string arg = argv[i];
+
+		if (arg == "--headless")
+		{
+			isHeadless = true;
+		}
+		else if (arg == "--benchmark")
+		{
+			isBenchmark = true;
+		}
+		else if (arg == "--benchmark-suite")
+		{
+			isBenchmarkSuite = true;
+		}
+		else if (arg == "--baseline" && i + 1 < argc)
+		{
+			baselinePath = argv[++i];
+		}
+		else if (arg == "--cpu=jit")
+		{
+			dispatchMode = SHG::CPU::DispatchMode::Jit;
+		}
+		else if (arg == "--cpu=interp")
+		{
+			dispatchMode = SHG::CPU::DispatchMode::BlockCache;
+		}
+		else if (arg == "--quirks" && i + 1 < argc)
+		{
+			quirksName = argv[++i];
+		}
+		else if (arg == "--jit-check")
+		{
+			isJitCheckEnabled = true;
+		}
+		else if (arg == "--vsync")
+		{
+			isVsyncEnabled = true;
+		}
+		else if (arg == "--mute")
+		{
+			isMuted = true;
+		}
+		else if (arg == "--audio-clock")
+		{
+			isAudioClockEnabled = true;
+		}
+		else if (arg == "--audio-buffer" && i + 1 < argc)
+		{
+			try
+			{
+				audioBufferSize = std::stoi(argv[++i]);
+			}
+			catch (std::exception const&)
+			{
+				std::cout << "Invalid value provided for '--audio-buffer'. Setting to default value." << std::endl;
+			}
+		}
+		else if (arg == "--keys" && i + 1 < argc)
+		{
+			keyLayout = argv[++i];
+		}
+		else if (arg == "--rewind" && i + 1 < argc)
+		{
+			try
+			{
+				rewindMegabytes = std::stoi(argv[++i]);
+			}
+			catch (std::exception const&)
+			{
+				std::cout << "Invalid value provided for '--rewind'. Rewinding is disabled." << std::endl;
+			}
+		}
+		else if (arg == "--run-ahead" && i + 1 < argc)
+		{
+			try
+			{
+				runAheadFrameCount = std::stoi(argv[++i]);
+			}
+			catch (std::exception const&)
+			{
+				std::cout << "Invalid value provided for '--run-ahead'. Run-ahead is disabled." << std::endl;
+			}
+		}
+		else if (arg == "--seed" && i + 1 < argc)
+		{
+			try
+			{
+				seed = std::stoull(argv[++i]);
+				isSeedSet = true;
+			}
+			catch (std::exception const&)
+			{
+				std::cout << "Invalid value provided for '--seed'. Using a random seed instead." << std::endl;
+			}
+		}
+		else if (arg == "--record" && i + 1 < argc)
+		{
+			recordPath = argv[++i];
+		}
+		else if (arg == "--replay" && i + 1 < argc)
+		{
+			replayPath = argv[++i];
+		}
+		else if (arg == "--trace" && i + 1 < argc)
+		{
+			tracePath = argv[++i];
+		}
+		else if (arg == "--decode-trace" && i + 1 < argc)
+		{
+			decodeTracePath = argv[++i];
+		}
+		else if (arg == "--profile" && i + 1 < argc)
+		{
+			profilePath = argv[++i];
+		}
+		else if (arg == "--profile-stacks" && i + 1 < argc)
+		{
+			profileStacksPath = argv[++i];
+		}
+		else if (arg == "--load-state" && i + 1 < argc)
+		{
+			loadStatePath = argv[++i];
+		}
+		else if (arg == "--save-state" && i + 1 < argc)
+		{
+			saveStatePath = argv[++i];
+		}
+		else if (arg == "--batch" && i + 1 < argc)
+		{
+			batchManifestPath = argv[++i];
+		}
+		else if (arg == "--library" && i + 1 < argc)
+		{
+			libraryPath = argv[++i];
+		}
+		else if (arg == "--lockstep")
+		{
+			isLockstepEnabled = true;
+		}
+		else if (arg == "--output" && i + 1 < argc)
+		{
+			outputPath = argv[++i];
+		}
+		else if (arg == "--threads" && i + 1 < argc)
+		{
+			try
+			{
+				threadCount = std::stoi(argv[++i]);
+			}
+			catch (std::exception const&)
+			{
+				std::cout << "Invalid value provided for '--threads'. Using every core instead." << std::endl;
+			}
+		}
+		else if (arg == "--frames" && i + 1 < argc)
+		{
+			try
+			{
+				frameCount = std::stoi(argv[++i]);
+			}
+			catch (std::exception const&)
+			{
+				std::cout << "Invalid value provided for '--frames'. Setting to default value." << std::endl;
+			}
+		}
+		else
+		{
+			positionalArgs.push_back(arg);
+		}
+	}
+
+	if (isBenchmark)
+	{
+		SHG::Benchmark::Run(positionalArgs.size() > ROM_PATH_INDEX ? positionalArgs[ROM_PATH_INDEX] : "");
 		return 0;
 	}
 
-	SHG::Memory memory = SHG::Memory();
-	if (!memory.LoadRom(argv[ROM_PATH_INDEX])) return 0;
+	if (isBenchmarkSuite)
+	{
+		SHG::BenchmarkSuite::Run(outputPath.empty() ? DEFAULT_BENCHMARK_SUITE_OUTPUT_PATH : outputPath, baselinePath);
+		return 0;
+	}
+
+	if (!libraryPath.empty())
+	{
+		ListLibrary(libraryPath);
+		return 0;
+	}
+
+	if (!decodeTracePath.empty())
+	{
+		// The text goes to the console, unless an output file is given
+		if (positionalArgs.empty())
+		{
+			SHG::Tracer::Decode(decodeTracePath, std::cout);
+			return 0;
+		}
+
+		std::ofstream output(positionalArgs[0]);
+		if (SHG::Tracer::Decode(decodeTracePath, output) && !output) std::cout << "Could not write decoded trace: " << positionalArgs[0] << std::endl;
+		return 0;
+	}
+
+	if (!batchManifestPath.empty())
+	{
+		SHG::BatchRunner::Run(batchManifestPath, outputPath.empty() ? DEFAULT_BATCH_OUTPUT_PATH : outputPath, threadCount, dispatchMode, isLockstepEnabled);
+		return 0;
+	}
+
+	if (positionalArgs.size() <= ROM_PATH_INDEX)
+	{
+		std::cout << "No ROM file provided. Shutting Down..." << std::endl;
+		return 0;
+	}
 
-	SHG::Display display = SHG::Display(SCREEN_WIDTH, SCREEN_HEIGHT);
-	SHG::Keypad keypad = SHG::Keypad();
+	SHG::Machine machine;
+	if (!machine.LoadRom(positionalArgs[ROM_PATH_INDEX])) return 0;
 
 	int instructionsPerSecond = 60;
 
-	if (argc > 2)
+	if (positionalArgs.size() > INSTRUCTIONS_PER_SECOND_INDEX)
 	{
 		try
 		{
-			instructionsPerSecond = std::stoi(argv[INSTRUCTIONS_PER_SECOND_INDEX]);
+			instructionsPerSecond = std::stoi(positionalArgs[INSTRUCTIONS_PER_SECOND_INDEX]);
 		}
-		catch (std::exception const e)
+		catch (std::exception const&)
 		{
 			std::cout << "Invalid value provided for 'instructionsPerSecond'. Setting to default value." << std::endl;
 		}
 	}
 
+	// A replay repeats the recorded run exactly, so it uses the recorded settings, and runs headless since it doesn't need input
+	SHG::InputRecording replay;
+
+	if (!replayPath.empty())
+	{
+		if (!replay.LoadFromFile(replayPath)) return 0;
+
+		seed = replay.GetSeed();
+		isSeedSet = true;
+		instructionsPerSecond = replay.GetInstructionsPerSecond();
+		frameCount = replay.GetFrameCount();
+		quirksName = SHG::GetQuirkProfileName(replay.GetQuirkProfile());
+		isHeadless = true;
+	}
+
+	SHG::QuirkProfile quirkProfile = SHG::QuirkProfile::Default;
+
+	if (quirksName == "auto")
+	{
+		// The profile is picked from the platform that the ROM appears to be written for
+		std::vector<uint8_t> rom;
+		std::string platform = "chip-8";
+		if (SHG::RomLibrary::ReadRom(positionalArgs[ROM_PATH_INDEX], &rom)) platform = SHG::RomLibrary::DetectPlatform(rom.data(), rom.size(), positionalArgs[ROM_PATH_INDEX]);
+
+		if (platform == "schip") quirkProfile = SHG::QuirkProfile::Schip;
+		else if (platform == "xo-chip") quirkProfile = SHG::QuirkProfile::XoChip;
+	}
+	else if (!SHG::ParseQuirkProfile(quirksName, &quirkProfile))
+	{
+		std::cout << "Invalid value provided for '--quirks'. Using the default profile instead." << std::endl;
+	}
+
+	if (!isSeedSet) seed = ((uint64_t)std::random_device()() << 32) | std::random_device()();
+
+	// A recording always starts from a freshly loaded ROM, since replays don't restore a save state
+	if (!recordPath.empty() && !loadStatePath.empty())
+	{
+		std::cout << "Input can't be recorded after loading a save state." << std::endl;
+		return 0;
+	}
+
+	// Frames that are run ahead or rewound aren't part of the real timeline, so they can't be recorded
+	if (!recordPath.empty() && (runAheadFrameCount > 0 || rewindMegabytes > 0))
+	{
+		std::cout << "Run-ahead and rewind are disabled while recording input." << std::endl;
+		runAheadFrameCount = 0;
+		rewindMegabytes = 0;
+	}
+
 	std::cout << "Instructions per second: " << instructionsPerSecond << std::endl;
+	std::cout << "Random seed: " << seed << std::endl;
+	std::cout << "Quirks: " << SHG::GetQuirkProfileName(quirkProfile) << std::endl;
+
+	if (dispatchMode == SHG::CPU::DispatchMode::Jit && !SHG::JitCompiler::IsSupported())
+	{
+		std::cout << "The JIT isn't supported on this platform. Using the interpreter instead." << std::endl;
+		dispatchMode = SHG::CPU::DispatchMode::BlockCache;
+	}
+
+	SHG::CPU& cpu = machine.GetCPU();
+	cpu.SetQuirkProfile(quirkProfile);
+	cpu.SetDispatchMode(dispatchMode);
+	cpu.SetJitCheckEnabled(isJitCheckEnabled);
+	cpu.SetRandomSeed(seed);
+
+	// A save state contains the state of the random number generator, which replaces the seed
+	if (!loadStatePath.empty() && !machine.LoadStateFromFile(loadStatePath)) return 0;
+	if (runAheadFrameCount > 0) machine.EnableRunAhead(runAheadFrameCount);
+	if (!replayPath.empty()) cpu.SetInputReplay(&replay);
+
+	SHG::InputRecording recording;
+	recording.SetSeed(seed);
+	recording.SetInstructionsPerSecond(instructionsPerSecond);
+	recording.SetQuirkProfile(quirkProfile);
+	uint64_t startFrameCount = cpu.GetFrameCount();
+	if (!recordPath.empty()) cpu.SetInputRecording(&recording);
+
+	SHG::Tracer tracer;
+
+	if (!tracePath.empty())
+	{
+		if (!SHG_TRACE_ENABLED) std::cout << "Tracing isn't included in this build." << std::endl;
+		else if (tracer.Open(tracePath)) cpu.SetTracer(&tracer);
+	}
+
+	SHG::Profiler profiler;
+	bool isProfiling = !profilePath.empty() || !profileStacksPath.empty();
+	if (isProfiling) cpu.SetProfiler(&profiler);
+
+	if (isHeadless)
+	{
+		RunHeadless(machine, instructionsPerSecond, frameCount);
+	}
+	else
+	{
+		SHG::SDLHost host(SCREEN_WIDTH, SCREEN_HEIGHT, isVsyncEnabled);
+		if (!host.SetKeyLayout(keyLayout)) std::cout << "Using the default key layout instead." << std::endl;
+		if (rewindMegabytes > 0) machine.EnableRewind(&host, (size_t)rewindMegabytes * 1024 * 1024);
+
+		bool isAudioOpen = !isMuted && host.OpenAudio(audioBufferSize, isAudioClockEnabled);
+
+		machine.StartCycle(&host, instructionsPerSecond);
+
+		std::cout << "Dropped frames: " << cpu.GetDroppedFrameCount() << std::endl;
+		std::cout << "Duplicated frames: " << cpu.GetDuplicatedFrameCount() << std::endl;
 
-	SHG::CPU cpu = SHG::CPU(&memory, &display, &keypad);
-	cpu.StartCycle(instructionsPerSecond);
+		if (isAudioOpen)
+		{
+			std::cout << "Audio underruns: " << host.GetAudioUnderrunCount() << std::endl;
+			std::cout << "Dropped audio frames: " << host.GetDroppedAudioFrameCount() << std::endl;
+		}
+
+		if (cpu.GetInputLatencySampleCount() > 0)
+		{
+			std::cout << "Input latency: " << cpu.GetAverageInputLatency() << " frames on average from a key event to the next change on screen (" 
+				<< cpu.GetInputLatencySampleCount() << " key events)" << std::endl;
+		}
+	}
+
+	if (!saveStatePath.empty()) machine.SaveStateToFile(saveStatePath);
+
+	if (isProfiling)
+	{
+		cpu.SetProfiler(nullptr);
+		if (!profilePath.empty() && profiler.SaveJson(profilePath)) std::cout << "Profile written to: " << profilePath << std::endl;
+		if (!profileStacksPath.empty() && profiler.SaveFoldedStacks(profileStacksPath)) std::cout << "Call stacks written to: " << profileStacksPath << std::endl;
+	}
+
+	if (tracer.GetRecordCount() > 0)
+	{
+		tracer.Close();
+		std::cout << "Traced " << tracer.GetRecordCount() << " instructions to: " << tracePath 
+			<< " (waited for the writer " << tracer.GetStallCount() << " times)" << std::endl;
+	}
+
+	if (!recordPath.empty())
+	{
+		recording.SetFrameCount((int)(cpu.GetFrameCount() - startFrameCount));
+		if (recording.SaveToFile(recordPath)) std::cout << "Input recorded to: " << recordPath << std::endl;
+	}
+
+	if (isJitCheckEnabled)
+	{
+		std::cout << "JIT check: " << cpu.GetJitCheckedBlockCount() << " blocks compared, " 
+			<< cpu.GetJitMismatchCount() << " mismatches" << std::endl;
+	}
 
 	return 0;
 }
\ No newline at end of file
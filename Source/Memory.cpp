@@ -1,6 +1,9 @@
 #include <fstream>
 #include <iostream>
+#include <algorithm>
+#include <cstring>
 #include "Memory.hpp"
+#include "Profiler.hpp"
 
 namespace SHG
 {
@@ -56,6 +59,27 @@ namespace SHG
 		0xF0, 0x80, 0xF0, 0x80, 0x80
 	};
 
+	// Contains 16 10-byte font sprites, one per row
+	static const uint8_t BIG_FONT_SPRITES[] =
+	{
+		0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+		0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+		0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+		0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+		0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+		0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+		0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+		0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+		0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+		0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+		0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+	};
+
 	Memory::Memory()
 	{
 		// Load font sprites into memory
@@ -63,6 +87,8 @@ namespace SHG
 		{
 			data[i] = FONT_SPRITES[i];
 		}
+
+		std::copy(BIG_FONT_SPRITES, BIG_FONT_SPRITES + sizeof(BIG_FONT_SPRITES), data + BIG_FONT_ADDRESS);
 	}
 
 	const uint8_t* Memory::GetData()
@@ -70,56 +96,114 @@ namespace SHG
 		return data;
 	}
 
+	void Memory::SetData(const uint8_t* source)
+	{
+		// Cached code isn't notified, so the caller is responsible for making sure it's still valid
+		std::copy(source, source + TOTAL_MEMORY, data);
+	}
+
+	void Memory::RestoreData(const uint8_t* source)
+	{
+		// Restoring a state that was saved recently usually changes only a few bytes, if any
+		if (memcmp(data, source, TOTAL_MEMORY) == 0) return;
+
+		if (codeWriteListener != nullptr)
+		{
+			for (int address = 0; address < TOTAL_MEMORY; address++)
+			{
+				if (codeReferenceCounts[address] != 0 && data[address] != source[address]) codeWriteListener->OnCodeWrite(address);
+			}
+		}
+
+		memcpy(data, source, TOTAL_MEMORY);
+	}
+
 	void Memory::SetByte(int address, uint8_t byte)
 	{
+		// Addresses past the end of memory wrap around to the beginning
+		address &= TOTAL_MEMORY - 1;
+
 		data[address] = byte;
+
+		if (codeReferenceCounts[address] != 0) codeWriteListener->OnCodeWrite(address);
+		if (profiler != nullptr) profiler->AddMemoryWrites(1);
 	}
 
 	uint8_t Memory::GetByte(int address)
 	{
-		return data[address];
+		return data[address & (TOTAL_MEMORY - 1)];
+	}
+
+	void Memory::SetProfiler(Profiler* profiler)
+	{
+		this->profiler = profiler;
+	}
+
+	void Memory::SetCodeWriteListener(CodeWriteListener* listener)
+	{
+		codeWriteListener = listener;
+	}
+
+	void Memory::AddCodeReference(int address, int size)
+	{
+		for (int i = 0; i < size; i++) codeReferenceCounts[(address + i) & (TOTAL_MEMORY - 1)]++;
+	}
+
+	void Memory::RemoveCodeReference(int address, int size)
+	{
+		for (int i = 0; i < size; i++) codeReferenceCounts[(address + i) & (TOTAL_MEMORY - 1)]--;
 	}
 
 	bool Memory::LoadRom(std::string filePath)
 	{
 		std::cout << "Loading ROM: " << filePath << std::endl;
 
-		std::ifstream file(filePath, std::fstream::binary);
+		// The file is read in a single call, straight into memory, so the stream doesn't need a buffer of its own
+		std::ifstream file;
+		file.rdbuf()->pubsetbuf(nullptr, 0);
+		file.open(filePath, std::fstream::binary | std::fstream::ate);
 
 		if (!file.is_open())
 		{
-			std::cout << "Invalid ROM file provided.";
+			std::cout << "Invalid ROM file provided." << std::endl;
 			return false;
 		}
 
-		char buf[1];
-
-		int counter = 0;
-		int fileSize = 0;
+		std::streamoff fileSize = file.tellg();
 
-		while (!file.eof())
+		if (fileSize > MAX_ROM_SIZE)
 		{
-			// Read one byte from the ROM file
-			file.read(buf, 1);
-			
-			fileSize += file.gcount();
+			std::cout << "The ROM is too large to be loaded into memory." << std::endl;
+			return false;
+		}
 
-			if (fileSize > MAX_ROM_SIZE)
-			{
-				std::cout << "The ROM is too large to be loaded into memory." << std::endl;
-				return false;
-			}
+		// Any memory locations after data[RESERVED_MEMORY_SIZE - 1] 
+		// can be used for storing the ROM
+		file.seekg(0);
+		file.read((char*)data + RESERVED_MEMORY_SIZE, fileSize);
 
-			// Any memory locations after data[RESERVED_MEMORY_SIZE - 1] 
-			// can be used for storing the ROM
-			data[RESERVED_MEMORY_SIZE + counter] = buf[0];
+		if (file.gcount() != fileSize)
+		{
+			std::cout << "Could not read ROM file: " << filePath << std::endl;
+			return false;
+		}
 
-			counter++;
+		std::cout << "ROM size: " << fileSize << " bytes" << std::endl;
+		return true;
+	}
+
+	bool Memory::LoadRom(const uint8_t* rom, int size)
+	{
+		if (size > MAX_ROM_SIZE)
+		{
+			std::cout << "The ROM is too large to be loaded into memory." << std::endl;
+			return false;
 		}
 
-		file.close();
+		// Any memory locations after data[RESERVED_MEMORY_SIZE - 1] 
+		// can be used for storing the ROM
+		std::copy(rom, rom + size, data + RESERVED_MEMORY_SIZE);
 
-		std::cout << "ROM size: " << fileSize << " bytes" << std::endl;
 		return true;
 	}
 }
\ No newline at end of file
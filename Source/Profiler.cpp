@@ -0,0 +1,195 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include "Profiler.hpp"
+
+using namespace std::chrono;
+
+namespace SHG
+{
+	// In the order of Profiler::Family
+	static const char* FAMILY_NAMES[] =
+	{
+		"unknown", "0NNN", "00E0", "00EE", "1NNN", "2NNN", "3XKK", "4XKK", "5XY0", "6XKK", "7XKK",
+		"8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE", "9XY0", "ANNN", "BNNN", "CXKK", "DXYN",
+		"EX9E", "EXA1", "FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX33", "FX55", "FX65",
+		"00CN", "00DN", "00FB", "00FC", "00FD", "00FE", "00FF", "5XY2", "5XY3", "F000", "FN01", "FX30", "FX75", "FX85",
+		"F002", "FX3A"
+	};
+
+	static_assert(sizeof(FAMILY_NAMES) / sizeof(FAMILY_NAMES[0]) == Profiler::FAMILY_COUNT, "Every family needs a name");
+
+	// How many times the clock is read to measure how long reading it takes
+	static const int CLOCK_CALIBRATION_COUNT = 1000;
+
+	Profiler::Profiler() : addressCounts(Memory::TOTAL_MEMORY)
+	{
+		uint64_t minOverhead = UINT64_MAX;
+
+		for (int i = 0; i < CLOCK_CALIBRATION_COUNT; i++)
+		{
+			auto startTime = steady_clock::now();
+			uint64_t overhead = (uint64_t)duration_cast<nanoseconds>(steady_clock::now() - startTime).count();
+			minOverhead = std::min(minOverhead, overhead);
+		}
+
+		clockOverhead = minOverhead;
+
+		// Instructions executed before the first call are counted in the outermost function
+		SetCallStack(nullptr, 0);
+	}
+
+	const char* Profiler::GetFamilyName(int family)
+	{
+		return family >= 0 && family < FAMILY_COUNT ? FAMILY_NAMES[family] : FAMILY_NAMES[0];
+	}
+
+	void Profiler::AddInstruction(uint16_t address, int family, uint64_t nanoseconds)
+	{
+		instructionCount++;
+		familyCounts[family]++;
+		familyNanoseconds[family] += nanoseconds > clockOverhead ? nanoseconds - clockOverhead : 0;
+		addressCounts[address & (Memory::TOTAL_MEMORY - 1)]++;
+		stackCounts[currentStack]++;
+	}
+
+	void Profiler::AddPixels(uint64_t count)
+	{
+		pixelCount += count;
+	}
+
+	void Profiler::AddMemoryWrites(uint64_t count)
+	{
+		memoryWriteCount += count;
+	}
+
+	void Profiler::SetCallStack(const uint16_t* functions, int depth)
+	{
+		std::string stack = "main";
+
+		for (int i = 0; i < depth; i++)
+		{
+			char name[16];
+			snprintf(name, sizeof(name), ";sub_%03X", functions[i]);
+			stack += name;
+		}
+
+		auto iterator = stackIndices.find(stack);
+
+		if (iterator != stackIndices.end())
+		{
+			currentStack = iterator->second;
+			return;
+		}
+
+		currentStack = stacks.size();
+		stackIndices[stack] = currentStack;
+		stacks.push_back(stack);
+		stackCounts.push_back(0);
+	}
+
+	uint64_t Profiler::GetInstructionCount()
+	{
+		return instructionCount;
+	}
+
+	uint64_t Profiler::GetFamilyCount(int family)
+	{
+		return familyCounts[family];
+	}
+
+	uint64_t Profiler::GetFamilyNanoseconds(int family)
+	{
+		return familyNanoseconds[family];
+	}
+
+	uint64_t Profiler::GetAddressCount(uint16_t address)
+	{
+		return addressCounts[address & (Memory::TOTAL_MEMORY - 1)];
+	}
+
+	uint64_t Profiler::GetPixelCount()
+	{
+		return pixelCount;
+	}
+
+	uint64_t Profiler::GetMemoryWriteCount()
+	{
+		return memoryWriteCount;
+	}
+
+	bool Profiler::SaveJson(std::string filePath)
+	{
+		std::ofstream file(filePath);
+
+		file << "{\n";
+		file << "  \"instructions\": " << instructionCount << ",\n";
+		file << "  \"pixels_drawn\": " << pixelCount << ",\n";
+		file << "  \"memory_writes\": " << memoryWriteCount << ",\n";
+
+		// The most frequently executed families come first
+		std::vector<int> families;
+		for (int family = 0; family < FAMILY_COUNT; family++)
+		{
+			if (familyCounts[family] != 0) families.push_back(family);
+		}
+
+		std::stable_sort(families.begin(), families.end(), [this](int a, int b) { return familyCounts[a] > familyCounts[b]; });
+
+		file << "  \"opcodes\": [";
+
+		for (size_t i = 0; i < families.size(); i++)
+		{
+			int family = families[i];
+
+			file << (i == 0 ? "\n" : ",\n") << "    { \"opcode\": \"" << FAMILY_NAMES[family] << "\", \"count\": " << familyCounts[family] 
+				<< ", \"total_ns\": " << familyNanoseconds[family] 
+				<< ", \"ns_per_instruction\": " << (double)familyNanoseconds[family] / familyCounts[family] << " }";
+		}
+
+		file << (families.empty() ? "],\n" : "\n  ],\n");
+
+		// Addresses are in order, so they can be shown as a heatmap of memory
+		file << "  \"addresses\": [";
+		bool isFirstAddress = true;
+
+		for (int address = 0; address < Memory::TOTAL_MEMORY; address++)
+		{
+			if (addressCounts[address] == 0) continue;
+
+			file << (isFirstAddress ? "\n" : ",\n") << "    { \"address\": " << address << ", \"count\": " << addressCounts[address] << " }";
+			isFirstAddress = false;
+		}
+
+		file << (isFirstAddress ? "]\n" : "\n  ]\n");
+		file << "}\n";
+
+		if (!file)
+		{
+			std::cout << "Could not write profile: " << filePath << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool Profiler::SaveFoldedStacks(std::string filePath)
+	{
+		std::ofstream file(filePath);
+
+		for (size_t i = 0; i < stacks.size(); i++)
+		{
+			if (stackCounts[i] != 0) file << stacks[i] << " " << stackCounts[i] << "\n";
+		}
+
+		if (!file)
+		{
+			std::cout << "Could not write call stacks: " << filePath << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <cstring>
+#include "RewindBuffer.hpp"
+
+namespace SHG
+{
+	static void WriteLength(size_t length, std::vector<uint8_t>* output)
+	{
+		// 7 bits per byte, with the top bit set on every byte except the last
+		while (length >= 0x80)
+		{
+			output->push_back((uint8_t)(length | 0x80));
+			length >>= 7;
+		}
+
+		output->push_back((uint8_t)length);
+	}
+
+	static size_t ReadLength(const uint8_t* data, size_t* position)
+	{
+		size_t length = 0;
+
+		for (int shift = 0; ; shift += 7)
+		{
+			uint8_t byte = data[(*position)++];
+			length |= (size_t)(byte & 0x7F) << shift;
+
+			if ((byte & 0x80) == 0) return length;
+		}
+	}
+
+	RewindBuffer::RewindBuffer(size_t capacity, int keyframeInterval)
+	{
+		this->keyframeInterval = std::max(keyframeInterval, 1);
+
+		// Room for at least a few frames, even if every byte changes
+		storage.resize(std::max(capacity, sizeof(Machine::State) * 8));
+		encodeBuffer.reserve(sizeof(Machine::State) * 4);
+	}
+
+	void RewindBuffer::Push(const Machine::State& state)
+	{
+		if (!hasNewestState)
+		{
+			newestState = state;
+			hasNewestState = true;
+			return;
+		}
+
+		// The previous newest state becomes an older frame, which is encoded relative to the new state
+		encodeBuffer.clear();
+		EncodeDelta((const uint8_t*)&newestState, (const uint8_t*)&state, &encodeBuffer);
+		size_t deltaSize = encodeBuffer.size();
+
+		if (++framesSinceKeyframe >= keyframeInterval)
+		{
+			EncodeDelta((const uint8_t*)&zeroState, (const uint8_t*)&newestState, &encodeBuffer);
+			framesSinceKeyframe = 0;
+		}
+
+		Entry entry;
+		entry.offset = Allocate(encodeBuffer.size());
+		entry.deltaSize = (uint32_t)deltaSize;
+		entry.keyframeSize = (uint32_t)(encodeBuffer.size() - deltaSize);
+
+		std::copy(encodeBuffer.begin(), encodeBuffer.end(), storage.begin() + entry.offset);
+		entries.push_back(entry);
+		usedBytes += encodeBuffer.size();
+
+		newestState = state;
+	}
+
+	bool RewindBuffer::StepBack(Machine::State* state)
+	{
+		return Rewind(1, state);
+	}
+
+	bool RewindBuffer::Rewind(int frameCount, Machine::State* state)
+	{
+		if (entries.empty() || frameCount <= 0) return false;
+
+		int targetIndex = (int)entries.size() - std::min(frameCount, (int)entries.size());
+		int startIndex = (int)entries.size();
+
+		// Start from the oldest keyframe at or after the target, if there is one, instead of the newest state
+		for (int i = targetIndex; i < (int)entries.size(); i++)
+		{
+			const Entry& entry = entries[i];
+			if (entry.keyframeSize == 0) continue;
+
+			newestState = zeroState;
+			ApplyDelta(storage.data() + entry.offset + entry.deltaSize, entry.keyframeSize, (uint8_t*)&newestState);
+			startIndex = i;
+			break;
+		}
+
+		for (int i = startIndex - 1; i >= targetIndex; i--)
+		{
+			const Entry& entry = entries[i];
+			ApplyDelta(storage.data() + entry.offset, entry.deltaSize, (uint8_t*)&newestState);
+		}
+
+		while ((int)entries.size() > targetIndex) RemoveNewestEntry();
+
+		// The next keyframe is due keyframeInterval frames after the newest one that is left
+		framesSinceKeyframe = (int)entries.size();
+
+		for (int i = (int)entries.size() - 1; i >= 0; i--)
+		{
+			if (entries[i].keyframeSize == 0) continue;
+
+			framesSinceKeyframe = (int)entries.size() - 1 - i;
+			break;
+		}
+
+		*state = newestState;
+		return true;
+	}
+
+	void RewindBuffer::Clear()
+	{
+		entries.clear();
+		usedBytes = 0;
+		hasNewestState = false;
+		framesSinceKeyframe = 0;
+	}
+
+	int RewindBuffer::GetFrameCount()
+	{
+		return (int)entries.size();
+	}
+
+	size_t RewindBuffer::GetUsedBytes()
+	{
+		return usedBytes;
+	}
+
+	void RewindBuffer::EncodeDelta(const uint8_t* first, const uint8_t* second, std::vector<uint8_t>* output)
+	{
+		const size_t size = sizeof(Machine::State);
+		size_t position = 0;
+
+		while (position < size)
+		{
+			size_t zeroStart = position;
+
+			// Most of the state doesn't change from one frame to the next, so equal bytes are skipped 8 at a time
+			while (position + 8 <= size && memcmp(first + position, second + position, 8) == 0) position += 8;
+			while (position < size && first[position] == second[position]) position++;
+
+			if (position == size) break;
+
+			size_t literalStart = position;
+			size_t zeroRunLength = 0;
+
+			while (position < size && zeroRunLength < MIN_ZERO_RUN_LENGTH)
+			{
+				zeroRunLength = first[position] == second[position] ? zeroRunLength + 1 : 0;
+				position++;
+			}
+
+			// The zeros that ended the literal run belong to the next zero run
+			if (zeroRunLength == MIN_ZERO_RUN_LENGTH) position -= zeroRunLength;
+
+			WriteLength(literalStart - zeroStart, output);
+			WriteLength(position - literalStart, output);
+
+			for (size_t i = literalStart; i < position; i++) output->push_back(first[i] ^ second[i]);
+		}
+	}
+
+	void RewindBuffer::ApplyDelta(const uint8_t* delta, size_t deltaSize, uint8_t* state)
+	{
+		size_t deltaPosition = 0;
+		size_t statePosition = 0;
+
+		while (deltaPosition < deltaSize)
+		{
+			statePosition += ReadLength(delta, &deltaPosition);
+			size_t literalLength = ReadLength(delta, &deltaPosition);
+
+			for (size_t i = 0; i < literalLength; i++) state[statePosition++] ^= delta[deltaPosition++];
+		}
+	}
+
+	size_t RewindBuffer::Allocate(size_t size)
+	{
+		// Frames are stored in order, so the free space is between the end of the newest frame and the start of the oldest
+		while (!entries.empty())
+		{
+			const Entry& oldest = entries.front();
+			const Entry& newest = entries.back();
+			size_t end = newest.offset + newest.deltaSize + newest.keyframeSize;
+
+			if (newest.offset >= oldest.offset)
+			{
+				if (storage.size() - end >= size) return end;
+				if (oldest.offset >= size) return 0;
+			}
+			else if (oldest.offset - end >= size)
+			{
+				return end;
+			}
+
+			RemoveOldestEntry();
+		}
+
+		return 0;
+	}
+
+	void RewindBuffer::RemoveOldestEntry()
+	{
+		usedBytes -= entries.front().deltaSize + entries.front().keyframeSize;
+		entries.pop_front();
+	}
+
+	void RewindBuffer::RemoveNewestEntry()
+	{
+		usedBytes -= entries.back().deltaSize + entries.back().keyframeSize;
+		entries.pop_back();
+	}
+}
\ No newline at end of file
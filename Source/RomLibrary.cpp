@@ -0,0 +1,317 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include "RomLibrary.hpp"
+#include "Memory.hpp"
+#include "Sha1.hpp"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace SHG
+{
+	static const char* CACHE_FILE_NAME = ".chip8-library";
+	static const char* FORMAT_NAME = "chip8-library";
+
+	static const char* ROM_EXTENSIONS[] = { ".ch8", ".c8", ".sc8", ".xo8" };
+
+	bool RomLibrary::ReadRom(std::string filePath, std::vector<uint8_t>* rom)
+	{
+		std::ifstream file;
+		file.rdbuf()->pubsetbuf(nullptr, 0);
+		file.open(filePath, std::fstream::binary | std::fstream::ate);
+
+		if (!file.is_open()) return false;
+
+		std::streamoff fileSize = file.tellg();
+		if (fileSize < 0 || fileSize > MAX_FILE_SIZE) return false;
+
+		rom->resize((size_t)fileSize);
+		file.seekg(0);
+		file.read((char*)rom->data(), fileSize);
+
+		return file.gcount() == fileSize;
+	}
+
+	std::string RomLibrary::DetectPlatform(const uint8_t* rom, size_t size, std::string filePath)
+	{
+		std::string extension = filePath.substr(std::min(filePath.size(), filePath.find_last_of('.')));
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower(c); });
+
+		if (extension == ".xo8" || size > (size_t)Memory::MAX_CHIP8_ROM_SIZE) return "xo-chip";
+		if (extension == ".sc8") return "schip";
+
+		// Sprites and other data often look like instructions, so only the instructions that can be reached from the 
+		// start of the program are checked. Every branch of a skip is followed, but jumps through V0 aren't.
+		std::vector<bool> isVisited(size);
+		std::vector<int> addresses = { Memory::RESERVED_MEMORY_SIZE };
+		bool isSchip = false;
+
+		while (!addresses.empty())
+		{
+			int address = addresses.back();
+			addresses.pop_back();
+
+			size_t offset = (size_t)(address - Memory::RESERVED_MEMORY_SIZE);
+			if (address < Memory::RESERVED_MEMORY_SIZE || offset + 1 >= size || isVisited[offset]) continue;
+			isVisited[offset] = true;
+
+			uint16_t instruction = (rom[offset] << 8) | rom[offset + 1];
+			uint16_t nnn = instruction & 0x0FFF;
+			uint8_t kk = instruction & 0x00FF;
+
+			switch (instruction & 0xF000)
+			{
+			case 0x0000:
+				if ((instruction & 0xFFF0) == 0x00D0 && instruction != 0x00D0) return "xo-chip";
+				if (((instruction & 0xFFF0) == 0x00C0 && instruction != 0x00C0) || (instruction >= 0x00FB && instruction <= 0x00FF)) isSchip = true;
+
+				// RET, and EXIT on SCHIP
+				if (instruction == 0x00EE || instruction == 0x00FD) continue;
+				break;
+			case 0x1000:
+				addresses.push_back(nnn);
+				continue;
+			case 0x2000:
+				addresses.push_back(nnn);
+				break;
+			case 0x3000:
+			case 0x4000:
+			case 0x9000:
+			case 0xE000:
+				addresses.push_back(address + 4);
+				break;
+			case 0x5000:
+				if ((instruction & 0x000F) == 0x2 || (instruction & 0x000F) == 0x3) return "xo-chip";
+				addresses.push_back(address + 4);
+				break;
+			case 0xB000:
+				continue;
+			case 0xD000:
+				if ((instruction & 0x000F) == 0) isSchip = true;
+				break;
+			case 0xF000:
+				if (instruction == 0xF000 || instruction == 0xF002 || kk == 0x3A || (kk == 0x01 && (instruction & 0x0F00) != 0)) return "xo-chip";
+				if (kk == 0x30 || kk == 0x75 || kk == 0x85) isSchip = true;
+				break;
+			}
+
+			addresses.push_back(address + 2);
+		}
+
+		return isSchip ? "schip" : "chip-8";
+	}
+
+	bool RomLibrary::Scan(std::string directory)
+	{
+		std::vector<Entry> files;
+
+		if (!ListFiles(directory, "", &files))
+		{
+			std::cout << "Couldn't read the ROM directory: " << directory << std::endl;
+			return false;
+		}
+
+		// Files that haven't changed since the last scan are taken from the cache, which may not exist yet
+		std::string cachePath = directory + "/" + CACHE_FILE_NAME;
+		RomLibrary cache;
+		std::ifstream cacheFile(cachePath);
+		if (cacheFile.is_open()) cache.LoadFromFile(cachePath);
+
+		std::sort(cache.entries.begin(), cache.entries.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+		std::sort(files.begin(), files.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+
+		entries.clear();
+		hashedCount = 0;
+		cachedCount = 0;
+
+		std::vector<uint8_t> rom;
+
+		for (Entry& file : files)
+		{
+			auto cached = std::lower_bound(cache.entries.begin(), cache.entries.end(), file, 
+				[](const Entry& a, const Entry& b) { return a.path < b.path; });
+
+			if (cached != cache.entries.end() && cached->path == file.path && cached->size == file.size 
+				&& cached->modificationTime == file.modificationTime)
+			{
+				entries.push_back(*cached);
+				cachedCount++;
+				continue;
+			}
+
+			if (!ReadRom(directory + "/" + file.path, &rom))
+			{
+				std::cout << "Couldn't read ROM: " << file.path << std::endl;
+				continue;
+			}
+
+			file.size = rom.size();
+			file.sha1 = Sha1::Hash(rom.data(), rom.size());
+			file.platform = DetectPlatform(rom.data(), rom.size(), file.path);
+			entries.push_back(file);
+			hashedCount++;
+		}
+
+		// Nothing needs to be written if every entry came from an up to date cache
+		if (hashedCount > 0 || cachedCount != (int)cache.entries.size()) SaveToFile(cachePath);
+
+		return true;
+	}
+
+	const std::vector<RomLibrary::Entry>& RomLibrary::GetEntries()
+	{
+		return entries;
+	}
+
+	int RomLibrary::GetHashedCount()
+	{
+		return hashedCount;
+	}
+
+	int RomLibrary::GetCachedCount()
+	{
+		return cachedCount;
+	}
+
+	bool RomLibrary::SaveToFile(std::string filePath)
+	{
+		std::ofstream file(filePath);
+
+		file << FORMAT_NAME << " " << FORMAT_VERSION << "\n";
+
+		for (const Entry& entry : entries)
+		{
+			file << entry.sha1 << " " << entry.size << " " << entry.modificationTime << " " << entry.platform << " " << entry.path << "\n";
+		}
+
+		if (!file)
+		{
+			std::cout << "Could not write ROM library index: " << filePath << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool RomLibrary::LoadFromFile(std::string filePath)
+	{
+		std::ifstream file(filePath);
+
+		if (!file.is_open())
+		{
+			std::cout << "Invalid ROM library index provided." << std::endl;
+			return false;
+		}
+
+		std::string formatName;
+		int version = 0;
+		file >> formatName >> version;
+
+		// An index from another version is ignored, and the ROMs are scanned again
+		if (formatName != FORMAT_NAME || version != FORMAT_VERSION) return false;
+
+		entries.clear();
+		std::string line;
+		std::getline(file, line);
+
+		while (std::getline(file, line))
+		{
+			std::istringstream lineStream(line);
+			Entry entry;
+
+			// The path is the rest of the line, since it may contain spaces
+			if (!(lineStream >> entry.sha1 >> entry.size >> entry.modificationTime >> entry.platform)) continue;
+
+			lineStream.ignore(1);
+			std::getline(lineStream, entry.path);
+
+			if (!entry.path.empty()) entries.push_back(entry);
+		}
+
+		return true;
+	}
+
+	bool RomLibrary::IsRomFile(std::string fileName)
+	{
+		std::transform(fileName.begin(), fileName.end(), fileName.begin(), [](char c) { return (char)std::tolower(c); });
+
+		for (const char* extension : ROM_EXTENSIONS)
+		{
+			std::string suffix = extension;
+			if (fileName.size() > suffix.size() && fileName.compare(fileName.size() - suffix.size(), suffix.size(), suffix) == 0) return true;
+		}
+
+		return false;
+	}
+
+	bool RomLibrary::ListFiles(std::string directory, std::string relativePath, std::vector<Entry>* files)
+	{
+		std::string path = relativePath.empty() ? directory : directory + "/" + relativePath;
+
+#ifdef _WIN32
+		WIN32_FIND_DATAA findData;
+		HANDLE findHandle = FindFirstFileA((path + "/*").c_str(), &findData);
+		if (findHandle == INVALID_HANDLE_VALUE) return false;
+
+		do
+		{
+			std::string name = findData.cFileName;
+			if (name == "." || name == "..") continue;
+
+			std::string entryPath = relativePath.empty() ? name : relativePath + "/" + name;
+
+			if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+			{
+				ListFiles(directory, entryPath, files);
+			}
+			else if (IsRomFile(name))
+			{
+				uint64_t size = ((uint64_t)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+				int64_t modificationTime = (int64_t)(((uint64_t)findData.ftLastWriteTime.dwHighDateTime << 32) | findData.ftLastWriteTime.dwLowDateTime);
+				files->push_back({ entryPath, size, modificationTime, "", "" });
+			}
+		} while (FindNextFileA(findHandle, &findData));
+
+		FindClose(findHandle);
+#else
+		DIR* directoryHandle = opendir(path.c_str());
+		if (directoryHandle == nullptr) return false;
+
+		while (dirent* directoryEntry = readdir(directoryHandle))
+		{
+			std::string name = directoryEntry->d_name;
+			if (name == "." || name == "..") continue;
+
+			std::string entryPath = relativePath.empty() ? name : relativePath + "/" + name;
+
+			// Links to files are followed, but links to directories aren't, so links can't lead to a loop
+			struct stat status;
+			std::string fullPath = directory + "/" + entryPath;
+			if (lstat(fullPath.c_str(), &status) != 0) continue;
+			if (S_ISLNK(status.st_mode) && (stat(fullPath.c_str(), &status) != 0 || S_ISDIR(status.st_mode))) continue;
+
+			if (S_ISDIR(status.st_mode))
+			{
+				ListFiles(directory, entryPath, files);
+			}
+			else if (S_ISREG(status.st_mode) && IsRomFile(name))
+			{
+				files->push_back({ entryPath, (uint64_t)status.st_size, (int64_t)status.st_mtime, "", "" });
+			}
+		}
+
+		closedir(directoryHandle);
+#endif
+
+		return true;
+	}
+}
\ No newline at end of file
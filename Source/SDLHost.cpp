@@ -0,0 +1,287 @@
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include "SDLHost.hpp"
+#include "CPU.hpp"
+
+namespace SHG
+{
+	// The keyboard key for each CHIP-8 key, from 0 to F:
+	// 1 2 3 4      1 2 3 C
+	// Q W E R  ->  4 5 6 D
+	// A S D F      7 8 9 E
+	// Z X C V      A 0 B F
+	const std::string SDLHost::DEFAULT_KEY_LAYOUT = "X123QWEASDZC4RFV";
+
+	constexpr uint32_t SDLHost::PIXEL_COLORS[];
+	constexpr uint8_t SDLHost::UNBOUND_KEY;
+
+	// How often the emulation thread checks how much sound is queued while it waits for the audio clock
+	static const std::chrono::milliseconds AUDIO_CLOCK_POLL_INTERVAL(1);
+
+	SDLHost::SDLHost(int width, int height, bool isVsyncEnabled)
+	{
+		SetKeyLayout(DEFAULT_KEY_LAYOUT);
+
+		if (SDL_Init(SDL_INIT_VIDEO) < 0)
+		{
+			std::cout << "SDL failed to initialize! SDL Error: " << SDL_GetError() << std::endl;
+			return;
+		}
+
+		screenWidth = width;
+		screenHeight = height;
+
+		window = SDL_CreateWindow("CHIP-8 Emulator", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, screenWidth, screenHeight, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+
+		Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+		if (isVsyncEnabled) rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+
+		renderer = SDL_CreateRenderer(window, -1, rendererFlags);
+
+		if (renderer == nullptr)
+		{
+			std::cout << "SDL failed to create a renderer! SDL Error: " << SDL_GetError() << std::endl;
+			return;
+		}
+
+		// Use nearest-neighbour scaling so the pixels stay sharp, and keep CHIP-8's aspect ratio when the window is resized
+		SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
+		SDL_RenderSetLogicalSize(renderer, Display::HIGH_RES_SCREEN_WIDTH, Display::HIGH_RES_SCREEN_HEIGHT);
+
+		// The texture always has the high resolution, and low resolution pixels are drawn as 2x2 texels, 
+		// so switching the resolution doesn't require a new texture
+		screenTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, 
+			Display::HIGH_RES_SCREEN_WIDTH, Display::HIGH_RES_SCREEN_HEIGHT);
+
+		if (screenTexture == nullptr) std::cout << "SDL failed to create the screen texture! SDL Error: " << SDL_GetError() << std::endl;
+	}
+
+	SDLHost::~SDLHost()
+	{
+		if (audioDevice != 0) SDL_CloseAudioDevice(audioDevice);
+		if (screenTexture != nullptr) SDL_DestroyTexture(screenTexture);
+		if (renderer != nullptr) SDL_DestroyRenderer(renderer);
+		if (window != nullptr) SDL_DestroyWindow(window);
+
+		SDL_Quit();
+	}
+
+	bool SDLHost::ProcessEvents(Keypad* keypad)
+	{
+		SDL_Event e;
+		while (SDL_PollEvent(&e))
+		{
+			if (e.type == SDL_QUIT) return false;
+
+			if (e.type == SDL_WINDOWEVENT) isRedrawNeeded = true;
+			if (e.type == SDL_RENDER_DEVICE_RESET) isFullUploadNeeded = true;
+
+			if (e.type != SDL_KEYDOWN && e.type != SDL_KEYUP) continue;
+
+			SDL_Scancode scancode = e.key.keysym.scancode;
+			if (scancode == REWIND_SCANCODE) isRewindKeyHeld = e.type == SDL_KEYDOWN;
+
+			if (scancode < 0 || scancode >= SDL_NUM_SCANCODES || keyBindings[scancode] == UNBOUND_KEY) continue;
+
+			keypad->SetKeyState(keyBindings[scancode], e.type == SDL_KEYDOWN);
+		}
+
+		return true;
+	}
+
+	bool SDLHost::IsRewindRequested()
+	{
+		return isRewindKeyHeld;
+	}
+
+	bool SDLHost::SetKeyLayout(const std::string& layout)
+	{
+		if (layout.size() != Keypad::KEY_COUNT)
+		{
+			std::cout << "A key layout must name exactly " << Keypad::KEY_COUNT << " keys." << std::endl;
+			return false;
+		}
+
+		SDL_Scancode scancodes[Keypad::KEY_COUNT];
+
+		for (int key = 0; key < Keypad::KEY_COUNT; key++)
+		{
+			scancodes[key] = SDL_GetScancodeFromName(std::string(1, layout[key]).c_str());
+
+			if (scancodes[key] == SDL_SCANCODE_UNKNOWN)
+			{
+				std::cout << "Unknown key '" << layout[key] << "' in key layout." << std::endl;
+				return false;
+			}
+		}
+
+		std::fill(keyBindings, keyBindings + SDL_NUM_SCANCODES, UNBOUND_KEY);
+		for (int key = 0; key < Keypad::KEY_COUNT; key++) keyBindings[scancodes[key]] = (uint8_t)key;
+
+		return true;
+	}
+
+	bool SDLHost::OpenAudio(int bufferSize, bool isAudioClockEnabled)
+	{
+		if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0)
+		{
+			std::cout << "SDL failed to initialize audio! SDL Error: " << SDL_GetError() << std::endl;
+			return false;
+		}
+
+		SDL_AudioSpec desiredSpec{};
+		desiredSpec.freq = AUDIO_SAMPLE_RATE;
+		desiredSpec.format = AUDIO_S16SYS;
+		desiredSpec.channels = 1;
+		desiredSpec.samples = (Uint16)std::min(std::max(bufferSize, 64), 32768);
+		desiredSpec.callback = &SDLHost::FillAudioBuffer;
+		desiredSpec.userdata = this;
+
+		// SDL converts the samples if the device wants a different format, so the obtained spec only differs in its buffer size
+		SDL_AudioSpec obtainedSpec{};
+		audioDevice = SDL_OpenAudioDevice(nullptr, 0, &desiredSpec, &obtainedSpec, 0);
+
+		if (audioDevice == 0)
+		{
+			std::cout << "SDL failed to open an audio device! SDL Error: " << SDL_GetError() << std::endl;
+			return false;
+		}
+
+		audioBufferSize = obtainedSpec.samples;
+		audioSampleRate = obtainedSpec.freq;
+		this->isAudioClockEnabled = isAudioClockEnabled;
+
+		// A frame of sound that would queue more than twice the device's buffer and a frame is dropped, so the latency 
+		// stays bounded even if the system clock runs a little faster than the audio device's
+		int frameSampleCount = audioSampleRate / CPU::FRAMES_PER_SECOND + 1;
+		maxQueuedSampleCount = 2 * ((size_t)audioBufferSize + frameSampleCount);
+
+		audioSamples = std::make_unique<RingBuffer<int16_t>>(maxQueuedSampleCount);
+		soundGenerator = std::make_unique<SoundGenerator>(audioSampleRate);
+		frameSamples.reserve(frameSampleCount);
+
+		std::cout << "Audio: " << audioSampleRate << " Hz, buffer of " << audioBufferSize << " samples" 
+			<< (isAudioClockEnabled ? ", paced by the audio clock" : "") << std::endl;
+
+		return true;
+	}
+
+	void SDLHost::QueueAudio(const Sound& sound)
+	{
+		if (audioDevice == 0) return;
+
+		// Samples that don't divide evenly into frames are carried over to later frames, the same as instructions
+		audioSampleRemainder += audioSampleRate;
+		int count = audioSampleRemainder / CPU::FRAMES_PER_SECOND;
+		audioSampleRemainder %= CPU::FRAMES_PER_SECOND;
+
+		frameSamples.resize(count);
+		soundGenerator->Generate(sound, frameSamples.data(), count);
+
+		if (audioSamples->GetCount() + count > maxQueuedSampleCount)
+		{
+			droppedAudioFrameCount++;
+			return;
+		}
+
+		for (int16_t sample : frameSamples) audioSamples->Push(sample);
+
+		if (isAudioPaused)
+		{
+			SDL_PauseAudioDevice(audioDevice, 0);
+			isAudioPaused = false;
+		}
+	}
+
+	bool SDLHost::IsAudioClockEnabled()
+	{
+		return audioDevice != 0 && isAudioClockEnabled;
+	}
+
+	void SDLHost::WaitForAudioClock()
+	{
+		// The device takes a whole buffer at a time, so keeping a buffer's worth queued means it never runs dry, 
+		// as long as the next frame is ready before the device takes the next buffer
+		while (audioSamples->GetCount() > (size_t)audioBufferSize) std::this_thread::sleep_for(AUDIO_CLOCK_POLL_INTERVAL);
+	}
+
+	uint64_t SDLHost::GetAudioUnderrunCount()
+	{
+		return audioUnderrunCount;
+	}
+
+	uint64_t SDLHost::GetDroppedAudioFrameCount()
+	{
+		return droppedAudioFrameCount;
+	}
+
+	void SDLCALL SDLHost::FillAudioBuffer(void* userData, Uint8* stream, int length)
+	{
+		// Called on SDL's audio thread, which is the ring buffer's only consumer
+		SDLHost* host = (SDLHost*)userData;
+		int16_t* samples = (int16_t*)stream;
+		size_t count = length / sizeof(int16_t);
+
+		size_t poppedCount = host->audioSamples->Pop(samples, count);
+		if (poppedCount == count) return;
+
+		// The emulation thread fell behind, so the rest of the buffer is silent
+		std::fill(samples + poppedCount, samples + count, 0);
+		host->audioUnderrunCount++;
+	}
+
+	void SDLHost::Present(Display* display)
+	{
+		if (screenTexture == nullptr) return;
+
+		if (isFullUploadNeeded)
+		{
+			UpdateScreenTexture(display, { 0, 0, display->GetWidth(), display->GetHeight() });
+		}
+		else
+		{
+			// Nothing has to be uploaded or presented if the screen is the same as in the last frame
+			if (!display->HasChanged() && !isRedrawNeeded) return;
+
+			for (const Display::DirtyRect& dirtyRect : display->GetDirtyRects())
+			{
+				UpdateScreenTexture(display, { dirtyRect.x, dirtyRect.y, dirtyRect.width, dirtyRect.height });
+			}
+		}
+
+		isFullUploadNeeded = false;
+		isRedrawNeeded = false;
+
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+		SDL_RenderClear(renderer);
+		SDL_RenderCopy(renderer, screenTexture, nullptr, nullptr);
+		SDL_RenderPresent(renderer);
+	}
+
+	void SDLHost::UpdateScreenTexture(Display* display, const SDL_Rect& rect)
+	{
+		void* texturePixels = nullptr;
+		int pitch = 0;
+
+		// The rect is in pixels of the display's resolution, and each of them covers scale x scale texels
+		int scale = Display::HIGH_RES_SCREEN_WIDTH / display->GetWidth();
+		SDL_Rect textureRect = { rect.x * scale, rect.y * scale, rect.w * scale, rect.h * scale };
+
+		// Only the given area of the texture is locked, so only that area is converted and uploaded
+		if (SDL_LockTexture(screenTexture, &textureRect, &texturePixels, &pitch) < 0) return;
+
+		for (int y = 0; y < textureRect.h; y++)
+		{
+			uint32_t* pixelRow = (uint32_t*)((uint8_t*)texturePixels + y * pitch);
+
+			for (int x = 0; x < textureRect.w; x++)
+			{
+				pixelRow[x] = PIXEL_COLORS[display->GetPixel(rect.x + x / scale, rect.y + y / scale)];
+			}
+		}
+
+		SDL_UnlockTexture(screenTexture);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include <cstring>
+#include <algorithm>
+#include "Sha1.hpp"
+
+namespace SHG
+{
+	static uint32_t RotateLeft(uint32_t value, int count)
+	{
+		return (value << count) | (value >> (32 - count));
+	}
+
+	Sha1::Sha1()
+	{
+		state[0] = 0x67452301;
+		state[1] = 0xEFCDAB89;
+		state[2] = 0x98BADCFE;
+		state[3] = 0x10325476;
+		state[4] = 0xC3D2E1F0;
+	}
+
+	void Sha1::Update(const uint8_t* data, size_t size)
+	{
+		totalSize += size;
+
+		// Fill up a partial block first, then process whole blocks straight from the input
+		if (blockSize > 0)
+		{
+			size_t count = std::min(size, (size_t)BLOCK_SIZE - blockSize);
+			memcpy(block + blockSize, data, count);
+			blockSize += count;
+			data += count;
+			size -= count;
+
+			if (blockSize < BLOCK_SIZE) return;
+
+			ProcessBlock(block);
+			blockSize = 0;
+		}
+
+		for (; size >= BLOCK_SIZE; data += BLOCK_SIZE, size -= BLOCK_SIZE) ProcessBlock(data);
+
+		memcpy(block, data, size);
+		blockSize = size;
+	}
+
+	std::string Sha1::Finish()
+	{
+		// The message is padded with a 1 bit, zeros, and its length in bits as a big-endian 64-bit number
+		uint64_t bitCount = totalSize * 8;
+		uint8_t padding[BLOCK_SIZE * 2]{ 0x80 };
+		size_t paddingSize = (blockSize < BLOCK_SIZE - 8 ? BLOCK_SIZE : BLOCK_SIZE * 2) - blockSize;
+
+		for (int i = 0; i < 8; i++) padding[paddingSize - 1 - i] = (uint8_t)(bitCount >> (i * 8));
+		Update(padding, paddingSize);
+
+		static const char* digits = "0123456789abcdef";
+		std::string text;
+
+		for (int i = 0; i < DIGEST_SIZE; i++)
+		{
+			uint8_t byte = (uint8_t)(state[i / 4] >> (24 - (i % 4) * 8));
+			text += digits[byte >> 4];
+			text += digits[byte & 0xF];
+		}
+
+		return text;
+	}
+
+	std::string Sha1::Hash(const uint8_t* data, size_t size)
+	{
+		Sha1 sha1;
+		sha1.Update(data, size);
+		return sha1.Finish();
+	}
+
+	void Sha1::ProcessBlock(const uint8_t* data)
+	{
+		uint32_t words[80];
+
+		for (int i = 0; i < 16; i++)
+		{
+			words[i] = ((uint32_t)data[i * 4] << 24) | ((uint32_t)data[i * 4 + 1] << 16) | ((uint32_t)data[i * 4 + 2] << 8) | data[i * 4 + 3];
+		}
+
+		for (int i = 16; i < 80; i++) words[i] = RotateLeft(words[i - 3] ^ words[i - 8] ^ words[i - 14] ^ words[i - 16], 1);
+
+		uint32_t a = state[0];
+		uint32_t b = state[1];
+		uint32_t c = state[2];
+		uint32_t d = state[3];
+		uint32_t e = state[4];
+
+		for (int i = 0; i < 80; i++)
+		{
+			uint32_t f;
+			uint32_t k;
+
+			if (i < 20)
+			{
+				f = (b & c) | (~b & d);
+				k = 0x5A827999;
+			}
+			else if (i < 40)
+			{
+				f = b ^ c ^ d;
+				k = 0x6ED9EBA1;
+			}
+			else if (i < 60)
+			{
+				f = (b & c) | (b & d) | (c & d);
+				k = 0x8F1BBCDC;
+			}
+			else
+			{
+				f = b ^ c ^ d;
+				k = 0xCA62C1D6;
+			}
+
+			uint32_t temp = RotateLeft(a, 5) + f + e + k + words[i];
+			e = d;
+			d = c;
+			c = RotateLeft(b, 30);
+			b = a;
+			a = temp;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include <cmath>
+#include <algorithm>
+#include "SoundGenerator.hpp"
+
+namespace SHG
+{
+	static const double BASE_BIT_RATE = 4000.0;
+	static const double PITCHES_PER_OCTAVE = 48.0;
+	static const int PATTERN_BIT_COUNT = Sound::PATTERN_SIZE * 8;
+
+	constexpr uint8_t SoundGenerator::BEEPER_PATTERN_BYTE;
+
+	SoundGenerator::SoundGenerator(int sampleRate)
+	{
+		this->sampleRate = std::max(sampleRate, 1);
+	}
+
+	void SoundGenerator::Generate(const Sound& sound, int16_t* samples, int count)
+	{
+		if (!sound.isPlaying)
+		{
+			std::fill(samples, samples + count, 0);
+			return;
+		}
+
+		double bitRate = BASE_BIT_RATE * std::pow(2.0, (sound.pitch - DEFAULT_PITCH) / PITCHES_PER_OCTAVE);
+		double step = bitRate / sampleRate;
+
+		for (int i = 0; i < count; i++)
+		{
+			int bit = (int)position;
+			bool isSet = (sound.pattern[bit / 8] & (0x80 >> (bit % 8))) != 0;
+			samples[i] = isSet ? AMPLITUDE : -AMPLITUDE;
+
+			position += step;
+			if (position >= PATTERN_BIT_COUNT) position -= PATTERN_BIT_COUNT;
+		}
+	}
+}
\ No newline at end of file
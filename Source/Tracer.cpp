@@ -0,0 +1,245 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include "Tracer.hpp"
+
+namespace SHG
+{
+	// How long the writer thread sleeps when there's nothing to write
+	static const std::chrono::milliseconds WRITER_IDLE_DURATION(1);
+
+	Tracer::Tracer(size_t capacity) : buffer(capacity)
+	{
+	}
+
+	Tracer::~Tracer()
+	{
+		Close();
+	}
+
+	bool Tracer::Open(std::string filePath)
+	{
+		Close();
+
+		file.open(filePath, std::fstream::binary);
+
+		FileHeader header{ FILE_MAGIC, FORMAT_VERSION, sizeof(Record), 0 };
+		file.write((const char*)&header, sizeof(FileHeader));
+
+		if (!file)
+		{
+			std::cout << "Could not write trace: " << filePath << std::endl;
+			file.close();
+			return false;
+		}
+
+		recordCount = 0;
+		stallCount = 0;
+		isOpen = true;
+		writerThread = std::thread(&Tracer::RunWriterThread, this);
+
+		return true;
+	}
+
+	void Tracer::Close()
+	{
+		if (!isOpen) return;
+
+		isOpen = false;
+		writerThread.join();
+		file.close();
+	}
+
+	void Tracer::Write(const Record& record)
+	{
+		if (!buffer.Push(record))
+		{
+			stallCount++;
+			while (!buffer.Push(record)) std::this_thread::yield();
+		}
+
+		recordCount++;
+	}
+
+	uint64_t Tracer::GetRecordCount()
+	{
+		return recordCount;
+	}
+
+	uint64_t Tracer::GetStallCount()
+	{
+		return stallCount;
+	}
+
+	void Tracer::RunWriterThread()
+	{
+		std::vector<Record> chunk(WRITE_CHUNK_SIZE);
+
+		while (isOpen)
+		{
+			if (WriteChunk(chunk.data()) == 0) std::this_thread::sleep_for(WRITER_IDLE_DURATION);
+		}
+
+		// Everything written before Close was called is still in the buffer
+		while (WriteChunk(chunk.data()) != 0);
+	}
+
+	size_t Tracer::WriteChunk(Record* chunk)
+	{
+		size_t count = buffer.Pop(chunk, WRITE_CHUNK_SIZE);
+		file.write((const char*)chunk, count * sizeof(Record));
+
+		return count;
+	}
+
+	bool Tracer::Decode(std::string filePath, std::ostream& output)
+	{
+		std::ifstream file(filePath, std::fstream::binary);
+
+		if (!file.is_open())
+		{
+			std::cout << "Invalid trace file provided." << std::endl;
+			return false;
+		}
+
+		FileHeader header{};
+		file.read((char*)&header, sizeof(FileHeader));
+
+		if (file.gcount() != sizeof(FileHeader) || header.magic != FILE_MAGIC || header.version != FORMAT_VERSION 
+			|| header.recordSize != sizeof(Record))
+		{
+			std::cout << "The trace is invalid or was made by a different version of the emulator." << std::endl;
+			return false;
+		}
+
+		// I is only shown when it changes, so the first record always shows it
+		Record record{};
+		int previousIRegister = -1;
+
+		output << std::hex << std::uppercase << std::setfill('0');
+
+		while (file.read((char*)&record, sizeof(Record)))
+		{
+			std::ostringstream changes;
+			changes << std::hex << std::uppercase << std::setfill('0');
+
+			for (int i = 0; i < REGISTER_COUNT; i++)
+			{
+				if ((record.changedRegisters & (1 << i)) == 0) continue;
+				changes << " V" << i << "=" << std::setw(2) << (int)record.vRegisters[i];
+			}
+
+			if (record.iRegister != previousIRegister) changes << " I=" << std::setw(3) << record.iRegister;
+			previousIRegister = record.iRegister;
+
+			output << std::dec << std::setfill(' ') << std::setw(12) << record.instructionCount << std::hex << std::setfill('0')
+				<< "  " << std::setw(3) << record.address << "  " << std::setw(4) << record.opcode << "  ";
+
+			// The changes are lined up in a column after the instruction
+			std::string text = Disassemble(record.opcode);
+			if (changes.tellp() > 0) output << std::left << std::setfill(' ') << std::setw(18) << text << std::right << changes.str();
+			else output << text;
+
+			output << "\n";
+		}
+
+		// A trace that was cut off in the middle of a record still has every complete record
+		if (file.gcount() != 0) std::cout << "The trace ends with an incomplete record." << std::endl;
+
+		output << std::dec << std::nouppercase << std::setfill(' ');
+		return true;
+	}
+
+	std::string Tracer::Disassemble(uint16_t opcode)
+	{
+		int x = (opcode & 0x0F00) >> 8;
+		int y = (opcode & 0x00F0) >> 4;
+		int nnn = opcode & 0x0FFF;
+		int kk = opcode & 0x00FF;
+		int n = opcode & 0x000F;
+
+		std::ostringstream text;
+		text << std::hex << std::uppercase << std::setfill('0');
+
+		std::string vx = "V" + std::string(1, "0123456789ABCDEF"[x]);
+		std::string vy = "V" + std::string(1, "0123456789ABCDEF"[y]);
+
+		switch (opcode & 0xF000)
+		{
+		case 0x0000:
+			if (opcode == 0x00E0) text << "CLS";
+			else if (opcode == 0x00EE) text << "RET";
+			else if ((opcode & 0xFFF0) == 0x00C0) text << "SCD " << n;
+			else if ((opcode & 0xFFF0) == 0x00D0) text << "SCU " << n;
+			else if (opcode == 0x00FB) text << "SCR";
+			else if (opcode == 0x00FC) text << "SCL";
+			else if (opcode == 0x00FD) text << "EXIT";
+			else if (opcode == 0x00FE) text << "LOW";
+			else if (opcode == 0x00FF) text << "HIGH";
+			else text << "SYS " << std::setw(3) << nnn;
+			break;
+		case 0x1000: text << "JP " << std::setw(3) << nnn; break;
+		case 0x2000: text << "CALL " << std::setw(3) << nnn; break;
+		case 0x3000: text << "SE " << vx << ", " << std::setw(2) << kk; break;
+		case 0x4000: text << "SNE " << vx << ", " << std::setw(2) << kk; break;
+		case 0x5000:
+			if (n == 0x2) text << "SAVE " << vx << " - " << vy;
+			else if (n == 0x3) text << "LOAD " << vx << " - " << vy;
+			else text << "SE " << vx << ", " << vy;
+			break;
+		case 0x6000: text << "LD " << vx << ", " << std::setw(2) << kk; break;
+		case 0x7000: text << "ADD " << vx << ", " << std::setw(2) << kk; break;
+		case 0x8000:
+			switch (n)
+			{
+			case 0x0: text << "LD " << vx << ", " << vy; break;
+			case 0x1: text << "OR " << vx << ", " << vy; break;
+			case 0x2: text << "AND " << vx << ", " << vy; break;
+			case 0x3: text << "XOR " << vx << ", " << vy; break;
+			case 0x4: text << "ADD " << vx << ", " << vy; break;
+			case 0x5: text << "SUB " << vx << ", " << vy; break;
+			case 0x6: text << "SHR " << vx << ", " << vy; break;
+			case 0x7: text << "SUBN " << vx << ", " << vy; break;
+			case 0xE: text << "SHL " << vx << ", " << vy; break;
+			default: text << "???"; break;
+			}
+			break;
+		case 0x9000: text << "SNE " << vx << ", " << vy; break;
+		case 0xA000: text << "LD I, " << std::setw(3) << nnn; break;
+		case 0xB000: text << "JP V0, " << std::setw(3) << nnn; break;
+		case 0xC000: text << "RND " << vx << ", " << std::setw(2) << kk; break;
+		case 0xD000: text << "DRW " << vx << ", " << vy << ", " << n; break;
+		case 0xE000:
+			if (kk == 0x9E) text << "SKP " << vx;
+			else if (kk == 0xA1) text << "SKNP " << vx;
+			else text << "???";
+			break;
+		case 0xF000:
+			switch (kk)
+			{
+			case 0x00: text << (opcode == 0xF000 ? "LD I, long" : "???"); break;
+			case 0x01: text << "PLANE " << x; break;
+			case 0x02: text << (opcode == 0xF002 ? "AUDIO" : "???"); break;
+			case 0x07: text << "LD " << vx << ", DT"; break;
+			case 0x0A: text << "LD " << vx << ", K"; break;
+			case 0x15: text << "LD DT, " << vx; break;
+			case 0x18: text << "LD ST, " << vx; break;
+			case 0x1E: text << "ADD I, " << vx; break;
+			case 0x29: text << "LD F, " << vx; break;
+			case 0x30: text << "LD HF, " << vx; break;
+			case 0x33: text << "LD B, " << vx; break;
+			case 0x3A: text << "PITCH " << vx; break;
+			case 0x55: text << "LD [I], " << vx; break;
+			case 0x65: text << "LD " << vx << ", [I]"; break;
+			case 0x75: text << "LD R, " << vx; break;
+			case 0x85: text << "LD " << vx << ", R"; break;
+			default: text << "???"; break;
+			}
+			break;
+		}
+
+		return text.str();
+	}
+}
\ No newline at end of file
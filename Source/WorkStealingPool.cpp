@@ -0,0 +1,90 @@
+#include <thread>
+#include <algorithm>
+#include "WorkStealingPool.hpp"
+
+namespace SHG
+{
+	WorkStealingPool::WorkStealingPool(int threadCount)
+	{
+		this->threadCount = std::max(threadCount, 1);
+
+		for (int i = 0; i < this->threadCount; i++) queues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	void WorkStealingPool::Run(int taskCount, const std::function<void(int)>& task)
+	{
+		stolenTaskCount = 0;
+
+		for (int i = 0; i < threadCount; i++)
+		{
+			int shardStart = (int)((int64_t)taskCount * i / threadCount);
+			int shardEnd = (int)((int64_t)taskCount * (i + 1) / threadCount);
+
+			for (int taskIndex = shardStart; taskIndex < shardEnd; taskIndex++) queues[i]->taskIndices.push_back(taskIndex);
+		}
+
+		// The calling thread works on the first shard, instead of waiting for the other threads
+		std::vector<std::thread> threads;
+		for (int i = 1; i < threadCount; i++) threads.emplace_back(&WorkStealingPool::RunWorker, this, i, std::cref(task));
+
+		RunWorker(0, task);
+
+		for (std::thread& thread : threads) thread.join();
+	}
+
+	int WorkStealingPool::GetThreadCount()
+	{
+		return threadCount;
+	}
+
+	uint64_t WorkStealingPool::GetStolenTaskCount()
+	{
+		return stolenTaskCount;
+	}
+
+	void WorkStealingPool::RunWorker(int workerIndex, const std::function<void(int)>& task)
+	{
+		int taskIndex = 0;
+
+		// No new tasks are added while the pool runs, so once every queue is empty the worker is done
+		while (PopTask(workerIndex, &taskIndex) || StealTask(workerIndex, &taskIndex))
+		{
+			task(taskIndex);
+		}
+	}
+
+	bool WorkStealingPool::PopTask(int workerIndex, int* taskIndex)
+	{
+		WorkQueue& queue = *queues[workerIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (queue.taskIndices.empty()) return false;
+
+		// Owners take tasks from the front of their shard, in manifest order
+		*taskIndex = queue.taskIndices.front();
+		queue.taskIndices.pop_front();
+
+		return true;
+	}
+
+	bool WorkStealingPool::StealTask(int workerIndex, int* taskIndex)
+	{
+		// Victims are checked starting with the next worker, so thieves spread out instead of all hitting the same queue
+		for (int offset = 1; offset < threadCount; offset++)
+		{
+			WorkQueue& queue = *queues[(workerIndex + offset) % threadCount];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+
+			if (queue.taskIndices.empty()) continue;
+
+			// Thieves take tasks from the back, which is the work the owner would reach last
+			*taskIndex = queue.taskIndices.back();
+			queue.taskIndices.pop_back();
+			stolenTaskCount++;
+
+			return true;
+		}
+
+		return false;
+	}
+}
\ No newline at end of file